@@ -0,0 +1,69 @@
+#include "acquisition.h"
+
+AcquisitionEngine::AcquisitionEngine() : sources(nullptr), count(0), firstIndex(0), sampleCounts(), notReadyCounts()
+{
+}
+
+void AcquisitionEngine::begin(LoadCellSource *sources[], int count)
+{
+    this->sources = sources;
+    this->count = count < ACQUISITION_MAX_CELLS ? count : ACQUISITION_MAX_CELLS;
+    firstIndex = 0;
+    for (int i = 0; i < ACQUISITION_MAX_CELLS; ++i)
+    {
+        sampleCounts[i] = 0;
+        notReadyCounts[i] = 0;
+    }
+}
+
+uint32_t AcquisitionEngine::readyMask()
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (sources[i]->isReady())
+        {
+            mask |= (uint32_t)1 << i;
+        }
+        else
+        {
+            notReadyCounts[i]++;
+        }
+    }
+    return mask;
+}
+
+int AcquisitionEngine::service(SampleCallback callback, void *context)
+{
+    uint32_t mask = readyMask();
+    if (mask == 0)
+    {
+        return 0;
+    }
+
+    int samples = 0;
+    for (int k = 0; k < count; ++k)
+    {
+        int i = (firstIndex + k) % count;
+        if (mask & ((uint32_t)1 << i))
+        {
+            long raw = sources[i]->read();
+            sampleCounts[i]++;
+            samples++;
+            callback(i, raw, context);
+        }
+    }
+
+    firstIndex = (firstIndex + 1) % count;
+    return samples;
+}
+
+uint32_t AcquisitionEngine::sampleCount(int index) const
+{
+    return sampleCounts[index];
+}
+
+uint32_t AcquisitionEngine::notReadyCount(int index) const
+{
+    return notReadyCounts[index];
+}
@@ -0,0 +1,56 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <stdint.h>
+
+// The ready mask is a 32 bit word, one bit per cell
+#define ACQUISITION_MAX_CELLS 32
+
+// A load cell ADC that converts continuously and signals when data is ready
+// (HX711: DOUT goes low). Implemented by the HX711 driver on the ESP32 and by
+// the simulated HX711 on the host.
+class LoadCellSource
+{
+public:
+    virtual ~LoadCellSource() {}
+
+    // True if a conversion is ready to be clocked out
+    virtual bool isReady() = 0;
+
+    // Clock out the ready conversion (only called after isReady() returned true)
+    virtual long read() = 0;
+};
+
+// Called for every conversion clocked out by the engine
+typedef void (*SampleCallback)(int index, long raw, void *context);
+
+// Reads whichever load cells have a conversion ready instead of waiting on
+// them one after another. The HX711s convert in parallel, so the aggregate
+// sample rate scales with the number of cells.
+class AcquisitionEngine
+{
+public:
+    AcquisitionEngine();
+
+    void begin(LoadCellSource *sources[], int count);
+
+    // Bit i is set if cell i has a conversion ready
+    uint32_t readyMask();
+
+    // Read every cell that is ready right now, returns the number of samples read
+    int service(SampleCallback callback, void *context);
+
+    uint32_t sampleCount(int index) const;
+
+    // Times readyMask() found the cell without a conversion
+    uint32_t notReadyCount(int index) const;
+
+private:
+    LoadCellSource **sources;
+    int count;
+    int firstIndex; // rotated so no cell is always served last
+    uint32_t sampleCounts[ACQUISITION_MAX_CELLS];
+    uint32_t notReadyCounts[ACQUISITION_MAX_CELLS];
+};
+
+#endif
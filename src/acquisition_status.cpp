@@ -0,0 +1,21 @@
+#include <string.h>
+#include "acquisition_status.h"
+
+const char *getAcquisitionModeName(AcquisitionMode mode)
+{
+    static const char *names[] = {"auto", "fast", "slow"};
+    return names[mode];
+}
+
+bool parseAcquisitionMode(const char *name, AcquisitionMode &mode)
+{
+    for (uint8_t i = ACQUISITION_AUTO; i <= ACQUISITION_SLOW; ++i)
+    {
+        if (strcmp(name, getAcquisitionModeName((AcquisitionMode)i)) == 0)
+        {
+            mode = (AcquisitionMode)i;
+            return true;
+        }
+    }
+    return false;
+}
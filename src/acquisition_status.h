@@ -0,0 +1,30 @@
+#ifndef ACQUISITION_STATUS_H
+#define ACQUISITION_STATUS_H
+
+#include <stdint.h>
+
+// How a cell's HX711 picks its output rate. Needs a GPIO on the RATE pin,
+// without one the board fixes the rate.
+enum AcquisitionMode : uint8_t
+{
+    ACQUISITION_AUTO = 0, // 80 SPS while the weight moves, 10 SPS at rest
+    ACQUISITION_FAST = 1, // always 80 SPS
+    ACQUISITION_SLOW = 2  // always 10 SPS
+};
+
+// How a cell is being read
+struct AcquisitionStatus
+{
+    AcquisitionMode mode;
+    bool switchable; // RATE is wired to a GPIO
+    bool fast;       // RATE is high, 80 SPS
+    bool active;     // the weight is moving, see ActivityDetector
+    uint8_t gain;    // 128 or 64 on channel A, 32 on channel B
+    uint16_t sps;    // conversions read in the last second
+};
+
+// "auto", "fast" or "slow"
+const char *getAcquisitionModeName(AcquisitionMode mode);
+bool parseAcquisitionMode(const char *name, AcquisitionMode &mode);
+
+#endif
@@ -0,0 +1,56 @@
+#include "activity.h"
+
+ActivityDetector::ActivityDetector()
+{
+    reset();
+}
+
+void ActivityDetector::reset()
+{
+    sum = 0;
+    count = 0;
+    windowStart = 0;
+    previousMean = 0;
+    hasPrevious = false;
+    activeUntil = 0;
+    active = false;
+}
+
+bool ActivityDetector::update(float weight, uint32_t nowMs)
+{
+    if (count == 0)
+    {
+        windowStart = nowMs;
+    }
+    sum += weight;
+    count++;
+
+    // At 10 SPS a window holds a single reading, at 80 SPS about eight
+    uint32_t elapsed = nowMs - windowStart;
+    if (elapsed >= ACTIVITY_WINDOW_MS)
+    {
+        float mean = sum / count;
+        float rate = (mean - previousMean) * 1000.0f / elapsed;
+        if (hasPrevious && (rate > ACTIVITY_MIN_RATE || rate < -ACTIVITY_MIN_RATE))
+        {
+            hold(ACTIVITY_HOLD_MS, nowMs);
+        }
+        previousMean = mean;
+        hasPrevious = true;
+        sum = 0;
+        count = 0;
+    }
+
+    active = (int32_t)(activeUntil - nowMs) > 0;
+    return active;
+}
+
+void ActivityDetector::hold(uint32_t durationMs, uint32_t nowMs)
+{
+    // Never shortens a hold that is already running
+    if (!active || (int32_t)(nowMs + durationMs - activeUntil) > 0)
+    {
+        activeUntil = nowMs + durationMs;
+    }
+    active = true;
+}
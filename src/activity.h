@@ -0,0 +1,44 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include <stdint.h>
+
+// Weights are averaged over windows of this length, then consecutive
+// windows are compared. Averaging keeps the noise of 80 SPS readings from
+// looking like movement.
+#define ACTIVITY_WINDOW_MS 100
+
+// A cell is active while its weight changes faster than this
+#define ACTIVITY_MIN_RATE 10.0f // grams per second
+
+// And stays active until it has been still for this long
+#define ACTIVITY_HOLD_MS 2000
+
+// Detects when a cell is in use, e.g. while the robot dips a glass, from
+// the rate of change of its weight
+class ActivityDetector
+{
+public:
+    ActivityDetector();
+    void reset();
+
+    // Feed an unfiltered weight in grams, returns true while the cell is active
+    bool update(float weight, uint32_t nowMs);
+
+    // Stay active for at least durationMs, e.g. announced by the process
+    // right before a dip
+    void hold(uint32_t durationMs, uint32_t nowMs);
+
+    bool isActive() const { return active; }
+
+private:
+    float sum;           // weights in the current window
+    uint16_t count;
+    uint32_t windowStart;
+    float previousMean;  // mean of the last complete window
+    bool hasPrevious;
+    uint32_t activeUntil;
+    bool active;
+};
+
+#endif
@@ -0,0 +1,355 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <atomic>
+#include <math.h>
+#include "alerts.h"
+#include "cores.h"
+#include "json_file.h"
+#include "responses.h"
+#include "seqlock.h"
+
+// Thresholds are written by the web server and read by the sampler
+static Seqlock<AlertThresholds> cellThresholds[MAX_LOAD_CELLS];
+static std::atomic<uint8_t> levels[MAX_LOAD_CELLS]; // written by the sampler task
+static int numAlertCells = 0;
+
+// Alerts waiting for the webhook task, and where they go
+static AlertEvent queue[ALERT_QUEUE_SIZE];
+static int queueHead = 0;
+static int queueCount = 0;
+static uint32_t lastSequence = 0;
+static char webhookUrl[WEBHOOK_URL_SIZE] = "";
+static portMUX_TYPE alertsMux = portMUX_INITIALIZER_UNLOCKED; // queue and URL
+
+static TaskHandle_t webhookTaskHandle = nullptr;
+static std::atomic<uint32_t> webhookCounts[WEBHOOK_RESULT_COUNT];
+static volatile bool alertsDirty = false;
+
+// Function Prototypes
+static void queueAlert(int index, AlertLevel level, float weight, float threshold, uint32_t timestamp);
+static bool peekAlert(AlertEvent &event, char *url);
+static void popAlert(uint32_t sequence);
+static void webhookTask(void *parameter);
+static void deliverAlert(const AlertEvent &event, const char *url);
+static int postAlert(const char *url, const char *body, size_t length);
+static bool isWebhookUrl(const char *url);
+
+// Expected format, all keys optional:
+//   {"webhook": "http://host:port/path", "load_cells": [{"id": 1, "low": 50.0, "high": 900.0, "hysteresis": 5.0}, ...]}
+void loadAlerts(int numCells)
+{
+    numAlertCells = min(numCells, MAX_LOAD_CELLS);
+    for (int i = 0; i < numAlertCells; ++i)
+    {
+        cellThresholds[i].write({NAN, NAN, ALERT_DEFAULT_HYSTERESIS});
+    }
+
+    JsonDocument jsonDoc;
+    if (!readJsonFile(ALERTS_PATH, jsonDoc))
+    {
+        return;
+    }
+
+    const char *url = jsonDoc["webhook"] | "";
+    if (isWebhookUrl(url))
+    {
+        strcpy(webhookUrl, url);
+    }
+
+    for (JsonObject cell : jsonDoc["load_cells"].as<JsonArray>())
+    {
+        int index = cell["id"].as<int>() - 1;
+        if (index < 0 || index >= numAlertCells)
+        {
+            continue;
+        }
+        cellThresholds[index].write({cell["low"] | NAN, cell["high"] | NAN, cell["hysteresis"] | ALERT_DEFAULT_HYSTERESIS});
+    }
+    Serial.println("Alert thresholds restored from SPIFFS");
+}
+
+// Start the task posting alerts to the webhook
+void startAlerts()
+{
+    xTaskCreatePinnedToCore(webhookTask, "webhook", 6144, nullptr, NETWORK_TASK_PRIORITY, &webhookTaskHandle, NETWORK_CORE);
+}
+
+// Move a cell between normal, low and high. Only stable weights count, a dip
+// briefly pushes the plate down. A level is left only once the weight is
+// back past the limit by the hysteresis, so noise at a limit alerts once.
+void updateAlerts(int index, const LoadCellReading &reading)
+{
+    if (!reading.connected || !reading.stable)
+    {
+        return;
+    }
+
+    AlertThresholds thresholds = cellThresholds[index].read();
+    AlertLevel level = (AlertLevel)levels[index].load(std::memory_order_relaxed);
+    AlertLevel next = level;
+    float threshold = NAN;
+    float weight = reading.weight;
+
+    if (level == LEVEL_LOW && (isnan(thresholds.low) || weight > thresholds.low + thresholds.hysteresis))
+    {
+        next = LEVEL_NORMAL;
+        threshold = thresholds.low;
+    }
+    else if (level == LEVEL_HIGH && (isnan(thresholds.high) || weight < thresholds.high - thresholds.hysteresis))
+    {
+        next = LEVEL_NORMAL;
+        threshold = thresholds.high;
+    }
+
+    // Comparisons with a limit that is not set (NAN) are false
+    if (next == LEVEL_NORMAL)
+    {
+        if (weight < thresholds.low)
+        {
+            next = LEVEL_LOW;
+            threshold = thresholds.low;
+        }
+        else if (weight > thresholds.high)
+        {
+            next = LEVEL_HIGH;
+            threshold = thresholds.high;
+        }
+    }
+
+    if (next != level)
+    {
+        levels[index].store(next, std::memory_order_relaxed);
+        queueAlert(index, next, weight, threshold, reading.timestamp);
+    }
+}
+
+void setAlertThresholds(int index, const AlertThresholds &thresholds)
+{
+    cellThresholds[index].write(thresholds);
+    alertsDirty = true;
+}
+
+AlertThresholds getAlertThresholds(int index)
+{
+    return cellThresholds[index].read();
+}
+
+AlertLevel getAlertLevel(int index)
+{
+    return (AlertLevel)levels[index].load(std::memory_order_relaxed);
+}
+
+bool setWebhookUrl(const char *url)
+{
+    if (url[0] != '\0' && !isWebhookUrl(url))
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&alertsMux);
+    strcpy(webhookUrl, url);
+    if (url[0] == '\0')
+    {
+        queueCount = 0; // nowhere to send them anymore
+    }
+    taskEXIT_CRITICAL(&alertsMux);
+
+    alertsDirty = true;
+    return true;
+}
+
+void getWebhookUrl(char *out, size_t size)
+{
+    taskENTER_CRITICAL(&alertsMux);
+    snprintf(out, size, "%s", webhookUrl);
+    taskEXIT_CRITICAL(&alertsMux);
+}
+
+int getQueuedAlerts()
+{
+    taskENTER_CRITICAL(&alertsMux);
+    int count = queueCount;
+    taskEXIT_CRITICAL(&alertsMux);
+    return count;
+}
+
+uint32_t getWebhookCount(WebhookResult result)
+{
+    return webhookCounts[result].load(std::memory_order_relaxed);
+}
+
+// Write thresholds and URL, see json_file.h for what a power cut leaves
+void saveAlertsIfDirty()
+{
+    if (!alertsDirty)
+    {
+        return;
+    }
+    alertsDirty = false;
+
+    JsonDocument jsonDoc;
+    char url[WEBHOOK_URL_SIZE];
+    getWebhookUrl(url, sizeof(url));
+    jsonDoc["webhook"] = url;
+
+    // Limits that are not set are left out
+    JsonArray cells = jsonDoc["load_cells"].to<JsonArray>();
+    for (int i = 0; i < numAlertCells; ++i)
+    {
+        AlertThresholds thresholds = cellThresholds[i].read();
+        JsonObject cell = cells.add<JsonObject>();
+        cell["id"] = i + 1;
+        if (!isnan(thresholds.low))
+        {
+            cell["low"] = thresholds.low;
+        }
+        if (!isnan(thresholds.high))
+        {
+            cell["high"] = thresholds.high;
+        }
+        cell["hysteresis"] = thresholds.hysteresis;
+    }
+
+    if (!writeJsonFile(ALERTS_PATH, jsonDoc))
+    {
+        alertsDirty = true; // Try again next time
+    }
+}
+
+/* Delivery */
+
+// Called from the sampler task, never waits for the network
+static void queueAlert(int index, AlertLevel level, float weight, float threshold, uint32_t timestamp)
+{
+    taskENTER_CRITICAL(&alertsMux);
+    if (webhookUrl[0] == '\0')
+    {
+        taskEXIT_CRITICAL(&alertsMux);
+        return;
+    }
+
+    // Drop the oldest, the latest level of a cell matters most
+    if (queueCount == ALERT_QUEUE_SIZE)
+    {
+        queueHead = (queueHead + 1) % ALERT_QUEUE_SIZE;
+        queueCount--;
+        webhookCounts[WEBHOOK_DROPPED].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    AlertEvent &event = queue[(queueHead + queueCount) % ALERT_QUEUE_SIZE];
+    event.sequence = ++lastSequence;
+    event.timestamp = timestamp;
+    event.weight = weight;
+    event.threshold = threshold;
+    event.cell = index;
+    event.level = level;
+    queueCount++;
+    taskEXIT_CRITICAL(&alertsMux);
+
+    if (webhookTaskHandle != nullptr)
+    {
+        xTaskNotifyGive(webhookTaskHandle);
+    }
+}
+
+// Copy the oldest alert and the URL to send it to, false if there is none
+static bool peekAlert(AlertEvent &event, char *url)
+{
+    taskENTER_CRITICAL(&alertsMux);
+    bool found = queueCount > 0;
+    if (found)
+    {
+        event = queue[queueHead];
+        strcpy(url, webhookUrl);
+    }
+    taskEXIT_CRITICAL(&alertsMux);
+    return found;
+}
+
+// Remove a delivered alert, unless it was dropped while it was being sent
+static void popAlert(uint32_t sequence)
+{
+    taskENTER_CRITICAL(&alertsMux);
+    if (queueCount > 0 && queue[queueHead].sequence == sequence)
+    {
+        queueHead = (queueHead + 1) % ALERT_QUEUE_SIZE;
+        queueCount--;
+    }
+    taskEXIT_CRITICAL(&alertsMux);
+}
+
+// Send queued alerts one at a time, in order
+static void webhookTask(void *parameter)
+{
+    AlertEvent event;
+    char url[WEBHOOK_URL_SIZE];
+
+    for (;;)
+    {
+        if (!peekAlert(event, url))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        deliverAlert(event, url);
+        popAlert(event.sequence);
+    }
+}
+
+// Post an alert, retrying with a growing delay
+static void deliverAlert(const AlertEvent &event, const char *url)
+{
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatAlertEvent(body, sizeof(body), event);
+
+    uint32_t retryMs = WEBHOOK_RETRY_MS;
+    for (int attempt = 1;; ++attempt)
+    {
+        int code = postAlert(url, body, length);
+        if (code >= 200 && code < 300)
+        {
+            webhookCounts[WEBHOOK_SENT].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Serial.printf("Webhook attempt %d for alert %lu failed: %d\n", attempt, (unsigned long)event.sequence, code);
+        if (attempt == WEBHOOK_MAX_ATTEMPTS)
+        {
+            webhookCounts[WEBHOOK_FAILED].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        webhookCounts[WEBHOOK_RETRIED].fetch_add(1, std::memory_order_relaxed);
+        vTaskDelay(pdMS_TO_TICKS(retryMs));
+        retryMs *= 2;
+    }
+}
+
+// Status code of the webhook, or a negative HTTPClient error
+static int postAlert(const char *url, const char *body, size_t length)
+{
+    if (!WiFi.isConnected())
+    {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+
+    HTTPClient http;
+    http.setConnectTimeout(WEBHOOK_TIMEOUT_MS);
+    http.setTimeout(WEBHOOK_TIMEOUT_MS);
+    if (!http.begin(url))
+    {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    http.addHeader("Content-Type", "application/json");
+    int code = http.POST((uint8_t *)body, length);
+    http.end();
+    return code;
+}
+
+// Plain HTTP only, the station does not carry CA certificates
+static bool isWebhookUrl(const char *url)
+{
+    size_t length = strlen(url);
+    return length < WEBHOOK_URL_SIZE && strncmp(url, "http://", 7) == 0 && length > 7;
+}
@@ -0,0 +1,88 @@
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "readings.h"
+
+// Thresholds and webhook URL on SPIFFS, next to the calibration
+#define ALERTS_PATH "/alerts.json"
+
+// Longest webhook URL, including the terminating NUL
+#define WEBHOOK_URL_SIZE 128
+
+// Alerts waiting for delivery, the oldest is dropped when full
+#define ALERT_QUEUE_SIZE 16
+
+// Delivery of one alert: attempts, the delay before the first retry
+// (doubled after each further failure) and the timeout of each attempt
+#define WEBHOOK_MAX_ATTEMPTS 4
+#define WEBHOOK_RETRY_MS 1000
+#define WEBHOOK_TIMEOUT_MS 2000
+
+// Hysteresis of new thresholds, in grams
+#define ALERT_DEFAULT_HYSTERESIS 5.0f
+
+// Limits of one cell in grams, NAN if not set
+struct AlertThresholds
+{
+    float low;        // alert when the stable weight drops below
+    float high;       // alert when the stable weight rises above
+    float hysteresis; // distance back past a limit before the cell is normal again
+};
+
+enum AlertLevel : uint8_t
+{
+    LEVEL_NORMAL,
+    LEVEL_LOW,
+    LEVEL_HIGH,
+};
+
+// A cell changing its level, as posted to the webhook
+struct AlertEvent
+{
+    uint32_t sequence; // counts alerts since boot, starting at 1
+    uint32_t timestamp;
+    float weight;
+    float threshold; // limit that was crossed
+    uint8_t cell;    // index, ID - 1
+    uint8_t level;   // AlertLevel entered
+};
+
+enum WebhookResult
+{
+    WEBHOOK_SENT,    // answered with 2xx
+    WEBHOOK_RETRIED, // attempt failed, tried again
+    WEBHOOK_FAILED,  // given up after WEBHOOK_MAX_ATTEMPTS
+    WEBHOOK_DROPPED, // pushed out of a full queue
+    WEBHOOK_RESULT_COUNT
+};
+
+// Restore thresholds and URL, in setup() before the sampler starts
+void loadAlerts(int numCells);
+void startAlerts();
+
+// Sampler task only, called with each published reading
+void updateAlerts(int index, const LoadCellReading &reading);
+
+void setAlertThresholds(int index, const AlertThresholds &thresholds);
+AlertThresholds getAlertThresholds(int index);
+AlertLevel getAlertLevel(int index);
+
+// Inline, so the response formatting links without the webhook code
+inline const char *getAlertLevelName(AlertLevel level)
+{
+    static const char *names[] = {"normal", "low", "high"};
+    return names[level];
+}
+
+// Empty URL disables the webhook, returns false if it is not http:// or too long
+bool setWebhookUrl(const char *url);
+void getWebhookUrl(char *out, size_t size);
+int getQueuedAlerts();
+uint32_t getWebhookCount(WebhookResult result);
+
+// Changes are written later from loop(), like the calibration
+void saveAlertsIfDirty();
+
+#endif
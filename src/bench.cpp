@@ -0,0 +1,190 @@
+#include <Arduino.h>
+#include <algorithm>
+#include "bench.h"
+#include "filters.h"
+#include "json_writer.h"
+#include "responses.h"
+#include "sampler.h"
+#include "stability.h"
+
+// One benchmark, called once per iteration. Returns the bytes produced
+// (body length for the JSON benchmarks, 0 otherwise).
+typedef size_t (*BenchFunction)(int iteration);
+
+struct Benchmark
+{
+    const char *name;
+    BenchFunction run;
+};
+
+// Function Prototypes
+static size_t benchSnapshot(int iteration);
+static size_t benchWeightsJson(int iteration);
+static size_t benchWeightJson(int iteration);
+static size_t benchSelectedWeightsJson(int iteration);
+static size_t benchErrorJson(int iteration);
+static size_t benchSamplePipeline(int iteration);
+static void writeBenchmark(JsonWriter &json, const Benchmark &benchmark, uint32_t iterations);
+static void writeSampleRates(JsonWriter &json);
+static uint32_t elapsedNs(uint32_t startCycles, uint32_t endCycles);
+
+static const Benchmark benchmarks[] = {
+    {"snapshot", benchSnapshot},                            // getLatestReading() of every cell
+    {"weights_json", benchWeightsJson},                     // body of GET /weight
+    {"weight_json", benchWeightJson},                       // body of GET /weight/ID
+    {"selected_weights_json", benchSelectedWeightsJson},    // body of GET /weight?fields=... with all fields
+    {"error_json", benchErrorJson},                         // body of sendErrorResponse()
+    {"sample_pipeline", benchSamplePipeline},               // filter chain and stability update of one sample
+};
+
+// State shared by the benchmarks of one run
+static int benchCells;
+static LoadCellReading benchReadings[MAX_LOAD_CELLS];
+static char benchBody[RESPONSE_BUFFER_SIZE];
+static FilterChain benchFilter;
+static StabilityDetector benchStability;
+
+static uint32_t durations[BENCH_MAX_ITERATIONS];
+
+// Sample counts at the previous run, for the samples/s window
+static uint32_t lastSampleCounts[MAX_LOAD_CELLS];
+static uint32_t lastSampleTime;
+
+static portMUX_TYPE benchMux = portMUX_INITIALIZER_UNLOCKED;
+static bool benchRunning = false;
+
+size_t runBenchmarks(char *out, size_t size, int numCells, uint32_t iterations)
+{
+    taskENTER_CRITICAL(&benchMux);
+    bool busy = benchRunning;
+    benchRunning = true;
+    taskEXIT_CRITICAL(&benchMux);
+    if (busy)
+    {
+        return 0;
+    }
+
+    benchCells = min(numCells, MAX_LOAD_CELLS);
+    iterations = constrain(iterations, 1, BENCH_MAX_ITERATIONS);
+    for (int i = 0; i < benchCells; ++i)
+    {
+        benchReadings[i] = getLatestReading(i);
+    }
+    benchFilter.configure(getFilterConfig(0));
+    benchStability.reset();
+
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("iterations", (unsigned long)iterations);
+    json.add("cpu_mhz", (unsigned long)ESP.getCpuFreqMHz());
+    json.beginArray("benchmarks");
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        writeBenchmark(json, benchmark, iterations);
+    }
+    json.endArray();
+    writeSampleRates(json);
+    json.add("free_heap", (unsigned long)ESP.getFreeHeap());
+    json.add("min_free_heap", (unsigned long)ESP.getMinFreeHeap());
+    json.endObject();
+
+    taskENTER_CRITICAL(&benchMux);
+    benchRunning = false;
+    taskEXIT_CRITICAL(&benchMux);
+
+    return json.length();
+}
+
+// Run one benchmark and write {"name","p50_ns","p90_ns","p99_ns","max_ns","bytes","heap_bytes"}
+static void writeBenchmark(JsonWriter &json, const Benchmark &benchmark, uint32_t iterations)
+{
+    size_t bytes = 0;
+    uint32_t freeHeap = ESP.getFreeHeap();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        uint32_t start = ESP.getCycleCount();
+        bytes = benchmark.run(i);
+        durations[i] = elapsedNs(start, ESP.getCycleCount());
+    }
+    long heapBytes = (long)freeHeap - (long)ESP.getFreeHeap();
+
+    std::sort(durations, durations + iterations);
+    json.beginObject();
+    json.add("name", benchmark.name);
+    json.add("p50_ns", (unsigned long)durations[iterations * 50 / 100]);
+    json.add("p90_ns", (unsigned long)durations[iterations * 90 / 100]);
+    json.add("p99_ns", (unsigned long)durations[iterations * 99 / 100]);
+    json.add("max_ns", (unsigned long)durations[iterations - 1]);
+    json.add("bytes", (unsigned long)bytes);
+    json.add("heap_bytes", heapBytes);
+    json.endObject();
+}
+
+// Raw readings per second of every cell since the previous run
+static void writeSampleRates(JsonWriter &json)
+{
+    uint32_t now = millis();
+    uint32_t window = now - lastSampleTime;
+
+    json.add("window_ms", (unsigned long)window);
+    json.beginArray("samples_per_second");
+    for (int i = 0; i < benchCells; ++i)
+    {
+        uint32_t count = getSampleCount(i);
+        json.add(nullptr, window > 0 ? (count - lastSampleCounts[i]) * 1000.0 / window : 0.0, 1);
+        lastSampleCounts[i] = count;
+    }
+    json.endArray();
+    lastSampleTime = now;
+}
+
+static uint32_t elapsedNs(uint32_t startCycles, uint32_t endCycles)
+{
+    return (uint64_t)(endCycles - startCycles) * 1000 / ESP.getCpuFreqMHz();
+}
+
+/* Benchmarks */
+
+static size_t benchSnapshot(int iteration)
+{
+    for (int i = 0; i < benchCells; ++i)
+    {
+        benchReadings[i] = getLatestReading(i);
+    }
+    return 0;
+}
+
+static size_t benchWeightsJson(int iteration)
+{
+    return formatWeights(benchBody, sizeof(benchBody), benchReadings, benchCells);
+}
+
+static size_t benchWeightJson(int iteration)
+{
+    return formatWeight(benchBody, sizeof(benchBody), 1, benchReadings[0].weight, benchReadings[0].stable);
+}
+
+static size_t benchSelectedWeightsJson(int iteration)
+{
+    int ids[MAX_LOAD_CELLS];
+    for (int i = 0; i < benchCells; ++i)
+    {
+        ids[i] = i + 1;
+    }
+    uint8_t fields = FIELD_WEIGHT | FIELD_STABLE | FIELD_RAW | FIELD_TIMESTAMP;
+    return formatSelectedWeights(benchBody, sizeof(benchBody), ids, benchReadings, benchCells, fields);
+}
+
+static size_t benchErrorJson(int iteration)
+{
+    return formatError(benchBody, sizeof(benchBody), "Invalid load cell ID");
+}
+
+// Same work as the sampler does per sample, on a private filter chain fed
+// with a slowly moving weight so the median and stability window stay busy
+static size_t benchSamplePipeline(int iteration)
+{
+    float weight = benchFilter.update(benchReadings[0].weight + (iteration % 7) * 0.1f);
+    benchStability.update(weight, iteration * 100);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Iterations of each benchmark, the duration of every iteration is kept
+// for the percentiles
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_MAX_ITERATIONS 1000
+
+// Large enough for the results of runBenchmarks() with MAX_LOAD_CELLS cells
+#define BENCH_RESULT_SIZE 1536
+
+// Time the work behind the hot routes (reading snapshots, JSON bodies, the
+// per-sample filter and stability update) on the running firmware and write
+// the results as JSON: percentiles in ns, body size, free heap lost during
+// each benchmark, and raw samples/s per cell since the previous run (or boot).
+// Returns 0 if a run from another task is in progress.
+size_t runBenchmarks(char *out, size_t size, int numCells, uint32_t iterations);
+
+#endif
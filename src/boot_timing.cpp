@@ -0,0 +1,50 @@
+#include "boot_timing.h"
+
+static const char *const phaseNames[BOOT_PHASE_COUNT] = {
+    "filesystem",
+    "display",
+    "scales",
+    "first_reading",
+    "wifi",
+    "server",
+};
+
+// Written once per phase, possibly from different tasks
+static volatile uint32_t phaseTimes[BOOT_PHASE_COUNT];
+
+void markBootPhase(BootPhase phase)
+{
+    if (phaseTimes[phase] == 0)
+    {
+        // 0 means not reached, a phase done within the first millisecond counts as 1
+        uint32_t now = millis();
+        phaseTimes[phase] = now != 0 ? now : 1;
+    }
+}
+
+uint32_t getBootPhaseTime(BootPhase phase)
+{
+    return phaseTimes[phase];
+}
+
+const char *getBootPhaseName(BootPhase phase)
+{
+    return phaseNames[phase];
+}
+
+void printBootTimes()
+{
+    Serial.println("Boot times (ms since power on):");
+    for (int i = 0; i < BOOT_PHASE_COUNT; ++i)
+    {
+        uint32_t time = phaseTimes[i];
+        if (time != 0)
+        {
+            Serial.printf("  %-14s %6lu\n", phaseNames[i], (unsigned long)time);
+        }
+        else
+        {
+            Serial.printf("  %-14s pending\n", phaseNames[i]);
+        }
+    }
+}
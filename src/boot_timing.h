@@ -0,0 +1,26 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <Arduino.h>
+
+// Startup milestones, each recorded once as millis() since power on
+enum BootPhase
+{
+    BOOT_FILESYSTEM,    // SPIFFS mounted
+    BOOT_DISPLAY,       // OLED initialized
+    BOOT_SCALES,        // calibration restored and new cells tared
+    BOOT_FIRST_READING, // first sample published by the sampler task
+    BOOT_WIFI,          // first IP address received
+    BOOT_SERVER,        // HTTP server listening
+    BOOT_PHASE_COUNT
+};
+
+void markBootPhase(BootPhase phase);
+
+// Time the phase was reached, 0 if it has not been reached yet
+uint32_t getBootPhaseTime(BootPhase phase);
+const char *getBootPhaseName(BootPhase phase);
+
+void printBootTimes();
+
+#endif
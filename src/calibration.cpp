@@ -0,0 +1,73 @@
+#include <math.h>
+#include "calibration.h"
+
+const char *getCalibrationStateName(CalibrationState state)
+{
+    static const char *names[] = {"idle", "collecting", "waiting", "calibrated", "failed"};
+    return names[state];
+}
+
+// nullptr for CALIBRATION_OK
+const char *getCalibrationErrorName(CalibrationError error)
+{
+    static const char *names[] = {nullptr, "disconnected", "gain changed", "no response to the mass", "readings too noisy"};
+    return names[error];
+}
+
+CalibrationFit::CalibrationFit()
+{
+    reset();
+}
+
+void CalibrationFit::reset()
+{
+    reference = 0;
+    count = 0;
+    sumX = 0;
+    sumY = 0;
+    sumXX = 0;
+    sumXY = 0;
+    sumYY = 0;
+}
+
+void CalibrationFit::add(float grams, long raw)
+{
+    if (count == 0)
+    {
+        reference = raw;
+    }
+    double x = grams;
+    double y = raw - reference;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+    sumYY += y * y;
+    count++;
+}
+
+bool CalibrationFit::solve(float &factor, long &offset, float &residual) const
+{
+    if (count < 2)
+    {
+        return false;
+    }
+
+    // Sums of squares around the means
+    double meanX = sumX / count;
+    double meanY = sumY / count;
+    double varianceX = sumXX - meanX * sumX;
+    double covariance = sumXY - meanX * sumY;
+    double varianceY = sumYY - meanY * sumY;
+    if (varianceX <= 0)
+    {
+        return false;
+    }
+
+    double slope = covariance / varianceX;
+    double squaredError = varianceY - slope * covariance;
+    factor = (float)slope;
+    offset = reference + lround(meanY - slope * meanX);
+    residual = slope != 0 ? (float)(sqrt(fmax(squaredError, 0.0) / count) / fabs(slope)) : INFINITY;
+    return true;
+}
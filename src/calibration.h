@@ -0,0 +1,79 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+
+// Readings collected per cell at each mass of a calibration run
+#define CALIBRATION_DEFAULT_SAMPLES 50
+#define CALIBRATION_MAX_SAMPLES 1000
+
+// Readings during this time after a request are skipped, the plate may
+// still swing from putting the mass on
+#define CALIBRATION_SETTLE_MS 500
+
+// Fits are rejected if the readings scatter more than this around the line,
+// e.g. because the plate was touched, or if the cell barely responded to the
+// mass (less than one count per gram, the mass was probably not on it)
+#define CALIBRATION_MAX_RESIDUAL_GRAMS 2.0f
+#define CALIBRATION_MIN_FACTOR 1.0f
+
+enum CalibrationState : uint8_t
+{
+    CALIBRATION_IDLE,       // not part of a run
+    CALIBRATION_COLLECTING, // taking readings at the current mass
+    CALIBRATION_WAITING,    // zero measured, waiting for a known mass
+    CALIBRATION_CALIBRATED, // fit applied, more masses refine it
+    CALIBRATION_FAILED,
+};
+
+enum CalibrationError : uint8_t
+{
+    CALIBRATION_OK,
+    CALIBRATION_DISCONNECTED, // the cell stopped sending readings
+    CALIBRATION_GAIN_CHANGED, // readings before and after are not comparable
+    CALIBRATION_NO_RESPONSE,  // factor below CALIBRATION_MIN_FACTOR
+    CALIBRATION_UNSTABLE,     // residual above CALIBRATION_MAX_RESIDUAL_GRAMS
+};
+
+// Progress and result of the calibration run of one cell
+struct CalibrationStatus
+{
+    CalibrationState state;
+    CalibrationError error;
+    uint8_t points;     // masses measured, the zero included
+    uint16_t remaining; // readings still to collect at the current mass
+    float grams;        // current or last mass
+    float factor;       // result of the last fit, raw counts per gram
+    long offset;        // raw value at zero load
+    float residual;     // RMS distance of the readings from the fit, in grams
+};
+
+const char *getCalibrationStateName(CalibrationState state);
+const char *getCalibrationErrorName(CalibrationError error);
+
+// Least squares line through raw readings taken at known masses,
+// raw = offset + factor * grams. Readings are summed relative to the first
+// one, so the sums stay exact in a double however many there are.
+class CalibrationFit
+{
+public:
+    CalibrationFit();
+    void reset();
+
+    void add(float grams, long raw);
+    uint32_t getCount() const { return count; }
+
+    // False if the readings were all taken at the same mass
+    bool solve(float &factor, long &offset, float &residual) const;
+
+private:
+    long reference;
+    uint32_t count;
+    double sumX;
+    double sumY;
+    double sumXX;
+    double sumXY;
+    double sumYY;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "calibration_store.h"
+#include "cell_config.h"
+#include "json_file.h"
+#include "readings.h"
+#include "sampler.h"
+
+// External Variables
+extern CellConfig cellConfig; // Defined in main.cpp
+
+static volatile bool calibrationDirty = false;
+static volatile bool calibrationDrifted = false;
+static uint32_t lastCalibrationSave = 0;
+
+// Read stored factors, offsets and gains. Cells missing from the file, or
+// stored for another DOUT pin since the layout changed, keep the factor and
+// gain passed in and get hasOffset = false, so they are tared at boot.
+bool loadCalibration(float factors[], long offsets[], bool hasOffset[], uint8_t gains[], const uint8_t doutPins[], int numCells)
+{
+    for (int i = 0; i < numCells; ++i)
+    {
+        hasOffset[i] = false;
+    }
+
+    JsonDocument jsonDoc;
+    if (!readJsonFile(CALIBRATION_PATH, jsonDoc))
+    {
+        Serial.println("No stored calibration, using defaults");
+        return false;
+    }
+
+    for (JsonObject cell : jsonDoc["load_cells"].as<JsonArray>())
+    {
+        int index = cell["id"].as<int>() - 1;
+        if (index < 0 || index >= numCells || (cell["dout"].is<int>() && cell["dout"].as<int>() != doutPins[index]))
+        {
+            continue;
+        }
+
+        if (cell["calibration_factor"].is<float>())
+        {
+            factors[index] = cell["calibration_factor"].as<float>();
+        }
+        int gain = cell["gain"] | 0;
+        if (gain == 128 || gain == 64 || gain == 32)
+        {
+            gains[index] = gain;
+        }
+        if (cell["offset"].is<long>())
+        {
+            offsets[index] = cell["offset"].as<long>();
+            hasOffset[index] = true;
+        }
+    }
+
+    Serial.println("Calibration restored from SPIFFS");
+    return true;
+}
+
+// Write factors, offsets and gains. A power cut while saving leaves either
+// the old or the new file, see json_file.h
+bool saveCalibration(const float factors[], const long offsets[], const uint8_t gains[], const uint8_t doutPins[], int numCells)
+{
+    JsonDocument jsonDoc;
+    JsonArray cells = jsonDoc["load_cells"].to<JsonArray>();
+    for (int i = 0; i < numCells; ++i)
+    {
+        JsonObject cell = cells.add<JsonObject>();
+        cell["id"] = i + 1;
+        cell["dout"] = doutPins[i];
+        cell["calibration_factor"] = factors[i];
+        cell["offset"] = offsets[i];
+        cell["gain"] = gains[i];
+    }
+
+    return writeJsonFile(CALIBRATION_PATH, jsonDoc);
+}
+
+void markCalibrationDirty()
+{
+    calibrationDirty = true;
+}
+
+void markCalibrationDrifted()
+{
+    calibrationDrifted = true;
+}
+
+// Persist the current factors and offsets if anything changed, zero
+// corrections only every CALIBRATION_DRIFT_SAVE_MS
+void saveCalibrationIfDirty()
+{
+    bool drifted = calibrationDrifted && millis() - lastCalibrationSave >= CALIBRATION_DRIFT_SAVE_MS;
+    if (!calibrationDirty && !drifted)
+    {
+        return;
+    }
+    calibrationDirty = false;
+    calibrationDrifted = false;
+    lastCalibrationSave = millis();
+
+    // The calibration the sampler is using, as published with the readings
+    float factors[MAX_LOAD_CELLS];
+    long offsets[MAX_LOAD_CELLS];
+    uint8_t gains[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        LoadCellReading reading = getLatestReading(i);
+        factors[i] = reading.factor;
+        offsets[i] = reading.offset;
+        gains[i] = getAcquisitionStatus(i).gain;
+    }
+
+    if (!saveCalibration(factors, offsets, gains, cellConfig.doutPins, cellConfig.count))
+    {
+        calibrationDirty = true; // Try again next time
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <Arduino.h>
+
+// Calibration factors, zero offsets and the gain they belong to on SPIFFS,
+// next to the WiFi credentials
+#define CALIBRATION_PATH "/calibration.json"
+
+bool loadCalibration(float factors[], long offsets[], bool hasOffset[], uint8_t gains[], const uint8_t doutPins[], int numCells);
+bool saveCalibration(const float factors[], const long offsets[], const uint8_t gains[], const uint8_t doutPins[], int numCells);
+
+// Zero corrections by auto-zero and the drift model are small and frequent,
+// they are written at most this often to spare the flash
+#define CALIBRATION_DRIFT_SAVE_MS 600000
+
+// Changes are flagged from any task and written later from loop()
+void markCalibrationDirty();
+void markCalibrationDrifted();
+void saveCalibrationIfDirty();
+
+#endif
@@ -0,0 +1,201 @@
+#include <string.h>
+#include "capture.h"
+
+// Little-endian helpers, independent of the host byte order
+static void putU32(uint8_t *out, uint32_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static size_t putVarint(uint8_t *out, uint32_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+CaptureBuffer::CaptureBuffer()
+    : samples(nullptr), capacity(0), maxSamples(0), startUs(0), numCells(0), count(0), generation(0), running(false)
+{
+}
+
+bool CaptureBuffer::allocate(uint32_t capacity, void *(*allocator)(size_t))
+{
+    if (samples == nullptr)
+    {
+        samples = (CaptureSample *)allocator(capacity * sizeof(CaptureSample));
+        this->capacity = samples != nullptr ? capacity : 0;
+    }
+    return samples != nullptr;
+}
+
+void CaptureBuffer::start(uint8_t numCells, uint32_t maxSamples, uint32_t nowUs)
+{
+    running.store(false, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_acq_rel);
+
+    this->numCells = numCells;
+    this->maxSamples = maxSamples < capacity ? maxSamples : capacity;
+    startUs = nowUs;
+    count.store(0, std::memory_order_release);
+
+    running.store(this->maxSamples > 0, std::memory_order_release);
+}
+
+void CaptureBuffer::stop()
+{
+    running.store(false, std::memory_order_release);
+}
+
+void CaptureBuffer::record(uint8_t cell, long raw, uint32_t nowUs)
+{
+    if (!running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    uint32_t i = count.load(std::memory_order_relaxed);
+    samples[i].timeUs = nowUs - startUs;
+    samples[i].raw = raw;
+    samples[i].cell = cell;
+
+    // Publish the record before readers may see it
+    count.store(i + 1, std::memory_order_release);
+    if (i + 1 >= maxSamples)
+    {
+        running.store(false, std::memory_order_release);
+    }
+}
+
+bool CaptureBuffer::isGeneration(uint32_t generation) const
+{
+    // Keeps the sample reads before it from moving past the check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->generation.load(std::memory_order_relaxed) == generation;
+}
+
+void CaptureBuffer::writeHeader(uint8_t *out, const char *magic, uint32_t n) const
+{
+    memcpy(out, magic, 4);
+    out[4] = numCells;
+    out[5] = out[6] = out[7] = 0;
+    putU32(out + 8, n);
+    putU32(out + 12, startUs);
+}
+
+size_t CaptureBuffer::rawSize(uint32_t n) const
+{
+    return CAPTURE_HEADER_SIZE + (size_t)n * CAPTURE_RECORD_SIZE;
+}
+
+// Copy bytes [offset, offset + maxLen) of the fixed-record download into out
+size_t CaptureBuffer::readRaw(uint8_t *out, size_t maxLen, size_t offset, uint32_t n) const
+{
+    size_t total = rawSize(n);
+    size_t written = 0;
+
+    while (written < maxLen && offset < total)
+    {
+        uint8_t chunk[CAPTURE_HEADER_SIZE];
+        size_t chunkStart;
+        size_t chunkSize;
+
+        if (offset < CAPTURE_HEADER_SIZE)
+        {
+            writeHeader(chunk, "HXC1", n);
+            chunkStart = 0;
+            chunkSize = CAPTURE_HEADER_SIZE;
+        }
+        else
+        {
+            size_t record = (offset - CAPTURE_HEADER_SIZE) / CAPTURE_RECORD_SIZE;
+            const CaptureSample &s = samples[record];
+            putU32(chunk, s.timeUs);
+            chunk[4] = s.cell;
+            chunk[5] = s.raw;
+            chunk[6] = s.raw >> 8;
+            chunk[7] = s.raw >> 16;
+            chunkStart = CAPTURE_HEADER_SIZE + record * CAPTURE_RECORD_SIZE;
+            chunkSize = CAPTURE_RECORD_SIZE;
+        }
+
+        size_t from = offset - chunkStart;
+        size_t length = chunkSize - from;
+        if (length > maxLen - written)
+        {
+            length = maxLen - written;
+        }
+        memcpy(out + written, chunk + from, length);
+        written += length;
+        offset += length;
+    }
+    return written;
+}
+
+static_assert(CAPTURE_HEADER_SIZE >= CAPTURE_DELTA_MAX_RECORD_SIZE, "pending holds one record");
+
+CaptureDeltaEncoder::CaptureDeltaEncoder(const CaptureBuffer &buffer, uint32_t n)
+    : buffer(buffer), n(n), next(0), headerSent(false), lastTimeUs(0), lastRaw(), pendingLength(0), pendingOffset(0)
+{
+}
+
+size_t CaptureDeltaEncoder::read(uint8_t *out, size_t maxLen)
+{
+    size_t written = 0;
+    while (written < maxLen)
+    {
+        if (pendingOffset == pendingLength && !fill())
+        {
+            break;
+        }
+        size_t length = pendingLength - pendingOffset;
+        if (length > maxLen - written)
+        {
+            length = maxLen - written;
+        }
+        memcpy(out + written, pending + pendingOffset, length);
+        pendingOffset += length;
+        written += length;
+    }
+    return written;
+}
+
+// Encode the header or the next record into pending, false after the last
+bool CaptureDeltaEncoder::fill()
+{
+    pendingOffset = 0;
+    pendingLength = 0;
+
+    if (!headerSent)
+    {
+        buffer.writeHeader(pending, "HXD1", n);
+        pendingLength = CAPTURE_HEADER_SIZE;
+        headerSent = true;
+        return true;
+    }
+    if (next >= n)
+    {
+        return false;
+    }
+
+    const CaptureSample &s = buffer.sample(next++);
+    int32_t raw = s.raw;
+    int32_t delta = raw - lastRaw[s.cell];
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+    pending[pendingLength++] = s.cell;
+    pendingLength += putVarint(pending + pendingLength, s.timeUs - lastTimeUs);
+    pendingLength += putVarint(pending + pendingLength, zigzag);
+
+    lastTimeUs = s.timeUs;
+    lastRaw[s.cell] = raw;
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "readings.h"
+
+// Samples the capture buffer is allocated for (8 bytes each)
+#define CAPTURE_MAX_SAMPLES 6000
+
+// Header of both download formats (little-endian, 16 bytes):
+//   char magic[4]      "HXC1" fixed records, "HXD1" delta encoded
+//   uint8 numCells, uint8 reserved[3]
+//   uint32 sampleCount
+//   uint32 startUs     micros() when the capture started
+#define CAPTURE_HEADER_SIZE 16
+
+// Fixed record (8 bytes): uint32 timeUs since start, uint8 cell, int24 raw
+#define CAPTURE_RECORD_SIZE 8
+
+// Delta record: uint8 cell, varint microseconds since the previous record,
+// zigzag varint raw difference to the previous record of the same cell
+#define CAPTURE_DELTA_MAX_RECORD_SIZE 11
+
+// One raw HX711 reading with its time of capture
+struct CaptureSample
+{
+    uint32_t timeUs;  // since the start of the capture
+    int32_t raw : 24; // HX711 values are 24 bit
+    uint32_t cell : 8;
+};
+
+// One-shot recording of raw readings of all cells. The sampler task appends,
+// the web server reads the samples recorded so far; records never move once
+// written so a download can run while the capture is still going.
+class CaptureBuffer
+{
+public:
+    CaptureBuffer();
+
+    // Allocate the sample storage once, returns false if out of memory
+    bool allocate(uint32_t capacity, void *(*allocator)(size_t));
+
+    // Start a new capture of at most maxSamples, discarding the previous one
+    void start(uint8_t numCells, uint32_t maxSamples, uint32_t nowUs);
+    void stop();
+
+    // Append a reading, stops the capture when full
+    void record(uint8_t cell, long raw, uint32_t nowUs);
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    uint32_t getCount() const { return count.load(std::memory_order_acquire); }
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getMaxSamples() const { return maxSamples; }
+    uint32_t getGeneration() const { return generation.load(std::memory_order_acquire); }
+    // True while no new capture started since getGeneration() returned
+    // generation. Checked after copying samples, like a seqlock reader.
+    bool isGeneration(uint32_t generation) const;
+    uint8_t getNumCells() const { return numCells; }
+    uint32_t getStartUs() const { return startUs; }
+    const CaptureSample &sample(uint32_t i) const { return samples[i]; }
+
+    // Size and content of the fixed-record download for the first n samples
+    size_t rawSize(uint32_t n) const;
+    size_t readRaw(uint8_t *out, size_t maxLen, size_t offset, uint32_t n) const;
+
+    void writeHeader(uint8_t *out, const char *magic, uint32_t n) const;
+
+private:
+    CaptureSample *samples;
+    uint32_t capacity;
+    uint32_t maxSamples;
+    uint32_t startUs;
+    uint8_t numCells;
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> generation; // bumped on every start, lets downloads detect a restart
+    std::atomic<bool> running;
+};
+
+// Streams the first n samples of a capture in the delta encoded format
+class CaptureDeltaEncoder
+{
+public:
+    CaptureDeltaEncoder(const CaptureBuffer &buffer, uint32_t n);
+
+    // Fill out with the next bytes, returns 0 when done. A record that does
+    // not fit is continued on the next call, so any maxLen works.
+    size_t read(uint8_t *out, size_t maxLen);
+
+private:
+    const CaptureBuffer &buffer;
+    uint32_t n;
+    uint32_t next;
+    bool headerSent;
+    uint32_t lastTimeUs;
+    int32_t lastRaw[MAX_LOAD_CELLS];
+    uint8_t pending[CAPTURE_HEADER_SIZE]; // the header or one record
+    size_t pendingLength;
+    size_t pendingOffset;
+
+    bool fill();
+};
+
+#endif
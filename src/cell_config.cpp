@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "FS.h"
+#include "SPIFFS.h"
+#include "cell_config.h"
+
+// Function Prototypes
+static bool isUsablePin(int pin, bool output);
+
+// Expected format, everything but dout and sck is optional:
+//   {"load_cells": [{"dout": 26, "sck": 27, "gain": 128, "calibration_factor": -410.0,
+//                    "rate_pin": 4, "mode": "auto", "auto_zero": true,
+//                    "drift": "temperature", "drift_rate": 0.05}, ...]}
+bool loadCellConfig(CellConfig &config)
+{
+    File file = SPIFFS.open(CELL_CONFIG_PATH, "r");
+    if (!file)
+    {
+        Serial.printf("No %s, using the built-in layout of %d load cells\n", CELL_CONFIG_PATH, config.count);
+        return false;
+    }
+
+    JsonDocument jsonDoc;
+    DeserializationError error = deserializeJson(jsonDoc, file);
+    file.close();
+    if (error)
+    {
+        Serial.printf("Failed to parse %s: %s\n", CELL_CONFIG_PATH, error.c_str());
+        return false;
+    }
+
+    JsonArray cells = jsonDoc["load_cells"].as<JsonArray>();
+    if (cells.size() == 0 || cells.size() > MAX_LOAD_CELLS)
+    {
+        Serial.printf("%s must list 1 to %d load cells\n", CELL_CONFIG_PATH, MAX_LOAD_CELLS);
+        return false;
+    }
+
+    // Parsed into a copy, a bad entry keeps the whole built-in layout
+    CellConfig parsed = {};
+    uint64_t usedPins = 0;
+    for (JsonObject cell : cells)
+    {
+        int index = parsed.count;
+        int dout = cell["dout"] | -1;
+        int sck = cell["sck"] | -1;
+        int gain = cell["gain"] | 128;
+        int ratePin = cell["rate_pin"] | -1;
+        AcquisitionMode mode = ACQUISITION_AUTO;
+        DriftConfig drift = DEFAULT_DRIFT_CONFIG;
+
+        if (!isUsablePin(dout, false) || !isUsablePin(sck, true) || dout == sck ||
+            (usedPins & (1ULL << dout)) || (usedPins & (1ULL << sck)))
+        {
+            Serial.printf("%s: load cell %d has invalid or reused pins\n", CELL_CONFIG_PATH, index + 1);
+            return false;
+        }
+        if (gain != 128 && gain != 64 && gain != 32)
+        {
+            Serial.printf("%s: load cell %d has gain %d, use 128, 64 or 32\n", CELL_CONFIG_PATH, index + 1, gain);
+            return false;
+        }
+        usedPins |= (1ULL << dout) | (1ULL << sck);
+
+        if (ratePin != -1 && (!isUsablePin(ratePin, true) || (usedPins & (1ULL << ratePin))))
+        {
+            Serial.printf("%s: load cell %d has an invalid or reused rate_pin\n", CELL_CONFIG_PATH, index + 1);
+            return false;
+        }
+        if (ratePin != -1)
+        {
+            usedPins |= 1ULL << ratePin;
+        }
+        if (!parseAcquisitionMode(cell["mode"] | "auto", mode))
+        {
+            Serial.printf("%s: load cell %d has an unknown mode, use auto, fast or slow\n", CELL_CONFIG_PATH, index + 1);
+            return false;
+        }
+        drift.autoZero = cell["auto_zero"] | true;
+        drift.rate = cell["drift_rate"] | 0.0f;
+        if (!parseDriftSource(cell["drift"] | "off", drift.source))
+        {
+            Serial.printf("%s: load cell %d has an unknown drift, use off, time or temperature\n", CELL_CONFIG_PATH, index + 1);
+            return false;
+        }
+
+        parsed.doutPins[index] = dout;
+        parsed.sckPins[index] = sck;
+        parsed.gains[index] = gain;
+        parsed.ratePins[index] = ratePin;
+        parsed.modes[index] = mode;
+        parsed.drifts[index] = drift;
+        parsed.factors[index] = cell["calibration_factor"] | (index < config.count ? config.factors[index] : 1.0f);
+        if (parsed.factors[index] == 0)
+        {
+            parsed.factors[index] = 1.0f;
+        }
+        parsed.count++;
+    }
+
+    config = parsed;
+    Serial.printf("Load cell layout read from %s: %d cells\n", CELL_CONFIG_PATH, config.count);
+    return true;
+}
+
+// The ESP32 has no GPIO 20, 24 or 28-31, 6-11 belong to the flash, 21 and 22
+// to the display's I2C bus, and 34-39 are inputs only
+static bool isUsablePin(int pin, bool output)
+{
+    bool missing = pin < 0 || pin > 39 || pin == 20 || pin == 24 || (pin >= 28 && pin <= 31);
+    bool taken = (pin >= 6 && pin <= 11) || pin == 21 || pin == 22;
+    if (missing || taken)
+    {
+        return false;
+    }
+    return !output || pin < 34;
+}
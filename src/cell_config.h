@@ -0,0 +1,31 @@
+#ifndef CELL_CONFIG_H
+#define CELL_CONFIG_H
+
+#include <stdint.h>
+#include "acquisition_status.h"
+#include "drift.h"
+#include "readings.h"
+
+// Layout of the load cells on SPIFFS, so a rig with a different number of
+// stations does not need its own firmware build
+#define CELL_CONFIG_PATH "/cells.json"
+
+// Load cells as parallel arrays indexed by cell (ID - 1). Filled once in
+// setup() before any task starts, read-only afterwards.
+struct CellConfig
+{
+    int count;
+    uint8_t doutPins[MAX_LOAD_CELLS];
+    uint8_t sckPins[MAX_LOAD_CELLS];
+    uint8_t gains[MAX_LOAD_CELLS]; // 128 or 64 for channel A, 32 for channel B, until /calibration.json has one
+    float factors[MAX_LOAD_CELLS]; // calibration factor until /calibration.json has one
+    int8_t ratePins[MAX_LOAD_CELLS]; // GPIO wired to RATE, -1 if the board ties it
+    AcquisitionMode modes[MAX_LOAD_CELLS];
+    DriftConfig drifts[MAX_LOAD_CELLS]; // auto-zero and drift model
+};
+
+// Replace config with the layout in CELL_CONFIG_PATH. Returns false and
+// leaves config alone if the file is missing or not a valid layout.
+bool loadCellConfig(CellConfig &config);
+
+#endif
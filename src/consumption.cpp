@@ -0,0 +1,175 @@
+#include <Arduino.h>
+#include <math.h>
+#include "consumption.h"
+
+// Event log and totals, written by the sampler task, read by the web server
+static LevelTracker trackers[MAX_LOAD_CELLS]; // owned by the sampler task
+static ConsumptionEvent eventLog[CONSUMPTION_LOG_SIZE];
+static ConsumptionSummary totals = {1, 0, 0, {}, {}};
+static portMUX_TYPE consumptionMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Function Prototypes
+static void addToTotals(ConsumptionTotals &sum, const ConsumptionEvent &event);
+
+/* Level Tracker */
+
+LevelTracker::LevelTracker()
+{
+    reset();
+    offset = 0;
+    factor = 0;
+}
+
+void LevelTracker::reset()
+{
+    hasLevel = false;
+    level = 0;
+    wasStable = false;
+    settled = false;
+    stableSince = 0;
+    leftAt = 0;
+}
+
+bool LevelTracker::update(const LoadCellReading &reading, ConsumptionEvent &event)
+{
+    // A new factor or a disconnect moves the weight without anything being
+    // used, start over from the next level
+    if (!reading.connected || reading.factor != factor)
+    {
+        reset();
+        offset = reading.offset;
+        factor = reading.factor;
+        return false;
+    }
+
+    // A new zero (tare, auto-zero, drift model) moves the level along
+    if (reading.offset != offset)
+    {
+        level -= (reading.offset - offset) / factor;
+        offset = reading.offset;
+    }
+
+    if (!reading.stable)
+    {
+        if (wasStable && settled)
+        {
+            leftAt = reading.timestamp;
+        }
+        wasStable = false;
+        return false;
+    }
+
+    if (!wasStable)
+    {
+        wasStable = true;
+        settled = false;
+        stableSince = reading.timestamp;
+    }
+    if (settled || reading.timestamp - stableSince < CONSUMPTION_SETTLE_MS)
+    {
+        return false;
+    }
+    settled = true;
+
+    // The published weight is clamped at zero, the raw value is not
+    if ((reading.raw - reading.offset) / reading.factor < CONSUMPTION_REMOVED_GRAMS)
+    {
+        return false;
+    }
+    if (!hasLevel)
+    {
+        hasLevel = true;
+        level = reading.weight;
+        return false;
+    }
+
+    // The level is kept on small changes, so they add up instead of vanishing
+    float change = reading.weight - level;
+    if (fabsf(change) < CONSUMPTION_MIN_GRAMS)
+    {
+        return false;
+    }
+
+    event.type = change < 0 ? EVENT_DIP : EVENT_REFILL;
+    event.grams = fabsf(change);
+    event.weight = reading.weight;
+    event.startMs = leftAt;
+    event.endMs = stableSince;
+    level = reading.weight;
+    return true;
+}
+
+/* Event Log */
+
+void updateConsumption(int index, const LoadCellReading &reading)
+{
+    ConsumptionEvent event;
+    if (!trackers[index].update(reading, event))
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL(&consumptionMux);
+    event.sequence = ++totals.lastSequence;
+    event.session = totals.session;
+    event.cell = index;
+    eventLog[(event.sequence - 1) % CONSUMPTION_LOG_SIZE] = event;
+    addToTotals(totals.boot[index], event);
+    addToTotals(totals.current[index], event);
+    taskEXIT_CRITICAL(&consumptionMux);
+}
+
+void getConsumption(ConsumptionSummary &summary)
+{
+    taskENTER_CRITICAL(&consumptionMux);
+    summary = totals;
+    taskEXIT_CRITICAL(&consumptionMux);
+}
+
+void startConsumptionSession(ConsumptionSummary &summary)
+{
+    uint32_t now = millis();
+
+    taskENTER_CRITICAL(&consumptionMux);
+    summary = totals;
+    totals.session++;
+    totals.sessionStartMs = now;
+    memset(totals.current, 0, sizeof(totals.current));
+    taskEXIT_CRITICAL(&consumptionMux);
+}
+
+int getConsumptionEvents(uint32_t since, ConsumptionEvent events[], int maxEvents, uint32_t &last, uint32_t &dropped)
+{
+    int count = 0;
+
+    taskENTER_CRITICAL(&consumptionMux);
+    last = totals.lastSequence;
+    if (since > last)
+    {
+        since = 0; // a sequence from before a reboot
+    }
+    uint32_t oldest = last > CONSUMPTION_LOG_SIZE ? last - CONSUMPTION_LOG_SIZE + 1 : 1;
+    uint32_t first = max(since + 1, oldest);
+    dropped = first - since - 1;
+    for (uint32_t sequence = first; sequence <= last && count < maxEvents; ++sequence)
+    {
+        events[count++] = eventLog[(sequence - 1) % CONSUMPTION_LOG_SIZE];
+    }
+    taskEXIT_CRITICAL(&consumptionMux);
+
+    return count;
+}
+
+static void addToTotals(ConsumptionTotals &sum, const ConsumptionEvent &event)
+{
+    if (event.type == EVENT_DIP)
+    {
+        sum.consumed += event.grams;
+        sum.dips++;
+    }
+    else
+    {
+        sum.refilled += event.grams;
+        sum.refills++;
+    }
+}
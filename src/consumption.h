@@ -0,0 +1,102 @@
+#ifndef CONSUMPTION_H
+#define CONSUMPTION_H
+
+#include <stdint.h>
+#include "readings.h"
+
+// Events kept for GET /consumption/events, the oldest is overwritten first
+#define CONSUMPTION_LOG_SIZE 64
+
+// Most events in one GET /consumption/events, the rest is paged with ?since=
+#define CONSUMPTION_EVENTS_PER_PAGE 16
+
+// A new level counts once the weight stayed stable this long. Shorter rests,
+// e.g. the glass touching the plate during a dip, belong to the dip.
+#define CONSUMPTION_SETTLE_MS 1000
+
+// Smaller changes between two levels are noise. They are not dropped but
+// add up until they pass this.
+#define CONSUMPTION_MIN_GRAMS 0.5f
+
+// A level this far below zero means the plate was lifted off (cells are
+// tared with the plate on). It is skipped, the next level is compared with
+// the one before.
+#define CONSUMPTION_REMOVED_GRAMS -5.0f
+
+enum ConsumptionEventType : uint8_t
+{
+    EVENT_DIP,    // weight dropped, grams were used
+    EVENT_REFILL, // weight rose
+};
+
+// Entry of the event log, one per dip or refill
+struct ConsumptionEvent
+{
+    uint32_t sequence; // counts events since boot, starting at 1
+    uint32_t startMs;  // millis() when the cell left its previous level
+    uint32_t endMs;    // millis() when it became stable at the new one
+    float grams;       // amount used or added, always positive
+    float weight;      // level after the event
+    uint16_t session;
+    uint8_t cell; // index, ID - 1
+    uint8_t type; // ConsumptionEventType
+};
+
+struct ConsumptionTotals
+{
+    float consumed; // grams, sum of the dips
+    float refilled; // grams, sum of the refills
+    uint32_t dips;
+    uint32_t refills;
+};
+
+// Copy of the running totals taken under the lock
+struct ConsumptionSummary
+{
+    uint16_t session;
+    uint32_t sessionStartMs;
+    uint32_t lastSequence; // sequence of the newest event, 0 if none yet
+    ConsumptionTotals boot[MAX_LOAD_CELLS];
+    ConsumptionTotals current[MAX_LOAD_CELLS]; // since the session started
+};
+
+// Splits the weight of one cell into levels it settled at and reports the
+// change between two levels
+class LevelTracker
+{
+public:
+    LevelTracker();
+    void reset();
+
+    // Feed every published reading. Returns true once the cell settled at a
+    // level that differs from the previous one, event then holds the times,
+    // type, grams and weight.
+    bool update(const LoadCellReading &reading, ConsumptionEvent &event);
+
+private:
+    bool hasLevel;
+    float level; // weight of the last level
+    long offset; // calibration the level was measured with
+    float factor;
+    bool wasStable;
+    bool settled; // the current stable run was already evaluated
+    uint32_t stableSince;
+    uint32_t leftAt; // when the last settled run ended
+};
+
+// Sampler task only, called with each published reading
+void updateConsumption(int index, const LoadCellReading &reading);
+
+void getConsumption(ConsumptionSummary &summary);
+
+// Close the current session and start the next one, summary receives the
+// totals of the closed session
+void startConsumptionSession(ConsumptionSummary &summary);
+
+// Copy up to maxEvents events with a sequence after since, oldest first, and
+// return their number. last is the newest sequence, dropped counts events
+// after since that were already overwritten. A since ahead of last (the
+// device rebooted) reads from the start.
+int getConsumptionEvents(uint32_t since, ConsumptionEvent events[], int maxEvents, uint32_t &last, uint32_t &dropped);
+
+#endif
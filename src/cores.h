@@ -0,0 +1,25 @@
+#ifndef CORES_H
+#define CORES_H
+
+// Threading model. The radio, lwIP and AsyncTCP run on the PRO core, and so
+// do the tasks that serve clients: stream, stable waits, the OLED
+// dashboard and the Arduino loop (WiFi upkeep, flash writes). platformio.ini moves the
+// loop, WiFi events and AsyncTCP there. The APP core belongs to the
+// sampler, so clocking an HX711 is never interrupted by WiFi interrupts or
+// TCP work. The sampler publishes readings through Seqlocks (seqlock.h),
+// so readers on the network core never hold up the sampler.
+#define NETWORK_CORE 0
+#define SENSOR_CORE 1
+
+// Above everything else on the sensor core. The sampler sleeps between
+// data ready edges, so lower priority tasks still get the core.
+#define SAMPLER_TASK_PRIORITY 5
+
+// Tasks on the network core that serve clients, below AsyncTCP (3)
+#define NETWORK_TASK_PRIORITY 1
+
+// The OLED dashboard shares the idle priority, anything else on the
+// network core preempts a frame that is being sent
+#define DISPLAY_TASK_PRIORITY 0
+
+#endif
@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Adafruit_SH1106.h>
+#include <math.h>
+#include <string.h>
+#include "alerts.h"
+#include "cores.h"
+#include "dashboard.h"
+#include "sampler.h"
+
+// Row layout, on the 6 pixel grid of the font: "NN WWWWW.Wg*" then the bar
+#define ROW_TEXT_X 0
+#define ROW_STABLE_X 66
+#define ROW_BAR_X 78
+#define ROW_BAR_WIDTH (OLED_WIDTH - ROW_BAR_X)
+#define ROWS_PER_SCREEN (OLED_PAGES - 1) // page 0 is the header
+
+static PageCanvas canvas;
+static TwoWire *dashboardWire = nullptr;
+static uint8_t dashboardAddress = 0x3C;
+static int dashboardCells = 0;
+
+// Function Prototypes
+static void dashboardTask(void *parameter);
+static void drawHeader(int first, int groups);
+static void drawCell(int row, int index);
+static int barWidth(float weight, float fullScale);
+
+PageCanvas::PageCanvas() : Adafruit_GFX(OLED_WIDTH, OLED_PAGES * 8), shownValid(0)
+{
+    memset(pages, 0, sizeof(pages));
+    memset(shown, 0, sizeof(shown));
+}
+
+void PageCanvas::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if (x < 0 || x >= OLED_WIDTH || y < 0 || y >= OLED_PAGES * 8)
+    {
+        return;
+    }
+    uint8_t bit = 1 << (y & 7);
+    if (color == WHITE)
+    {
+        pages[y / 8][x] |= bit;
+    }
+    else
+    {
+        pages[y / 8][x] &= ~bit;
+    }
+}
+
+void PageCanvas::fillScreen(uint16_t color)
+{
+    memset(pages, color == WHITE ? 0xFF : 0x00, sizeof(pages));
+}
+
+// Send the columns between the first and the last one that differ from what
+// the panel shows. A page is remembered as shown only once every
+// transmission of it was acknowledged, otherwise it is sent whole next time.
+int PageCanvas::flush(TwoWire &wire, uint8_t address)
+{
+    int sent = 0;
+    for (int page = 0; page < OLED_PAGES; ++page)
+    {
+        int first = 0;
+        int last = OLED_WIDTH - 1;
+        if (shownValid & (1 << page))
+        {
+            while (first < OLED_WIDTH && pages[page][first] == shown[page][first])
+            {
+                first++;
+            }
+            if (first == OLED_WIDTH)
+            {
+                continue;
+            }
+            while (pages[page][last] == shown[page][last])
+            {
+                last--;
+            }
+        }
+
+        // Page address, then the column address in two nibbles
+        uint8_t column = first + OLED_COLUMN_OFFSET;
+        wire.beginTransmission(address);
+        wire.write(0x00);
+        wire.write(0xB0 + page);
+        wire.write(column & 0x0F);
+        wire.write(0x10 | (column >> 4));
+        uint8_t error = wire.endTransmission();
+
+        for (int start = first; error == 0 && start <= last; start += DASHBOARD_CHUNK_SIZE)
+        {
+            wire.beginTransmission(address);
+            wire.write(0x40);
+            wire.write(pages[page] + start, min(DASHBOARD_CHUNK_SIZE, last + 1 - start));
+            error = wire.endTransmission();
+        }
+
+        if (error != 0)
+        {
+            shownValid &= ~(1 << page);
+            return -1;
+        }
+        memcpy(shown[page], pages[page], sizeof(shown[page]));
+        shownValid |= 1 << page;
+        sent++;
+    }
+    return sent;
+}
+
+// The display must have been initialized, from here on only this task uses
+// the bus. The init sequence ran at the default clock.
+void startDashboard(TwoWire &wire, uint8_t address, int numCells)
+{
+    dashboardWire = &wire;
+    dashboardAddress = address;
+    dashboardCells = numCells;
+    wire.setClock(DASHBOARD_I2C_CLOCK);
+    xTaskCreatePinnedToCore(dashboardTask, "dashboard", 3072, nullptr, DISPLAY_TASK_PRIORITY, nullptr, NETWORK_CORE);
+}
+
+// Redraw the whole frame into the canvas, the panel only gets the difference
+static void dashboardTask(void *parameter)
+{
+    int groups = max(1, (dashboardCells + ROWS_PER_SCREEN - 1) / ROWS_PER_SCREEN);
+    TickType_t lastWake = xTaskGetTickCount();
+
+    canvas.setTextSize(1);
+    canvas.setTextWrap(false);
+    canvas.setTextColor(WHITE);
+
+    for (;;)
+    {
+        int first = (millis() / DASHBOARD_CYCLE_MS) % groups * ROWS_PER_SCREEN;
+
+        canvas.fillScreen(BLACK);
+        drawHeader(first, groups);
+        for (int row = 0; row < ROWS_PER_SCREEN && first + row < dashboardCells; ++row)
+        {
+            drawCell(row, first + row);
+        }
+        canvas.flush(*dashboardWire, dashboardAddress);
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DASHBOARD_REFRESH_MS));
+    }
+}
+
+// IP address, and which cells are shown if they do not fit on one screen
+static void drawHeader(int first, int groups)
+{
+    canvas.setCursor(0, 0);
+    if (WiFi.isConnected())
+    {
+        canvas.print(WiFi.localIP());
+    }
+    else
+    {
+        canvas.print("No WiFi");
+    }
+
+    if (groups > 1)
+    {
+        char range[8];
+        int length = snprintf(range, sizeof(range), "%d-%d", first + 1, min(first + ROWS_PER_SCREEN, dashboardCells));
+        canvas.setCursor(OLED_WIDTH - 6 * length - 2, 0);
+        canvas.print(range);
+    }
+}
+
+// "NN WWWWW.Wg*" and a bar filled up to the high threshold, or to
+// DASHBOARD_FULL_SCALE_GRAMS, with a tick at the low threshold
+static void drawCell(int row, int index)
+{
+    int16_t y = (row + 1) * 8;
+    LoadCellReading reading = getLatestReading(index);
+    char text[24];
+
+    canvas.setCursor(ROW_TEXT_X, y);
+    if (!reading.connected)
+    {
+        snprintf(text, sizeof(text), "%2d      --", index + 1);
+        canvas.print(text);
+        return;
+    }
+    snprintf(text, sizeof(text), "%2d %7.1fg", index + 1, reading.weight);
+    canvas.print(text);
+
+    if (reading.stable)
+    {
+        canvas.setCursor(ROW_STABLE_X, y);
+        canvas.print('*');
+    }
+
+    AlertThresholds thresholds = getAlertThresholds(index);
+    float fullScale = isnan(thresholds.high) || thresholds.high <= 0 ? DASHBOARD_FULL_SCALE_GRAMS : thresholds.high;
+
+    canvas.drawRect(ROW_BAR_X, y + 1, ROW_BAR_WIDTH, 6, WHITE);
+    canvas.fillRect(ROW_BAR_X, y + 2, barWidth(reading.weight, fullScale), 4, WHITE);
+    if (!isnan(thresholds.low) && thresholds.low > 0 && thresholds.low < fullScale)
+    {
+        canvas.drawFastVLine(ROW_BAR_X + barWidth(thresholds.low, fullScale), y, 8, WHITE);
+    }
+}
+
+static int barWidth(float weight, float fullScale)
+{
+    float fraction = constrain(weight / fullScale, 0.0f, 1.0f);
+    return (int)lroundf(fraction * (ROW_BAR_WIDTH - 1));
+}
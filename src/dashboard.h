@@ -0,0 +1,52 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+// SH1106 geometry: 8 pages of 8 pixel rows, one byte per column. The RAM is
+// 132 columns wide, the 128 visible ones start at column 2.
+#define OLED_WIDTH 128
+#define OLED_PAGES 8
+#define OLED_COLUMN_OFFSET 2
+
+// The SH1106 handles fast mode I2C, 4x the Wire default
+#define DASHBOARD_I2C_CLOCK 400000
+
+// Time between frames, the panel only receives what changed
+#define DASHBOARD_REFRESH_MS 200
+
+// Display data bytes per I2C transmission, below the 128 byte Wire buffer
+#define DASHBOARD_CHUNK_SIZE 64
+
+// Range of a fill bar when the cell has no high alert threshold
+#define DASHBOARD_FULL_SCALE_GRAMS 500.0f
+
+// With more cells than rows, how long each group of cells is shown
+#define DASHBOARD_CYCLE_MS 3000
+
+// Framebuffer in SH1106 page layout. flush() compares it with a copy of
+// what the panel shows and sends only the columns that changed, page by page.
+class PageCanvas : public Adafruit_GFX
+{
+public:
+    PageCanvas();
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+
+    // Returns the number of pages sent, -1 if the panel did not acknowledge
+    int flush(TwoWire &wire, uint8_t address);
+
+private:
+    uint8_t pages[OLED_PAGES][OLED_WIDTH];
+    uint8_t shown[OLED_PAGES][OLED_WIDTH];
+    uint8_t shownValid; // bit per page, set once the panel shows shown[]
+};
+
+// Take over the display once setup() is done: a row per cell with weight,
+// stability and fill bar, below a header with the IP address
+void startDashboard(TwoWire &wire, uint8_t address, int numCells);
+
+#endif
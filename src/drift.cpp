@@ -0,0 +1,69 @@
+#include <math.h>
+#include <string.h>
+#include "drift.h"
+
+const char *getDriftSourceName(DriftSource source)
+{
+    static const char *names[] = {"off", "time", "temperature"};
+    return names[source];
+}
+
+bool parseDriftSource(const char *name, DriftSource &source)
+{
+    for (uint8_t i = DRIFT_OFF; i <= DRIFT_TEMPERATURE; ++i)
+    {
+        if (strcmp(name, getDriftSourceName((DriftSource)i)) == 0)
+        {
+            source = (DriftSource)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+ZeroTracker::ZeroTracker()
+{
+    reset();
+}
+
+void ZeroTracker::reset()
+{
+    sum = 0;
+    count = 0;
+    windowStart = 0;
+    total = 0;
+}
+
+float ZeroTracker::update(float weight, bool stable, uint32_t nowMs)
+{
+    // Anything on the plate, or a moving weight, starts the window over
+    if (!stable || fabsf(weight) > AUTO_ZERO_BAND_GRAMS)
+    {
+        sum = 0;
+        count = 0;
+        return 0;
+    }
+
+    if (count == 0)
+    {
+        windowStart = nowMs;
+    }
+    sum += weight;
+    count++;
+    if (nowMs - windowStart < AUTO_ZERO_WINDOW_MS)
+    {
+        return 0;
+    }
+
+    float mean = sum / count;
+    sum = 0;
+    count = 0;
+
+    float step = fmaxf(-AUTO_ZERO_MAX_STEP_GRAMS, fminf(mean, AUTO_ZERO_MAX_STEP_GRAMS));
+    if (fabsf(total + step) > AUTO_ZERO_MAX_TOTAL_GRAMS)
+    {
+        return 0;
+    }
+    total += step;
+    return step;
+}
@@ -0,0 +1,72 @@
+#ifndef DRIFT_H
+#define DRIFT_H
+
+#include <stdint.h>
+
+// Auto-zero: once a cell has been stable within this of zero for a whole
+// window, the mean of the window becomes the new zero, at most a step at a
+// time. Beyond the total since the last tare the tracking stops, a load
+// that large is not drift.
+#define AUTO_ZERO_BAND_GRAMS 1.0f
+#define AUTO_ZERO_WINDOW_MS 5000
+#define AUTO_ZERO_MAX_STEP_GRAMS 0.2f
+#define AUTO_ZERO_MAX_TOTAL_GRAMS 20.0f
+
+// How often the drift model moves the zero
+#define DRIFT_UPDATE_MS 1000
+
+// Weight of a new reading of the chip temperature, which changes in
+// steps of about a degree
+#define DRIFT_TEMPERATURE_ALPHA 0.05f
+
+// What the zero of a cell drifts with
+enum DriftSource : uint8_t
+{
+    DRIFT_OFF = 0,
+    DRIFT_TIME = 1,        // grams per hour since the last tare
+    DRIFT_TEMPERATURE = 2  // grams per °C of the ESP32 since the last tare
+};
+
+// Per-cell zero tracking settings
+struct DriftConfig
+{
+    bool autoZero;
+    DriftSource source;
+    float rate; // grams the zero rises per hour or per °C
+};
+
+const DriftConfig DEFAULT_DRIFT_CONFIG = {true, DRIFT_OFF, 0.0f};
+
+// Zero corrections since the last tare, in grams
+struct DriftStatus
+{
+    DriftConfig config;
+    float tracked;  // applied by auto-zero
+    float modelled; // applied by the drift model
+};
+
+// "off", "time" or "temperature"
+const char *getDriftSourceName(DriftSource source);
+bool parseDriftSource(const char *name, DriftSource &source);
+
+// Finds the zero of a cell while it rests empty
+class ZeroTracker
+{
+public:
+    ZeroTracker();
+    void reset();
+
+    // Feed the unfiltered weight in grams. Returns the grams the zero moved
+    // by at the end of a window the cell spent stable near zero, 0 otherwise.
+    float update(float weight, bool stable, uint32_t nowMs);
+
+    float getTotal() const { return total; }
+
+private:
+    float sum;
+    uint32_t count;
+    uint32_t windowStart;
+    float total; // corrections since reset()
+};
+
+#endif
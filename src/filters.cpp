@@ -0,0 +1,155 @@
+#include "filters.h"
+
+/* Median */
+
+void MedianFilter::reset(uint8_t window)
+{
+    // Odd window between 1 and MEDIAN_MAX_WINDOW
+    if (window < 1)
+    {
+        window = 1;
+    }
+    if (window > MEDIAN_MAX_WINDOW)
+    {
+        window = MEDIAN_MAX_WINDOW;
+    }
+    this->window = window | 1;
+    head = 0;
+    count = 0;
+}
+
+float MedianFilter::update(float x)
+{
+    if (window <= 1)
+    {
+        return x;
+    }
+
+    values[head] = x;
+    head = (head + 1) % window;
+    if (count < window)
+    {
+        count++;
+    }
+
+    // Insertion sort of a copy, the window is at most MEDIAN_MAX_WINDOW long
+    float sorted[MEDIAN_MAX_WINDOW];
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        float v = values[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v)
+        {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    return sorted[count / 2];
+}
+
+/* EMA */
+
+void EmaFilter::reset(float alpha)
+{
+    this->alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+    initialized = false;
+}
+
+float EmaFilter::update(float x)
+{
+    if (!initialized)
+    {
+        value = x;
+        initialized = true;
+    }
+    else
+    {
+        value += alpha * (x - value);
+    }
+    return value;
+}
+
+/* Kalman */
+
+void KalmanFilter::reset(float processNoise, float measurementNoise)
+{
+    q = processNoise;
+    r = measurementNoise > 0.0f ? measurementNoise : 1e-6f;
+    initialized = false;
+}
+
+float KalmanFilter::update(float x)
+{
+    if (!initialized)
+    {
+        estimate = x;
+        errorCovariance = r;
+        initialized = true;
+        return estimate;
+    }
+
+    // Predict: the weight stays the same, uncertainty grows by q
+    errorCovariance += q;
+
+    // Correct with the new reading
+    float gain = errorCovariance / (errorCovariance + r);
+    estimate += gain * (x - estimate);
+    errorCovariance *= 1.0f - gain;
+    return estimate;
+}
+
+/* Deadband */
+
+void DeadbandFilter::reset(float deadband)
+{
+    this->deadband = deadband < 0.0f ? 0.0f : deadband;
+    initialized = false;
+}
+
+float DeadbandFilter::update(float x)
+{
+    if (!initialized || x - output > deadband || output - x > deadband)
+    {
+        output = x;
+        initialized = true;
+    }
+    return output;
+}
+
+/* Chain */
+
+FilterChain::FilterChain() : output(0.0f)
+{
+    configure(DEFAULT_FILTER_CONFIG);
+}
+
+void FilterChain::configure(const FilterConfig &config)
+{
+    this->config = config;
+    median.reset(config.medianWindow);
+    ema.reset(config.emaAlpha);
+    kalman.reset(config.kalmanProcessNoise, config.kalmanMeasurementNoise);
+    deadband.reset(config.deadband);
+    this->config.medianWindow = median.getWindow();
+}
+
+float FilterChain::update(float weight)
+{
+    float x = median.update(weight);
+
+    if (config.smoothing == SMOOTHING_EMA)
+    {
+        x = ema.update(x);
+    }
+    else if (config.smoothing == SMOOTHING_KALMAN)
+    {
+        x = kalman.update(x);
+    }
+
+    x = deadband.update(x);
+
+    // Ensure no negative values and no noise around an empty plate
+    output = (x < config.zeroBand || x <= 0.0f) ? 0.0f : x;
+    return output;
+}
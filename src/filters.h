@@ -0,0 +1,109 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+
+// Largest median window (odd)
+#define MEDIAN_MAX_WINDOW 9
+
+// Smoothing stage after the median
+enum SmoothingMode : uint8_t
+{
+    SMOOTHING_NONE = 0,
+    SMOOTHING_EMA = 1,
+    SMOOTHING_KALMAN = 2
+};
+
+// Per-cell filter settings, all weights in grams
+struct FilterConfig
+{
+    uint8_t medianWindow;    // 1 disables the median stage
+    SmoothingMode smoothing;
+    float emaAlpha;          // EMA weight of a new sample, 0..1
+    float kalmanProcessNoise;     // q, how fast the true weight may change
+    float kalmanMeasurementNoise; // r, variance of a single reading
+    float deadband;          // output only moves if the input moved further than this
+    float zeroBand;          // outputs below this are reported as 0 (also clamps negatives)
+};
+
+// Default chain: 5-sample median against spikes, EMA, small deadband, 2 g zero band
+const FilterConfig DEFAULT_FILTER_CONFIG = {5, SMOOTHING_EMA, 0.3f, 0.05f, 1.0f, 0.1f, 2.0f};
+
+// Running median of the last `window` samples, rejects single-sample spikes
+class MedianFilter
+{
+public:
+    void reset(uint8_t window);
+    float update(float x);
+    uint8_t getWindow() const { return window; }
+
+private:
+    float values[MEDIAN_MAX_WINDOW];
+    uint8_t window = 1;
+    uint8_t head = 0;
+    uint8_t count = 0;
+};
+
+// Exponential moving average
+class EmaFilter
+{
+public:
+    void reset(float alpha);
+    float update(float x);
+
+private:
+    float alpha = 1.0f;
+    float value = 0.0f;
+    bool initialized = false;
+};
+
+// One-dimensional Kalman filter for a constant value with process noise
+class KalmanFilter
+{
+public:
+    void reset(float processNoise, float measurementNoise);
+    float update(float x);
+
+private:
+    float q = 0.0f;
+    float r = 1.0f;
+    float estimate = 0.0f;
+    float errorCovariance = 1.0f;
+    bool initialized = false;
+};
+
+// Holds the output until the input moves further than the deadband
+class DeadbandFilter
+{
+public:
+    void reset(float deadband);
+    float update(float x);
+
+private:
+    float deadband = 0.0f;
+    float output = 0.0f;
+    bool initialized = false;
+};
+
+// Median -> EMA or Kalman -> deadband -> zero band, run once per raw sample.
+// Each update is O(window) for the median and O(1) otherwise, so the latest
+// filtered weight is always available without re-averaging.
+class FilterChain
+{
+public:
+    FilterChain();
+    void configure(const FilterConfig &config);
+    const FilterConfig &getConfig() const { return config; }
+    float update(float weight);
+    float value() const { return output; }
+
+private:
+    FilterConfig config;
+    MedianFilter median;
+    EmaFilter ema;
+    KalmanFilter kalman;
+    DeadbandFilter deadband;
+    float output;
+};
+
+#endif
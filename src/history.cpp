@@ -0,0 +1,297 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+#include "history.h"
+#include "json_writer.h"
+
+// Ring of buckets, indexed by bucket number modulo the depth
+struct HistoryTier
+{
+    HistoryBucket *buckets;
+    uint32_t latest; // number of the newest bucket
+    bool started;
+};
+
+static const uint32_t stepsMs[HISTORY_TIER_COUNT] = HISTORY_STEPS_MS;
+static const uint16_t depths[HISTORY_TIER_COUNT] = HISTORY_DEPTHS;
+static HistoryTier tiers[MAX_LOAD_CELLS][HISTORY_TIER_COUNT];
+static int numHistoryCells = 0;
+static bool historyEnabled = false;
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED; // buckets and ranges
+
+// Encoder states
+enum
+{
+    ENCODE_HEADER,
+    ENCODE_POINTS,
+    ENCODE_FOOTER,
+    ENCODE_DONE
+};
+
+// Function Prototypes
+static void addToTier(HistoryTier &tier, uint16_t depth, uint32_t number, float weight);
+static uint32_t firstNumber(const HistoryTier &tier, uint16_t depth);
+
+bool beginHistory(int numCells)
+{
+    size_t bucketsPerCell = 0;
+    for (int t = 0; t < HISTORY_TIER_COUNT; ++t)
+    {
+        bucketsPerCell += depths[t];
+    }
+
+    numHistoryCells = min(numCells, MAX_LOAD_CELLS);
+    size_t size = numHistoryCells * bucketsPerCell * sizeof(HistoryBucket);
+    HistoryBucket *memory = (HistoryBucket *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (memory == nullptr)
+    {
+        memory = (HistoryBucket *)malloc(size);
+    }
+    if (memory == nullptr)
+    {
+        Serial.printf("Not enough memory for %u bytes of history, history is off\n", (unsigned)size);
+        return false;
+    }
+
+    for (int i = 0; i < numHistoryCells; ++i)
+    {
+        for (int t = 0; t < HISTORY_TIER_COUNT; ++t)
+        {
+            tiers[i][t] = {memory, 0, false};
+            memory += depths[t];
+        }
+    }
+    historyEnabled = true;
+    return true;
+}
+
+bool isHistoryEnabled()
+{
+    return historyEnabled;
+}
+
+void updateHistory(int index, const LoadCellReading &reading)
+{
+    if (!historyEnabled || !reading.connected)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL(&historyMux);
+    for (int t = 0; t < HISTORY_TIER_COUNT; ++t)
+    {
+        addToTier(tiers[index][t], depths[t], reading.timestamp / stepsMs[t], reading.weight);
+    }
+    taskEXIT_CRITICAL(&historyMux);
+}
+
+int findHistoryTier(uint32_t stepMs)
+{
+    for (int t = 0; t < HISTORY_TIER_COUNT; ++t)
+    {
+        if (stepsMs[t] == stepMs)
+        {
+            return t;
+        }
+    }
+    return -1;
+}
+
+int selectHistoryTier(int index, uint32_t fromMs)
+{
+    for (int t = 0; t < HISTORY_TIER_COUNT - 1; ++t)
+    {
+        uint32_t first, last;
+        if (!getHistoryRange(index, t, first, last) || fromMs / stepsMs[t] >= first)
+        {
+            return t;
+        }
+    }
+    return HISTORY_TIER_COUNT - 1;
+}
+
+uint32_t getHistoryStep(int tier)
+{
+    return stepsMs[tier];
+}
+
+bool getHistoryRange(int index, int tier, uint32_t &first, uint32_t &last)
+{
+    if (!historyEnabled)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&historyMux);
+    const HistoryTier &history = tiers[index][tier];
+    bool started = history.started;
+    first = firstNumber(history, depths[tier]);
+    last = history.latest;
+    taskEXIT_CRITICAL(&historyMux);
+    return started;
+}
+
+bool getHistoryBucket(int index, int tier, uint32_t number, HistoryBucket &bucket)
+{
+    if (!historyEnabled)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&historyMux);
+    const HistoryTier &history = tiers[index][tier];
+    bool found = history.started && number >= firstNumber(history, depths[tier]) && number <= history.latest;
+    if (found)
+    {
+        bucket = history.buckets[number % depths[tier]];
+    }
+    taskEXIT_CRITICAL(&historyMux);
+    return found;
+}
+
+/* Buckets */
+
+// Running mean, so a bucket never needs more than one pass
+static void addToTier(HistoryTier &tier, uint16_t depth, uint32_t number, float weight)
+{
+    // Far behind the newest bucket only once millis() wrapped, after 49.7
+    // days. The buckets of the old count cannot be placed on the new one.
+    if (tier.started && number < tier.latest && tier.latest - number >= depth)
+    {
+        tier.started = false;
+    }
+
+    if (!tier.started)
+    {
+        memset(tier.buckets, 0, depth * sizeof(HistoryBucket));
+        tier.latest = number;
+        tier.started = true;
+    }
+    else if (number > tier.latest)
+    {
+        // Empty the buckets skipped while the cell was silent, and the new one
+        uint32_t gap = min(number - tier.latest, (uint32_t)depth);
+        for (uint32_t k = 1; k <= gap; ++k)
+        {
+            tier.buckets[(tier.latest + k) % depth] = {0, 0, 0, 0};
+        }
+        tier.latest = number;
+    }
+    else if (number < tier.latest)
+    {
+        return; // a republished older reading
+    }
+
+    HistoryBucket &bucket = tier.buckets[number % depth];
+    if (bucket.count == 0)
+    {
+        bucket = {weight, weight, weight, 1};
+        return;
+    }
+    if (bucket.count < UINT16_MAX)
+    {
+        bucket.count++;
+    }
+    bucket.mean += (weight - bucket.mean) / bucket.count;
+    bucket.min = min(bucket.min, weight);
+    bucket.max = max(bucket.max, weight);
+}
+
+static uint32_t firstNumber(const HistoryTier &tier, uint16_t depth)
+{
+    return tier.latest >= depth ? tier.latest - depth + 1 : 0;
+}
+
+/* Encoder */
+
+HistoryEncoder::HistoryEncoder(int index, int tier, uint32_t fromMs)
+    : index(index), tier(tier), next(0), last(0), empty(true), state(ENCODE_HEADER), hasPoints(false),
+      pendingLength(0), pendingOffset(0)
+{
+    uint32_t first;
+    if (getHistoryRange(index, tier, first, last))
+    {
+        empty = false;
+        next = max(first, fromMs / stepsMs[tier]);
+    }
+}
+
+size_t HistoryEncoder::read(uint8_t *buffer, size_t maxLen)
+{
+    size_t written = 0;
+    while (written < maxLen)
+    {
+        if (pendingOffset == pendingLength && !fill())
+        {
+            break;
+        }
+        size_t n = min(maxLen - written, pendingLength - pendingOffset);
+        memcpy(buffer + written, pending + pendingOffset, n);
+        pendingOffset += n;
+        written += n;
+    }
+    return written;
+}
+
+// Format the next part into pending, false once the body is complete
+bool HistoryEncoder::fill()
+{
+    pendingOffset = 0;
+    pendingLength = 0;
+
+    if (state == ENCODE_HEADER)
+    {
+        // Left open, the points follow
+        JsonWriter json(pending, sizeof(pending));
+        json.beginObject();
+        json.add("id", index + 1);
+        json.add("step", (unsigned long)stepsMs[tier] / 1000);
+        json.add("now", (unsigned long)millis());
+        json.addRaw("columns", "[\"t\",\"count\",\"mean\",\"min\",\"max\"]");
+        json.beginArray("points");
+        state = empty ? ENCODE_FOOTER : ENCODE_POINTS;
+        pendingLength = json.length();
+        return true;
+    }
+
+    while (state == ENCODE_POINTS)
+    {
+        if (next > last)
+        {
+            state = ENCODE_FOOTER;
+            break;
+        }
+
+        HistoryBucket bucket;
+        uint32_t number = next++;
+        if (!getHistoryBucket(index, tier, number, bucket) || bucket.count == 0)
+        {
+            continue;
+        }
+
+        // The writer only sees this point, the comma before it is added here
+        size_t comma = hasPoints ? 1 : 0;
+        pending[0] = ',';
+        hasPoints = true;
+
+        JsonWriter json(pending + comma, sizeof(pending) - comma);
+        json.beginArray();
+        json.add(nullptr, (unsigned long)(number * stepsMs[tier]));
+        json.add(nullptr, (int)bucket.count);
+        json.add(nullptr, bucket.mean, 2);
+        json.add(nullptr, bucket.min, 2);
+        json.add(nullptr, bucket.max, 2);
+        json.endArray();
+        pendingLength = comma + json.length();
+        return true;
+    }
+
+    if (state == ENCODE_FOOTER)
+    {
+        memcpy(pending, "]}", 2);
+        pendingLength = 2;
+        state = ENCODE_DONE;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,73 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "readings.h"
+
+// Resolutions kept per cell: 2 minutes of 1 s buckets, 30 minutes of 10 s
+// buckets and 8 hours of 1 minute buckets. 780 buckets, 12.5 KB per cell.
+#define HISTORY_TIER_COUNT 3
+#define HISTORY_STEPS_MS {1000, 10000, 60000}
+#define HISTORY_DEPTHS {120, 180, 480}
+
+// Summary of the filtered weights published during one bucket
+struct HistoryBucket
+{
+    float mean;
+    float min;
+    float max;
+    uint16_t count; // 0 if the cell sent no reading, e.g. while disconnected
+};
+
+// Allocate the buckets of numCells cells, in PSRAM if the board has it.
+// Returns false and leaves the history off if there is not enough memory.
+bool beginHistory(int numCells);
+bool isHistoryEnabled();
+
+// Add a reading of a cell to the bucket of its timestamp in every tier.
+// Called by the sampler task for every new sample.
+void updateHistory(int index, const LoadCellReading &reading);
+
+// Tier whose buckets are stepMs long, -1 if there is none
+int findHistoryTier(uint32_t stepMs);
+
+// Finest tier that still holds the bucket of fromMs
+int selectHistoryTier(int index, uint32_t fromMs);
+
+uint32_t getHistoryStep(int tier);
+
+// Bucket numbers (timestamp / step) of the oldest and newest bucket a tier
+// holds, false if the cell has no reading yet
+bool getHistoryRange(int index, int tier, uint32_t &first, uint32_t &last);
+
+// Copy one bucket, false if it was overwritten since or is out of range
+bool getHistoryBucket(int index, int tier, uint32_t number, HistoryBucket &bucket);
+
+// Streams the buckets of one tier as JSON for a chunked response. Empty
+// buckets are left out, buckets completed during the download are not sent.
+//   {"id":1,"step":10,"now":..,"columns":["t","count","mean","min","max"],"points":[[t,count,mean,min,max],..]}
+class HistoryEncoder
+{
+public:
+    HistoryEncoder(int index, int tier, uint32_t fromMs);
+
+    // Fill buffer with the next part of the body, 0 at the end
+    size_t read(uint8_t *buffer, size_t maxLen);
+
+private:
+    int index;
+    int tier;
+    uint32_t next; // bucket number of the next point
+    uint32_t last;
+    bool empty;    // the cell has no reading yet
+    uint8_t state; // header, points, footer, done
+    bool hasPoints;
+    char pending[192];
+    size_t pendingLength;
+    size_t pendingOffset;
+
+    bool fill();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include "FS.h"
+#include "SPIFFS.h"
+#include "json_file.h"
+
+// Function Prototypes
+static bool parseJsonFile(const char *path, JsonDocument &jsonDoc);
+
+bool readJsonFile(const char *path, JsonDocument &jsonDoc)
+{
+    if (parseJsonFile(path, jsonDoc))
+    {
+        return true;
+    }
+
+    // A save was cut off between removing the old file and the rename
+    char tempPath[JSON_FILE_PATH_SIZE];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    jsonDoc.clear();
+    if (!parseJsonFile(tempPath, jsonDoc))
+    {
+        return false;
+    }
+
+    // Finish the swap, so the next save cannot overwrite the only copy
+    SPIFFS.remove(path);
+    SPIFFS.rename(tempPath, path);
+    Serial.printf("Restored %s from %s\n", path, tempPath);
+    return true;
+}
+
+bool writeJsonFile(const char *path, const JsonDocument &jsonDoc)
+{
+    char tempPath[JSON_FILE_PATH_SIZE];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    File file = SPIFFS.open(tempPath, "w");
+    if (!file)
+    {
+        Serial.printf("Failed to open %s for writing\n", tempPath);
+        return false;
+    }
+    size_t length = measureJson(jsonDoc);
+    size_t written = serializeJson(jsonDoc, file);
+    file.close();
+    if (written != length)
+    {
+        Serial.printf("Failed to write %s, %u of %u bytes\n", tempPath, (unsigned)written, (unsigned)length);
+        SPIFFS.remove(tempPath);
+        return false;
+    }
+
+    // From here on one of the two files is always complete
+    SPIFFS.remove(path);
+    return SPIFFS.rename(tempPath, path);
+}
+
+// Missing files are not an error, broken ones are reported
+static bool parseJsonFile(const char *path, JsonDocument &jsonDoc)
+{
+    File file = SPIFFS.open(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    DeserializationError error = deserializeJson(jsonDoc, file);
+    file.close();
+    if (error)
+    {
+        Serial.printf("Failed to parse %s: %s\n", path, error.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef JSON_FILE_H
+#define JSON_FILE_H
+
+#include <ArduinoJson.h>
+
+// Settings files on SPIFFS are written to <path>.tmp and swapped in once
+// complete. SPIFFS cannot rename onto an existing file, so the old file is
+// removed first; a power cut right then leaves only the .tmp, which
+// readJsonFile() picks up.
+
+// Longest path, SPIFFS names are limited to 31 characters
+#define JSON_FILE_PATH_SIZE 32
+
+// Parse path, or <path>.tmp if path is missing or broken. Returns false if
+// neither holds a valid document.
+bool readJsonFile(const char *path, JsonDocument &jsonDoc);
+
+// Returns false if the document could not be written completely, the
+// previous file is kept then
+bool writeJsonFile(const char *path, const JsonDocument &jsonDoc);
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes compact JSON into a caller-provided buffer without any heap
+// allocation. Commas are inserted automatically. If the buffer is too small
+// the output is truncated and overflowed() returns true; the buffer always
+// stays NUL-terminated.
+class JsonWriter
+{
+public:
+    JsonWriter(char *buffer, size_t size) : buffer(buffer), size(size), used(0), depth(0), hasItems(0), overflow(false)
+    {
+        if (size > 0)
+        {
+            buffer[0] = '\0';
+        }
+    }
+
+    void beginObject(const char *key = nullptr)
+    {
+        open(key, '{');
+    }
+
+    void endObject()
+    {
+        close('}');
+    }
+
+    void beginArray(const char *key = nullptr)
+    {
+        open(key, '[');
+    }
+
+    void endArray()
+    {
+        close(']');
+    }
+
+    void add(const char *key, long value)
+    {
+        item(key);
+        appendInteger(value);
+    }
+
+    void add(const char *key, int value)
+    {
+        add(key, (long)value);
+    }
+
+    void add(const char *key, unsigned long value)
+    {
+        item(key);
+        appendUnsigned(value);
+    }
+
+    void add(const char *key, bool value)
+    {
+        item(key);
+        append(value ? "true" : "false");
+    }
+
+    void add(const char *key, const char *value)
+    {
+        item(key);
+        appendString(value);
+    }
+
+    // Fixed-point number with the given number of decimals (at most 6)
+    void add(const char *key, double value, int decimals)
+    {
+        item(key);
+        appendFixed(value, decimals);
+    }
+
+    // Raw, already valid JSON
+    void addRaw(const char *key, const char *json)
+    {
+        item(key);
+        append(json);
+    }
+
+    const char *c_str() const { return buffer; }
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    char *buffer;
+    size_t size;
+    size_t used;
+    uint8_t depth;
+    uint32_t hasItems; // bit n set if the container at depth n already has an item
+    bool overflow;
+
+    void open(const char *key, char bracket)
+    {
+        item(key);
+        append(bracket);
+        depth++;
+        hasItems &= ~((uint32_t)1 << depth);
+    }
+
+    void close(char bracket)
+    {
+        depth--;
+        append(bracket);
+    }
+
+    // Comma and key before a value
+    void item(const char *key)
+    {
+        uint32_t bit = (uint32_t)1 << depth;
+        if (hasItems & bit)
+        {
+            append(',');
+        }
+        hasItems |= bit;
+
+        if (key != nullptr)
+        {
+            appendString(key);
+            append(':');
+        }
+    }
+
+    void append(char c)
+    {
+        if (used + 1 < size)
+        {
+            buffer[used++] = c;
+            buffer[used] = '\0';
+        }
+        else
+        {
+            overflow = true;
+        }
+    }
+
+    void append(const char *text)
+    {
+        while (*text)
+        {
+            append(*text++);
+        }
+    }
+
+    void appendString(const char *text)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        append('"');
+        for (; *text; ++text)
+        {
+            char c = *text;
+            if (c == '"' || c == '\\')
+            {
+                append('\\');
+                append(c);
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                append("\\u00");
+                append(hex[(c >> 4) & 0xF]);
+                append(hex[c & 0xF]);
+            }
+            else
+            {
+                append(c);
+            }
+        }
+        append('"');
+    }
+
+    void appendUnsigned(unsigned long long value)
+    {
+        char digits[20];
+        int n = 0;
+
+        // 64-bit division is done in software on the ESP32, so only the
+        // digits above 32 bits take it
+        while (value > 0xFFFFFFFFULL)
+        {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        }
+        uint32_t low = (uint32_t)value;
+        do
+        {
+            digits[n++] = '0' + low % 10;
+            low /= 10;
+        } while (low > 0);
+
+        while (n > 0)
+        {
+            append(digits[--n]);
+        }
+    }
+
+    void appendInteger(long value)
+    {
+        if (value < 0)
+        {
+            append('-');
+            appendUnsigned(0UL - (unsigned long)value);
+        }
+        else
+        {
+            appendUnsigned((unsigned long)value);
+        }
+    }
+
+    void appendFixed(double value, int decimals)
+    {
+        static const unsigned long powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+        decimals = decimals < 0 ? 0 : (decimals > 6 ? 6 : decimals);
+
+        // NaN and infinity are not valid JSON
+        if (value != value || value > 1e12 || value < -1e12)
+        {
+            append("null");
+            return;
+        }
+
+        bool negative = value < 0;
+        double magnitude = negative ? -value : value;
+        unsigned long long scaled = (unsigned long long)(magnitude * powers[decimals] + 0.5);
+        unsigned long long integer = scaled / powers[decimals]; // beyond 32 bits up to 1e12
+        unsigned long fraction = (unsigned long)(scaled % powers[decimals]);
+
+        if (negative && scaled != 0)
+        {
+            append('-');
+        }
+        appendUnsigned(integer);
+
+        if (decimals > 0)
+        {
+            append('.');
+            for (int d = decimals - 1; d >= 0; --d)
+            {
+                append('0' + (fraction / powers[d]) % 10);
+            }
+        }
+    }
+};
+
+#endif
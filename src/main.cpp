@@ -8,7 +8,15 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SH1106.h>
+#include "alerts.h"
+#include "bench.h"
+#include "boot_timing.h"
+#include "calibration_store.h"
+#include "cell_config.h"
+#include "dashboard.h"
+#include "history.h"
 #include "routes.h"
+#include "sampler.h"
 
 // Eduroam network credentials file path
 const char *credentialsPath = "/wifi_credentials.txt";
@@ -22,24 +30,39 @@ IPAddress local_IP(192, 168, 0, 125); // Static IP
 IPAddress gateway(192, 168, 0, 1);
 IPAddress subnet(255, 255, 255, 0);
 
-// Define the number of load cells
-const int NUM_LOAD_CELLS = 3;
+// WiFi bring-up: how long setup() waits for an IP before starting the
+// server anyway, and the reconnect backoff after a lost connection
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_RETRY_MIN_MS 500
+#define WIFI_RETRY_MAX_MS 30000
 
-// HX711 instances
-HX711 scales[NUM_LOAD_CELLS];
+// WiFi state, set from the WiFi event task
+volatile bool wifiConnected = false;
+volatile bool wifiReconnectPending = false;
+volatile bool networkInfoPending = false;
+uint32_t wifiRetryDelay = WIFI_RETRY_MIN_MS;
+uint32_t wifiLastAttempt = 0;
 
-// Pins for each load cell (DOUT, SCK)
-const int LOADCELL_PINS[NUM_LOAD_CELLS][2] = {
-    {26, 27}, // Load cell 1: DOUT 26, SCK 27
-    {25, 14}, // Load cell 2: DOUT 25, SCK 14
-    {33, 12}  // Load cell 3: DOUT 33, SCK 12
+// Load cells, replaced by /cells.json if it exists (see cell_config.h).
+// Built-in layout: cell 1 on DOUT 26 / SCK 27, cell 2 on 25 / 14, cell 3 on 33 / 12.
+CellConfig cellConfig = {
+    3,
+    {26, 25, 33},             // DOUT
+    {27, 14, 12},             // SCK
+    {128, 128, 128},          // gain
+    {-410.0, -410.0, -380.0}, // calibration factor until /calibration.json is saved,
+                              // afterwards owned by the sampler (setCalibrationFactor())
+    {-1, -1, -1},             // RATE not wired to a GPIO, the boards run at 10 SPS
+    {ACQUISITION_AUTO, ACQUISITION_AUTO, ACQUISITION_AUTO},
+    {DEFAULT_DRIFT_CONFIG, DEFAULT_DRIFT_CONFIG, DEFAULT_DRIFT_CONFIG}, // auto-zero on, no drift model
 };
 
-// Calibration factors for each load cell
-float calibration_factors[NUM_LOAD_CELLS] = {-410.0, -410.0, -380.0};
+// HX711 instances, only the first cellConfig.count are used
+HX711 scales[MAX_LOAD_CELLS];
 
 // Display setup
 #define OLED_RESET 4
+#define OLED_ADDRESS 0x3C
 Adafruit_SH1106 display(OLED_RESET);
 
 // Create instances of objects
@@ -49,10 +72,17 @@ AsyncWebServer server(80); // Create an AsyncWebServer object on port 80
 // Function Prototypes
 void readWiFiCredentials();
 void initializeSerial();
+void initializeFileSystem();
 void initializeDisplay();
 void initializeScales();
-void connectToWiFi();
+void initializeSampler();
+void startWiFi();
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+bool waitForWiFi(uint32_t timeoutMs);
+void maintainWiFi();
+void showNetworkInfo();
 void initializeServer();
+void handleSerialCommands();
 
 // Function Implementations
 
@@ -65,34 +95,84 @@ void initializeSerial()
 
 void initializeDisplay()
 {
-  // Initialize the OLED display at I2C address 0x3C
-  display.begin(SH1106_SWITCHCAPVCC, 0x3C);
+  // Initialize the OLED display, the dashboard takes over after setup()
+  display.begin(SH1106_SWITCHCAPVCC, OLED_ADDRESS);
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(WHITE);
   display.setCursor(0, 0);
+  display.println("Connecting to Wi-Fi...");
+  display.display();
+  markBootPhase(BOOT_DISPLAY);
 }
 
-void initializeScales()
+void initializeFileSystem()
 {
-  for (int i = 0; i < NUM_LOAD_CELLS; ++i)
+  // Holds the WiFi credentials, the load cell layout, the stored calibration
+  // and the alert thresholds
+  if (!SPIFFS.begin(true))
   {
-    Serial.printf("Initializing scale %d...\n", i + 1); // TODO: remove
-    scales[i].begin(LOADCELL_PINS[i][0], LOADCELL_PINS[i][1]);
-    scales[i].set_scale();
-    scales[i].tare();
-    scales[i].set_scale(calibration_factors[i]);
+    Serial.println("An error occurred while mounting SPIFFS");
   }
+  loadCellConfig(cellConfig);
+  loadAlerts(cellConfig.count);
+  markBootPhase(BOOT_FILESYSTEM);
 }
 
-void readWiFiCredentials()
+void initializeScales()
 {
-  if (!SPIFFS.begin(true))
+  // Restore calibration factors, zero offsets and gains from the last run
+  float factors[MAX_LOAD_CELLS];
+  long offsets[MAX_LOAD_CELLS];
+  bool hasOffset[MAX_LOAD_CELLS];
+  uint8_t gains[MAX_LOAD_CELLS];
+  memcpy(factors, cellConfig.factors, sizeof(factors));
+  memcpy(gains, cellConfig.gains, sizeof(gains));
+  loadCalibration(factors, offsets, hasOffset, gains, cellConfig.doutPins, cellConfig.count);
+
+  uint32_t tareMask = 0;
+  for (int i = 0; i < cellConfig.count; ++i)
   {
-    Serial.println("An error occurred while mounting SPIFFS");
-    return;
+    Serial.printf("Initializing scale %d...\n", i + 1); // TODO: remove
+    scales[i].begin(cellConfig.doutPins[i], cellConfig.sckPins[i], gains[i]);
+    scales[i].set_scale(factors[i]);
+
+    // A stored offset stays valid with the plates loaded, only tare new cells
+    if (hasOffset[i])
+    {
+      scales[i].set_offset(offsets[i]);
+    }
+    else
+    {
+      tareMask |= 1UL << i;
+    }
+  }
+
+  // Tare the remaining scales at once, the HX711s convert in parallel
+  beginSampler(scales, cellConfig, gains);
+  if (tareMask != 0)
+  {
+    if (!tareScales(tareMask, 10, 5000))
+    {
+      Serial.println("Tare timed out, a load cell is not connected");
+    }
+    markCalibrationDirty();
   }
+  markBootPhase(BOOT_SCALES);
+}
+
+void initializeSampler()
+{
+  // Continuously read all load cells in the background, threshold
+  // crossings are posted to the webhook by a task of their own
+  Serial.println("Starting sampler task...");
+  beginHistory(cellConfig.count);
+  startAlerts();
+  startSampler();
+}
 
+void readWiFiCredentials()
+{
   File file = SPIFFS.open(credentialsPath, "r");
   if (!file)
   {
@@ -113,18 +193,19 @@ void readWiFiCredentials()
   Serial.println(ssid);
 }
 
-void connectToWiFi()
+void startWiFi()
 {
-  Serial.println("Connecting to Wi-Fi...");
-  unsigned long startTime = millis();
-
   // Read WiFi credentials from SPIFFS
   Serial.println("Reading Wi-Fi credentials from SPIFFS");
   readWiFiCredentials();
 
   // Disconnect from any previous Wi-Fi connections
-  Serial.println("Disconnecting from previous Wi-Fi connections");
   WiFi.disconnect(true);
+  WiFi.mode(WIFI_STA);
+
+  // Reconnects are done by maintainWiFi() with a backoff
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(onWiFiEvent);
 
   // Set Static IP address
   if (!WiFi.config(local_IP, gateway, subnet))
@@ -132,55 +213,156 @@ void connectToWiFi()
     Serial.println("STA Failed to configure");
   }
 
-  // Begin Wi-Fi connection
+  // Associate in the background while the scales are tared
   Serial.printf("Connecting to SSID: %s\n", ssid.c_str());
   WiFi.begin(ssid, password);
+  wifiLastAttempt = millis();
+}
 
-  // Wait for connection
-  while (WiFi.status() != WL_CONNECTED)
+// Runs in the WiFi event task, only records the state for setup() and loop()
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+  switch (event)
   {
-    delay(500);
-    Serial.print(".");
+  case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    wifiConnected = true;
+    wifiReconnectPending = false;
+    networkInfoPending = true;
+    markBootPhase(BOOT_WIFI);
+    break;
+  case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    wifiConnected = false;
+    wifiReconnectPending = true;
+    break;
+  default:
+    break;
   }
-  Serial.println("");
-  Serial.println("Wi-Fi is connected!");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+}
 
-  // Display IP address on OLED
-  char buffer[50];
-  sprintf(buffer, "Local IP address (%s):", ssid.c_str());
-  display.println(buffer);
-  display.println(WiFi.localIP().toString());
-  display.println("\nPublic endpoint:");
-  display.println("https://lehre.bpm.in.tum.de/~ge54bow/cocktail_rimming/api/");
-  display.display();
+// Wait until an IP address is assigned or the timeout passes
+bool waitForWiFi(uint32_t timeoutMs)
+{
+  uint32_t start = millis();
+  while (!wifiConnected && millis() - start < timeoutMs)
+  {
+    maintainWiFi();
+    delay(10);
+  }
+
+  if (!wifiConnected)
+  {
+    Serial.printf("No Wi-Fi after %lu ms, starting the server anyway\n", (unsigned long)timeoutMs);
+  }
+  return wifiConnected;
+}
+
+// Reconnect after a lost or failed connection, doubling the delay each attempt
+void maintainWiFi()
+{
+  if (networkInfoPending)
+  {
+    networkInfoPending = false;
+    wifiRetryDelay = WIFI_RETRY_MIN_MS;
+    showNetworkInfo();
+  }
+
+  if (!wifiReconnectPending || millis() - wifiLastAttempt < wifiRetryDelay)
+  {
+    return;
+  }
 
-  unsigned long duration = millis() - startTime;
-  Serial.printf("Connected to Wi-Fi in %lu ms\n", duration);
+  Serial.printf("Wi-Fi disconnected, reconnecting after %lu ms\n", (unsigned long)wifiRetryDelay);
+  wifiReconnectPending = false;
+  wifiLastAttempt = millis();
+  wifiRetryDelay = min(wifiRetryDelay * 2, (uint32_t)WIFI_RETRY_MAX_MS);
+  WiFi.reconnect();
+}
+
+void showNetworkInfo()
+{
+  Serial.println("Wi-Fi is connected!");
+  Serial.printf("IP address (%s): ", ssid.c_str());
+  Serial.println(WiFi.localIP());
+  Serial.println("Public endpoint: https://lehre.bpm.in.tum.de/~ge54bow/cocktail_rimming/api/");
 }
 
 void initializeServer()
 {
   // Initialize server routes
   Serial.println("Initializing server...");
-  setupRoutes(server, scales, NUM_LOAD_CELLS);
+  setupRoutes(server);
 
   // Start the server
   server.begin();
   Serial.println("Server started on port 80");
+  markBootPhase(BOOT_SERVER);
 }
 
 void setup()
 {
   initializeSerial();
+  initializeFileSystem();
+
+  // WiFi associates in the background during display init and tare
+  startWiFi();
   initializeDisplay();
   initializeScales();
-  connectToWiFi();
+  initializeSampler();
+
+  // Serve as soon as the network is up. Without it the server still starts
+  // and becomes reachable once maintainWiFi() gets a connection.
+  waitForWiFi(WIFI_CONNECT_TIMEOUT_MS);
   initializeServer();
+
+  // The OLED shows the IP address in its header from here on
+  startDashboard(Wire, OLED_ADDRESS, cellConfig.count);
+  printBootTimes();
 }
 
 void loop()
 {
-  // No code needed here since we're using AsyncWebServer
+  // Load cells are read by the sampler task and requests are handled by
+  // AsyncWebServer. Only WiFi upkeep and slow flash writes are done here.
+  maintainWiFi();
+  saveCalibrationIfDirty();
+  saveAlertsIfDirty();
+  handleSerialCommands();
+  delay(100);
+}
+
+// Commands typed on the serial monitor, one per line:
+//   bench [ITERATIONS]   run the benchmarks of GET /bench and print the JSON
+void handleSerialCommands()
+{
+  static char line[32];
+  static size_t length = 0;
+  static char result[BENCH_RESULT_SIZE];
+
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r')
+    {
+      if (length < sizeof(line) - 1)
+      {
+        line[length++] = c;
+      }
+      continue;
+    }
+
+    line[length] = '\0';
+    length = 0;
+    if (strncmp(line, "bench", 5) == 0)
+    {
+      int iterations = atoi(line + 5);
+      if (runBenchmarks(result, sizeof(result), cellConfig.count, iterations > 0 ? iterations : BENCH_DEFAULT_ITERATIONS) > 0)
+      {
+        Serial.println(result);
+      }
+    }
+    else if (line[0] != '\0')
+    {
+      Serial.printf("Unknown command: %s\n", line);
+    }
+  }
 }
@@ -0,0 +1,336 @@
+#include <WiFi.h>
+#include <stdarg.h>
+#include <string.h>
+#include "alerts.h"
+#include "metrics.h"
+#include "readings.h"
+#include "sampler.h"
+
+// Handler latency, from a constant reply up to a blocking /bench run
+static const uint32_t requestBounds[] = {50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000};
+static const char *const requestLabels[] = {"0.00005", "0.0001", "0.00025", "0.0005", "0.001",
+                                            "0.0025", "0.005", "0.01", "0.025", "0.1"};
+static const HistogramBuckets requestBuckets = {requestBounds, requestLabels, 10};
+
+// Clocking out 25 bits takes ~60 µs, more when the sampler was preempted
+static const uint32_t readBounds[] = {40, 60, 80, 100, 150, 250, 500, 1000, 5000};
+static const char *const readLabels[] = {"0.00004", "0.00006", "0.00008", "0.0001", "0.00015",
+                                         "0.00025", "0.0005", "0.001", "0.005"};
+static const HistogramBuckets readBuckets = {readBounds, readLabels, 9};
+
+// route label of each MetricsRoute
+static const char *const routeNames[ROUTE_COUNT] = {
+    "/",
+    "/weight",
+    "/weight/stable",
+    "/weight/history",
+    "/calibration_factor",
+    "/calibration",
+    "/tare",
+    "/alerts",
+    "/filter",
+    "/acquisition",
+    "/drift",
+    "/capture",
+    "/consumption",
+    "/boot",
+    "/bench",
+    "/metrics",
+};
+
+// result label of each CacheResult
+static const char *const cacheResultNames[CACHE_RESULT_COUNT] = {"not_modified", "hit", "miss"};
+
+// result label of each WebhookResult
+static const char *const webhookResultNames[WEBHOOK_RESULT_COUNT] = {"sent", "retried", "failed", "dropped"};
+
+// Counters with one value per cell
+struct CellCounter
+{
+    const char *name;
+    const char *help;
+    uint32_t (*count)(int index);
+};
+
+static const CellCounter cellCounters[] = {
+    {"rimming_hx711_samples_total", "Conversions read from the HX711", getSampleCount},
+    {"rimming_hx711_not_ready_total", "Polls that found no conversion ready", getNotReadyCount},
+    {"rimming_hx711_disconnects_total", "Times the cell stopped producing samples", getDisconnectCount},
+    {"rimming_hx711_rate_switches_total", "Times the RATE pin was switched", getRateSwitchCount},
+    {"rimming_auto_zero_corrections_total", "Times auto-zero moved the zero of an empty cell", getAutoZeroCount},
+};
+static const int CELL_COUNTER_COUNT = sizeof(cellCounters) / sizeof(cellCounters[0]);
+
+// Metric families in the order of the body
+enum MetricsFamily : uint8_t
+{
+    FAMILY_REQUEST_DURATION, // one part per route
+    FAMILY_RESPONSES,
+    FAMILY_CACHE,
+    FAMILY_WEBHOOKS,
+    FAMILY_CELL_COUNTERS,    // one part per counter
+    FAMILY_READ_DURATION,    // one part per cell
+    FAMILY_HEAP,
+    FAMILY_WIFI,
+    FAMILY_UPTIME,
+    FAMILY_COUNT
+};
+
+// Print that fills a fixed buffer and drops what does not fit
+class PartPrint : public Print
+{
+public:
+    PartPrint(char *buffer, size_t size) : buffer(buffer), size(size), length(0) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t count) override
+    {
+        size_t n = min(count, size - length);
+        memcpy(buffer + length, data, n);
+        length += n;
+        return n;
+    }
+
+    size_t getLength() const { return length; }
+
+private:
+    char *buffer;
+    size_t size;
+    size_t length;
+};
+
+static Histogram requestHistograms[ROUTE_COUNT];
+static Histogram readHistograms[MAX_LOAD_CELLS];
+static std::atomic<uint32_t> responseCounts[4]; // 2xx to 5xx
+static std::atomic<uint32_t> cacheResultCounts[CACHE_RESULT_COUNT];
+
+// Function Prototypes
+static void writeLine(Print &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void writeHeader(Print &out, const char *name, const char *type, const char *help);
+static bool writeFamily(Print &out, uint8_t family, int item, int numCells);
+
+/* Histogram */
+
+Histogram::Histogram()
+{
+    for (std::atomic<uint32_t> &bucket : buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sumUs.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(const HistogramBuckets &layout, uint32_t us)
+{
+    int i = 0;
+    while (i < layout.count && us > layout.bounds[i])
+    {
+        i++;
+    }
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    sumUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+void Histogram::write(Print &out, const HistogramBuckets &layout, const char *name, const char *labels) const
+{
+    uint32_t cumulative = 0;
+    for (int i = 0; i <= layout.count; ++i)
+    {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        writeLine(out, "%s_bucket{%s,le=\"%s\"} %lu\n", name, labels, i < layout.count ? layout.labels[i] : "+Inf",
+                  (unsigned long)cumulative);
+    }
+    writeLine(out, "%s_sum{%s} %.6f\n", name, labels, sumUs.load(std::memory_order_relaxed) / 1e6);
+    writeLine(out, "%s_count{%s} %lu\n", name, labels, (unsigned long)cumulative);
+}
+
+/* Recording */
+
+void observeRequest(MetricsRoute route, uint32_t us)
+{
+    requestHistograms[route].observe(requestBuckets, us);
+}
+
+void countResponse(int statusCode)
+{
+    int statusClass = statusCode / 100 - 2;
+    if (statusClass >= 0 && statusClass < 4)
+    {
+        responseCounts[statusClass].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void countCacheResult(CacheResult result)
+{
+    cacheResultCounts[result].fetch_add(1, std::memory_order_relaxed);
+}
+
+void observeScaleRead(int index, uint32_t us)
+{
+    readHistograms[index].observe(readBuckets, us);
+}
+
+/* Exposition */
+
+MetricsEncoder::MetricsEncoder(int numCells)
+    : numCells(min(numCells, MAX_LOAD_CELLS)), family(FAMILY_REQUEST_DURATION), item(0), pendingLength(0), pendingOffset(0)
+{
+}
+
+size_t MetricsEncoder::read(uint8_t *buffer, size_t maxLen)
+{
+    size_t written = 0;
+    while (written < maxLen)
+    {
+        if (pendingOffset == pendingLength && !fill())
+        {
+            break;
+        }
+        size_t n = min(maxLen - written, pendingLength - pendingOffset);
+        memcpy(buffer + written, pending + pendingOffset, n);
+        pendingOffset += n;
+        written += n;
+    }
+    return written;
+}
+
+// Format the next part into pending, false once the body is complete
+bool MetricsEncoder::fill()
+{
+    pendingOffset = 0;
+    pendingLength = 0;
+
+    while (family < FAMILY_COUNT)
+    {
+        PartPrint out(pending, sizeof(pending));
+        if (!writeFamily(out, family, item++, numCells))
+        {
+            family++;
+            item = 0;
+        }
+        if (out.getLength() > 0)
+        {
+            pendingLength = out.getLength();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Write one item of a family, the header with the first one. Returns true
+// if the family has more items.
+static bool writeFamily(Print &out, uint8_t family, int item, int numCells)
+{
+    char labels[48];
+
+    switch (family)
+    {
+    case FAMILY_REQUEST_DURATION:
+        if (item == 0)
+        {
+            writeHeader(out, "rimming_http_request_duration_seconds", "histogram", "Time spent in the route handler");
+        }
+        snprintf(labels, sizeof(labels), "route=\"%s\"", routeNames[item]);
+        requestHistograms[item].write(out, requestBuckets, "rimming_http_request_duration_seconds", labels);
+        return item + 1 < ROUTE_COUNT;
+
+    case FAMILY_RESPONSES:
+        writeHeader(out, "rimming_http_responses_total", "counter", "Responses of the JSON routes, by status class");
+        for (int i = 0; i < 4; ++i)
+        {
+            writeLine(out, "rimming_http_responses_total{code=\"%dxx\"} %lu\n", i + 2,
+                      (unsigned long)responseCounts[i].load(std::memory_order_relaxed));
+        }
+        return false;
+
+    case FAMILY_CACHE:
+        writeHeader(out, "rimming_http_cache_total", "counter", "Cacheable GET requests, by how they were answered");
+        for (int i = 0; i < CACHE_RESULT_COUNT; ++i)
+        {
+            writeLine(out, "rimming_http_cache_total{result=\"%s\"} %lu\n", cacheResultNames[i],
+                      (unsigned long)cacheResultCounts[i].load(std::memory_order_relaxed));
+        }
+        return false;
+
+    case FAMILY_WEBHOOKS:
+        writeHeader(out, "rimming_webhook_alerts_total", "counter", "Threshold alerts posted to the webhook, by outcome");
+        for (int i = 0; i < WEBHOOK_RESULT_COUNT; ++i)
+        {
+            writeLine(out, "rimming_webhook_alerts_total{result=\"%s\"} %lu\n", webhookResultNames[i],
+                      (unsigned long)getWebhookCount((WebhookResult)i));
+        }
+        writeHeader(out, "rimming_webhook_queued_alerts", "gauge", "Alerts waiting for delivery");
+        writeLine(out, "rimming_webhook_queued_alerts %d\n", getQueuedAlerts());
+        return false;
+
+    case FAMILY_CELL_COUNTERS:
+    {
+        const CellCounter &counter = cellCounters[item];
+        writeHeader(out, counter.name, "counter", counter.help);
+        for (int i = 0; i < numCells; ++i)
+        {
+            writeLine(out, "%s{cell=\"%d\"} %lu\n", counter.name, i + 1, (unsigned long)counter.count(i));
+        }
+        return item + 1 < CELL_COUNTER_COUNT;
+    }
+
+    case FAMILY_READ_DURATION:
+        if (item == 0)
+        {
+            writeHeader(out, "rimming_hx711_read_duration_seconds", "histogram", "Time to clock out one conversion");
+        }
+        if (item < numCells)
+        {
+            snprintf(labels, sizeof(labels), "cell=\"%d\"", item + 1);
+            readHistograms[item].write(out, readBuckets, "rimming_hx711_read_duration_seconds", labels);
+        }
+        return item + 1 < numCells;
+
+    case FAMILY_HEAP:
+        writeHeader(out, "rimming_free_heap_bytes", "gauge", "Free heap");
+        writeLine(out, "rimming_free_heap_bytes %lu\n", (unsigned long)ESP.getFreeHeap());
+        writeHeader(out, "rimming_min_free_heap_bytes", "gauge", "Lowest free heap since boot");
+        writeLine(out, "rimming_min_free_heap_bytes %lu\n", (unsigned long)ESP.getMinFreeHeap());
+        writeHeader(out, "rimming_max_alloc_heap_bytes", "gauge", "Largest block that can be allocated");
+        writeLine(out, "rimming_max_alloc_heap_bytes %lu\n", (unsigned long)ESP.getMaxAllocHeap());
+        return false;
+
+    case FAMILY_WIFI:
+    {
+        writeHeader(out, "rimming_wifi_connected", "gauge", "1 if the station has an IP address");
+        bool connected = WiFi.isConnected();
+        writeLine(out, "rimming_wifi_connected %d\n", connected ? 1 : 0);
+        if (connected)
+        {
+            writeHeader(out, "rimming_wifi_rssi_dbm", "gauge", "Signal strength of the access point");
+            writeLine(out, "rimming_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+        }
+        return false;
+    }
+
+    case FAMILY_UPTIME:
+        writeHeader(out, "rimming_uptime_seconds", "counter", "Time since boot");
+        writeLine(out, "rimming_uptime_seconds %.3f\n", millis() / 1000.0);
+        return false;
+    }
+    return false;
+}
+
+// Format into a stack buffer, Print::printf() allocates for lines over 64 bytes
+static void writeLine(Print &out, const char *format, ...)
+{
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0)
+    {
+        out.write((const uint8_t *)line, min(length, (int)sizeof(line) - 1));
+    }
+}
+
+static void writeHeader(Print &out, const char *name, const char *type, const char *help)
+{
+    writeLine(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
@@ -0,0 +1,108 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+// Most buckets a histogram can have, +Inf not included
+#define HISTOGRAM_MAX_BUCKETS 12
+
+// Routes with their own request counters and latency histogram on /metrics
+enum MetricsRoute
+{
+    ROUTE_ROOT,
+    ROUTE_WEIGHT,
+    ROUTE_WEIGHT_STABLE,
+    ROUTE_WEIGHT_HISTORY,
+    ROUTE_CALIBRATION,
+    ROUTE_CALIBRATION_RUN,
+    ROUTE_TARE,
+    ROUTE_ALERTS,
+    ROUTE_FILTER,
+    ROUTE_ACQUISITION,
+    ROUTE_DRIFT,
+    ROUTE_CAPTURE,
+    ROUTE_CONSUMPTION,
+    ROUTE_BOOT,
+    ROUTE_BENCH,
+    ROUTE_METRICS,
+    ROUTE_COUNT
+};
+
+// How a GET with a cached body was answered, see response_cache.h
+enum CacheResult
+{
+    CACHE_NOT_MODIFIED, // 304, the client had the current version
+    CACHE_HIT,          // body sent from the cache
+    CACHE_MISS,         // body built from the latest readings
+    CACHE_RESULT_COUNT
+};
+
+// Upper limits of histogram buckets in µs, ascending, with their le labels
+// in seconds (e.g. 250 and "0.00025")
+struct HistogramBuckets
+{
+    const uint32_t *bounds;
+    const char *const *labels;
+    int count;
+};
+
+// Fixed-bucket histogram of durations. observe() is lock-free and may be
+// called from any task. write() reads the buckets one by one, so a scrape
+// may see an observation in the bucket counts but not yet in the sum.
+class Histogram
+{
+public:
+    Histogram();
+
+    void observe(const HistogramBuckets &layout, uint32_t us);
+
+    // Prometheus _bucket, _sum and _count lines, labels as in "route=\"/weight\""
+    void write(Print &out, const HistogramBuckets &layout, const char *name, const char *labels) const;
+
+private:
+    std::atomic<uint32_t> buckets[HISTOGRAM_MAX_BUCKETS + 1]; // not cumulative, the last one is +Inf
+    std::atomic<uint32_t> sumUs;                              // wraps after ~71 minutes of total time
+};
+
+// Count and time one request of a route (handler time only, deferred
+// responses are not included)
+void observeRequest(MetricsRoute route, uint32_t us);
+
+// Count a response by its status class
+void countResponse(int statusCode);
+
+// Count a request answered through the response cache
+void countCacheResult(CacheResult result);
+
+// Time of clocking one conversion out of an HX711
+void observeScaleRead(int index, uint32_t us);
+
+// Largest part of the /metrics body, one histogram (15 lines of up to
+// ~100 bytes) or metric family
+#define METRICS_PART_SIZE 2048
+
+// Streams all metrics in the Prometheus text exposition format for a
+// chunked response, one part at a time, so the body needs no buffer of its
+// own size. Values are read as each part is formatted.
+class MetricsEncoder
+{
+public:
+    MetricsEncoder(int numCells);
+
+    // Fill buffer with the next part of the body, 0 at the end
+    size_t read(uint8_t *buffer, size_t maxLen);
+
+private:
+    int numCells;
+    uint8_t family; // metric family of the next part
+    int item;       // route, cell or counter within the family
+    char pending[METRICS_PART_SIZE];
+    size_t pendingLength;
+    size_t pendingOffset;
+
+    bool fill();
+};
+
+#endif
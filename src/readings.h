@@ -0,0 +1,23 @@
+#ifndef READINGS_H
+#define READINGS_H
+
+#include <stdint.h>
+
+// Upper bound for the number of load cells, see cell_config.h. The ESP32
+// runs out of free GPIOs (one DOUT and one SCK per cell) before this.
+#define MAX_LOAD_CELLS 16
+
+// Latest state of a load cell, as published by the sampler task. The
+// calibration is the one the weight was computed with.
+struct LoadCellReading
+{
+    bool connected;     // false if the cell stopped producing samples
+    bool stable;        // weight has settled, see StabilityDetector
+    long raw;           // latest raw HX711 value
+    long offset;        // raw value at zero load (tare)
+    float factor;       // calibration factor, raw counts per gram
+    float weight;       // output of the filter chain, in grams
+    uint32_t timestamp; // millis() of the latest sample
+};
+
+#endif
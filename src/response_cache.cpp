@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "response_cache.h"
+
+static uint32_t bootId = 0;
+
+size_t formatETag(char *out, size_t size, uint32_t version)
+{
+    // Drawn on first use, the RF subsystem is up by the first request
+    while (bootId == 0)
+    {
+        bootId = esp_random();
+    }
+
+    int length = snprintf(out, size, "\"%08lx-%lx\"", (unsigned long)bootId, (unsigned long)version);
+    return length > 0 ? min((size_t)length, size - 1) : 0;
+}
+
+// The list is comma separated and may hold weak tags (W/"..."), which are
+// compared like strong ones as RFC 9110 asks for If-None-Match
+bool etagMatches(const char *ifNoneMatch, const char *etag)
+{
+    size_t etagLength = strlen(etag);
+    const char *item = ifNoneMatch;
+    while (*item != '\0')
+    {
+        while (*item == ' ' || *item == ',')
+        {
+            item++;
+        }
+        if (*item == '*')
+        {
+            return true;
+        }
+        if (strncmp(item, "W/", 2) == 0)
+        {
+            item += 2;
+        }
+        if (strncmp(item, etag, etagLength) == 0 && (item[etagLength] == '\0' || item[etagLength] == ',' || item[etagLength] == ' '))
+        {
+            return true;
+        }
+
+        const char *next = strchr(item, ',');
+        if (next == nullptr)
+        {
+            break;
+        }
+        item = next;
+    }
+    return false;
+}
@@ -0,0 +1,37 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Room for the quoted ETag of formatETag(), terminator included
+#define ETAG_SIZE 24
+
+// Large enough for the body of a single cell route, e.g. GET /weight/ID
+#define CELL_BODY_SIZE 96
+
+// Clients may keep a body but must revalidate it with If-None-Match before
+// using it, readings can change at any time
+#define CACHE_CONTROL "no-cache"
+
+// Pre-serialized body of a GET route, reused as long as the content version
+// it was built from (see getWeightVersion()) is current. Only touched by
+// route handlers, which all run in the AsyncTCP task, so there is no lock.
+template <size_t SIZE>
+struct CachedBody
+{
+    uint32_t version;
+    size_t length; // 0 until a body was built
+    char body[SIZE];
+
+    bool isCurrent(uint32_t current) const { return length > 0 && version == current; }
+};
+
+// Strong ETag of a content version. A random boot ID is part of the tag,
+// so tags from before a reboot never match.
+size_t formatETag(char *out, size_t size, uint32_t version);
+
+// True if an If-None-Match value lists the tag or is "*"
+bool etagMatches(const char *ifNoneMatch, const char *etag);
+
+#endif
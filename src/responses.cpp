@@ -0,0 +1,422 @@
+#include <math.h>
+#include <string.h>
+#include "responses.h"
+
+static const struct
+{
+    const char *name;
+    uint8_t flag;
+} readingFieldNames[] = {
+    {"weight", FIELD_WEIGHT},
+    {"stable", FIELD_STABLE},
+    {"raw", FIELD_RAW},
+    {"timestamp", FIELD_TIMESTAMP},
+};
+
+bool parseReadingFields(const char *list, uint8_t &fields)
+{
+    fields = 0;
+    while (*list != '\0')
+    {
+        const char *end = strchr(list, ',');
+        size_t length = end != nullptr ? (size_t)(end - list) : strlen(list);
+
+        bool known = false;
+        for (const auto &field : readingFieldNames)
+        {
+            if (strlen(field.name) == length && strncmp(field.name, list, length) == 0)
+            {
+                fields |= field.flag;
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            return false;
+        }
+        list += end != nullptr ? length + 1 : length;
+    }
+    return fields != 0;
+}
+
+// One element of a "load_cells" array with the selected fields
+void writeReading(JsonWriter &json, int id, const LoadCellReading &reading, uint8_t fields)
+{
+    json.beginObject();
+    json.add("id", id);
+    if (!reading.connected)
+    {
+        json.add("error", "Load cell not connected or not detected");
+    }
+    else
+    {
+        if (fields & FIELD_WEIGHT)
+        {
+            json.add("weight", reading.weight, 1);
+        }
+        if (fields & FIELD_STABLE)
+        {
+            json.add("stable", reading.stable);
+        }
+        if (fields & FIELD_RAW)
+        {
+            json.add("raw", reading.raw);
+        }
+        if (fields & FIELD_TIMESTAMP)
+        {
+            json.add("timestamp", (unsigned long)reading.timestamp);
+        }
+    }
+    json.endObject();
+}
+
+// "load_cells" array shared by GET /weight and the weight stream
+void writeLoadCells(JsonWriter &json, const LoadCellReading readings[], int count)
+{
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeReading(json, i + 1, readings[i], DEFAULT_READING_FIELDS);
+    }
+    json.endArray();
+}
+
+size_t formatWeights(char *out, size_t size, const LoadCellReading readings[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    writeLoadCells(json, readings, count);
+    json.endObject();
+    return json.length();
+}
+
+// GET /weight?ids=&fields=, readings[i] belongs to the cell ids[i]
+size_t formatSelectedWeights(char *out, size_t size, const int ids[], const LoadCellReading readings[], int count, uint8_t fields)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeReading(json, ids[i], readings[i], fields);
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatWeight(char *out, size_t size, int id, float weight, bool stable)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("id", id);
+    json.add("weight", weight, 1);
+    json.add("stable", stable);
+    json.endObject();
+    return json.length();
+}
+
+size_t formatStableWait(char *out, size_t size, int id, const LoadCellReading &reading, uint32_t waitedMs)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("id", id);
+    json.add("stable", reading.connected && reading.stable);
+    if (reading.connected)
+    {
+        json.add("weight", reading.weight, 1);
+    }
+    json.add("waited_ms", (unsigned long)waitedMs);
+    json.endObject();
+    return json.length();
+}
+
+size_t formatCalibrationFactors(char *out, size_t size, const float factors[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.beginArray("calibration_factors");
+    for (int i = 0; i < count; ++i)
+    {
+        json.beginObject();
+        json.add("id", i + 1);
+        json.add("calibration_factor", factors[i], 2);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatCalibrationFactor(char *out, size_t size, int id, float factor, const char *message)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    if (message != nullptr)
+    {
+        json.add("message", message);
+    }
+    json.add("id", id);
+    json.add("calibration_factor", factor, 2);
+    json.endObject();
+    return json.length();
+}
+
+// Totals per cell since boot and for the session
+size_t formatConsumption(char *out, size_t size, const ConsumptionSummary &summary, uint32_t sessionMs, int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("session", (int)summary.session);
+    json.add("session_ms", (unsigned long)sessionMs);
+    json.add("last_event", (unsigned long)summary.lastSequence);
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        json.beginObject();
+        json.add("id", i + 1);
+        json.add("consumed", summary.boot[i].consumed, 1);
+        json.add("dips", (unsigned long)summary.boot[i].dips);
+        json.add("refilled", summary.boot[i].refilled, 1);
+        json.add("refills", (unsigned long)summary.boot[i].refills);
+        json.add("session_consumed", summary.current[i].consumed, 1);
+        json.add("session_dips", (unsigned long)summary.current[i].dips);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+// One page of the event log, next is the ?since= of the following page
+size_t formatConsumptionEvents(char *out, size_t size, const ConsumptionEvent events[], int count, uint32_t next, uint32_t dropped, bool more)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("next", (unsigned long)next);
+    json.add("more", more);
+    json.add("dropped", (unsigned long)dropped);
+    json.beginArray("events");
+    for (int i = 0; i < count; ++i)
+    {
+        const ConsumptionEvent &event = events[i];
+        json.beginObject();
+        json.add("seq", (unsigned long)event.sequence);
+        json.add("id", event.cell + 1);
+        json.add("type", event.type == EVENT_DIP ? "dip" : "refill");
+        json.add("grams", event.grams, 1);
+        json.add("weight", event.weight, 1);
+        json.add("start_ms", (unsigned long)event.startMs);
+        json.add("end_ms", (unsigned long)event.endMs);
+        json.add("session", (int)event.session);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+// Thresholds and level of one cell, limits that are not set are null
+void writeAlertCell(JsonWriter &json, int id, const AlertThresholds &thresholds, AlertLevel level)
+{
+    json.beginObject();
+    json.add("id", id);
+    json.add("level", getAlertLevelName(level));
+    if (isnan(thresholds.low))
+    {
+        json.addRaw("low", "null");
+    }
+    else
+    {
+        json.add("low", thresholds.low, 1);
+    }
+    if (isnan(thresholds.high))
+    {
+        json.addRaw("high", "null");
+    }
+    else
+    {
+        json.add("high", thresholds.high, 1);
+    }
+    json.add("hysteresis", thresholds.hysteresis, 1);
+    json.endObject();
+}
+
+size_t formatAlerts(char *out, size_t size, const char *url, int queued, const AlertThresholds thresholds[], const AlertLevel levels[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("webhook", url);
+    json.add("queued", queued);
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeAlertCell(json, i + 1, thresholds[i], levels[i]);
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatAlertCell(char *out, size_t size, int id, const AlertThresholds &thresholds, AlertLevel level)
+{
+    JsonWriter json(out, size);
+    writeAlertCell(json, id, thresholds, level);
+    return json.length();
+}
+
+// Body of the webhook POST
+size_t formatAlertEvent(char *out, size_t size, const AlertEvent &event)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("seq", (unsigned long)event.sequence);
+    json.add("id", event.cell + 1);
+    json.add("level", getAlertLevelName((AlertLevel)event.level));
+    json.add("weight", event.weight, 1);
+    if (isnan(event.threshold))
+    {
+        json.addRaw("threshold", "null");
+    }
+    else
+    {
+        json.add("threshold", event.threshold, 1);
+    }
+    json.add("timestamp", (unsigned long)event.timestamp);
+    json.endObject();
+    return json.length();
+}
+
+size_t formatFilterConfig(char *out, size_t size, int id, const FilterConfig &config)
+{
+    static const char *smoothingNames[] = {"none", "ema", "kalman"};
+
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("id", id);
+    json.add("median", (int)config.medianWindow);
+    json.add("smoothing", smoothingNames[config.smoothing]);
+    json.add("alpha", config.emaAlpha, 3);
+    json.add("q", config.kalmanProcessNoise, 4);
+    json.add("r", config.kalmanMeasurementNoise, 4);
+    json.add("deadband", config.deadband, 2);
+    json.add("zero_band", config.zeroBand, 2);
+    json.endObject();
+    return json.length();
+}
+
+void writeAcquisitionCell(JsonWriter &json, int id, const AcquisitionStatus &status)
+{
+    json.beginObject();
+    json.add("id", id);
+    json.add("mode", getAcquisitionModeName(status.mode));
+    json.add("rate", !status.switchable ? "fixed" : status.fast ? "fast" : "slow");
+    json.add("active", status.active);
+    json.add("sps", (int)status.sps);
+    json.add("gain", (int)status.gain);
+    json.add("channel", status.gain == 32 ? "B" : "A");
+    json.endObject();
+}
+
+size_t formatAcquisition(char *out, size_t size, const AcquisitionStatus statuses[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeAcquisitionCell(json, i + 1, statuses[i]);
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatAcquisitionCell(char *out, size_t size, int id, const AcquisitionStatus &status)
+{
+    JsonWriter json(out, size);
+    writeAcquisitionCell(json, id, status);
+    return json.length();
+}
+
+void writeDriftCell(JsonWriter &json, int id, const DriftStatus &status)
+{
+    json.beginObject();
+    json.add("id", id);
+    json.add("auto_zero", status.config.autoZero);
+    json.add("tracked_g", status.tracked, 2);
+    json.add("drift", getDriftSourceName(status.config.source));
+    json.add("drift_rate", status.config.rate, 3);
+    json.add("modelled_g", status.modelled, 2);
+    json.endObject();
+}
+
+size_t formatDrift(char *out, size_t size, float temperature, const DriftStatus statuses[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("temperature", temperature, 1);
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeDriftCell(json, i + 1, statuses[i]);
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatDriftCell(char *out, size_t size, int id, const DriftStatus &status)
+{
+    JsonWriter json(out, size);
+    writeDriftCell(json, id, status);
+    return json.length();
+}
+
+// Factor, offset and residual of the last fit once there is one
+void writeCalibrationCell(JsonWriter &json, int id, const CalibrationStatus &status)
+{
+    json.beginObject();
+    json.add("id", id);
+    json.add("state", getCalibrationStateName(status.state));
+    json.add("points", (int)status.points);
+    if (status.state == CALIBRATION_COLLECTING)
+    {
+        json.add("grams", status.grams, 1);
+        json.add("remaining", (int)status.remaining);
+    }
+    if (status.error != CALIBRATION_OK)
+    {
+        json.add("error", getCalibrationErrorName(status.error));
+    }
+    if (status.factor != 0)
+    {
+        json.add("calibration_factor", status.factor, 2);
+        json.add("offset", status.offset);
+        json.add("residual_g", status.residual, 3);
+    }
+    json.endObject();
+}
+
+size_t formatCalibrationRun(char *out, size_t size, const CalibrationStatus statuses[], int count)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.beginArray("load_cells");
+    for (int i = 0; i < count; ++i)
+    {
+        writeCalibrationCell(json, i + 1, statuses[i]);
+    }
+    json.endArray();
+    json.endObject();
+    return json.length();
+}
+
+size_t formatError(char *out, size_t size, const char *message)
+{
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.add("error", message);
+    json.endObject();
+    return json.length();
+}
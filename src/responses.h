@@ -0,0 +1,70 @@
+#ifndef RESPONSES_H
+#define RESPONSES_H
+
+#include <stddef.h>
+#include "acquisition_status.h"
+#include "alerts.h"
+#include "calibration.h"
+#include "consumption.h"
+#include "drift.h"
+#include "filters.h"
+#include "json_writer.h"
+#include "readings.h"
+
+// Large enough for any response below with MAX_LOAD_CELLS cells
+#define RESPONSE_BUFFER_SIZE (96 + 80 * MAX_LOAD_CELLS)
+
+// Consumption routes, up to 120 bytes per cell or event
+#define CONSUMPTION_BUFFER_SIZE (128 + 120 * (MAX_LOAD_CELLS > CONSUMPTION_EVENTS_PER_PAGE ? MAX_LOAD_CELLS : CONSUMPTION_EVENTS_PER_PAGE))
+
+// GET /alerts, with the webhook URL and up to 96 bytes per cell
+#define ALERTS_BUFFER_SIZE (WEBHOOK_URL_SIZE + 128 + 96 * MAX_LOAD_CELLS)
+
+// GET /acquisition, up to 112 bytes per cell
+#define ACQUISITION_BUFFER_SIZE (32 + 112 * MAX_LOAD_CELLS)
+
+// GET /drift, up to 128 bytes per cell
+#define DRIFT_BUFFER_SIZE (48 + 128 * MAX_LOAD_CELLS)
+
+// GET /calibration, up to 160 bytes per cell
+#define CALIBRATION_BUFFER_SIZE (32 + 160 * MAX_LOAD_CELLS)
+
+// Reading fields selectable with ?fields= on GET /weight
+#define FIELD_WEIGHT 0x01
+#define FIELD_STABLE 0x02
+#define FIELD_RAW 0x04
+#define FIELD_TIMESTAMP 0x08
+#define DEFAULT_READING_FIELDS (FIELD_WEIGHT | FIELD_STABLE)
+
+// Parse a comma separated field list such as "weight,raw" into a mask,
+// returns false on an unknown or empty name
+bool parseReadingFields(const char *list, uint8_t &fields);
+
+// JSON bodies of the REST routes, formatted into fixed buffers without heap
+// allocation. Each function returns the body length.
+void writeLoadCells(JsonWriter &json, const LoadCellReading readings[], int count);
+void writeReading(JsonWriter &json, int id, const LoadCellReading &reading, uint8_t fields);
+size_t formatWeights(char *out, size_t size, const LoadCellReading readings[], int count);
+size_t formatSelectedWeights(char *out, size_t size, const int ids[], const LoadCellReading readings[], int count, uint8_t fields);
+size_t formatWeight(char *out, size_t size, int id, float weight, bool stable);
+size_t formatStableWait(char *out, size_t size, int id, const LoadCellReading &reading, uint32_t waitedMs);
+size_t formatCalibrationFactors(char *out, size_t size, const float factors[], int count);
+size_t formatCalibrationFactor(char *out, size_t size, int id, float factor, const char *message = nullptr);
+size_t formatConsumption(char *out, size_t size, const ConsumptionSummary &summary, uint32_t sessionMs, int count);
+size_t formatConsumptionEvents(char *out, size_t size, const ConsumptionEvent events[], int count, uint32_t next, uint32_t dropped, bool more);
+void writeAlertCell(JsonWriter &json, int id, const AlertThresholds &thresholds, AlertLevel level);
+size_t formatAlerts(char *out, size_t size, const char *url, int queued, const AlertThresholds thresholds[], const AlertLevel levels[], int count);
+size_t formatAlertCell(char *out, size_t size, int id, const AlertThresholds &thresholds, AlertLevel level);
+size_t formatAlertEvent(char *out, size_t size, const AlertEvent &event);
+size_t formatFilterConfig(char *out, size_t size, int id, const FilterConfig &config);
+void writeAcquisitionCell(JsonWriter &json, int id, const AcquisitionStatus &status);
+size_t formatAcquisition(char *out, size_t size, const AcquisitionStatus statuses[], int count);
+size_t formatAcquisitionCell(char *out, size_t size, int id, const AcquisitionStatus &status);
+void writeDriftCell(JsonWriter &json, int id, const DriftStatus &status);
+size_t formatDrift(char *out, size_t size, float temperature, const DriftStatus statuses[], int count);
+size_t formatDriftCell(char *out, size_t size, int id, const DriftStatus &status);
+void writeCalibrationCell(JsonWriter &json, int id, const CalibrationStatus &status);
+size_t formatCalibrationRun(char *out, size_t size, const CalibrationStatus statuses[], int count);
+size_t formatError(char *out, size_t size, const char *message);
+
+#endif
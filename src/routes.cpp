@@ -1,39 +1,101 @@
 #include <Arduino.h>
 #include <ESPAsyncWebServer.h>
-#include <ArduinoJson.h>
-#include "HX711.h"
+#include <math.h>
+#include <memory>
+#include "alerts.h"
+#include "bench.h"
+#include "boot_timing.h"
+#include "calibration_store.h"
+#include "cell_config.h"
+#include "consumption.h"
+#include "history.h"
+#include "metrics.h"
+#include "response_cache.h"
 #include "routes.h"
+#include "responses.h"
+#include "sampler.h"
+#include "stable_wait.h"
+#include "stream.h"
 
 // #define ASYNCWEBSERVER_REGEX
 
 // External Variables
-extern float calibration_factors[]; // Defined in main.cpp
-extern HX711 scales[];              // Defined in main.cpp
-extern const int NUM_LOAD_CELLS;    // Defined in main.cpp
+extern CellConfig cellConfig; // Defined in main.cpp
+
+// Bodies of the polled GET routes, rebuilt only when their version moves
+static CachedBody<RESPONSE_BUFFER_SIZE> weightsCache;
+static CachedBody<CELL_BODY_SIZE> weightCaches[MAX_LOAD_CELLS];
+static CachedBody<RESPONSE_BUFFER_SIZE> calibrationFactorsCache;
+static CachedBody<CELL_BODY_SIZE> calibrationFactorCaches[MAX_LOAD_CELLS];
 
 // Function Prototypes for Route Handlers
 void handleRoot(AsyncWebServerRequest *request);
 void handleGetWeight(AsyncWebServerRequest *request);
+void handleGetSelectedWeights(AsyncWebServerRequest *request);
 void handleGetWeightByID(AsyncWebServerRequest *request, int id);
+void handleWaitForStableByID(AsyncWebServerRequest *request, int id);
+void handleGetHistoryByID(AsyncWebServerRequest *request, int id);
 
 void handleGetCalibrationFactors(AsyncWebServerRequest *request);
 void handleGetCalibrationFactorByID(AsyncWebServerRequest *request, int id);
 void handleSetCalibrationFactorByID(AsyncWebServerRequest *request, int id);
 
-// Helper Functions
-void sendJSONResponse(AsyncWebServerRequest *request, int statusCode, const String &jsonContent);
-void sendErrorResponse(AsyncWebServerRequest *request, int statusCode, const String &errorMessage);
+void handleTare(AsyncWebServerRequest *request, int id);
+void handleGetCalibrationRun(AsyncWebServerRequest *request);
+void handleCalibrationPoint(AsyncWebServerRequest *request, bool zero);
+
+void handleGetAlerts(AsyncWebServerRequest *request);
+void handleGetAlertsByID(AsyncWebServerRequest *request, int id);
+void handleSetAlertsByID(AsyncWebServerRequest *request, int id);
+void handleSetWebhook(AsyncWebServerRequest *request);
+
+void handleGetFilterByID(AsyncWebServerRequest *request, int id);
+void handleSetFilterByID(AsyncWebServerRequest *request, int id);
+
+void handleGetAcquisition(AsyncWebServerRequest *request);
+void handleGetAcquisitionByID(AsyncWebServerRequest *request, int id);
+void handleSetAcquisitionByID(AsyncWebServerRequest *request, int id);
+
+void handleGetDrift(AsyncWebServerRequest *request);
+void handleGetDriftByID(AsyncWebServerRequest *request, int id);
+void handleSetDriftByID(AsyncWebServerRequest *request, int id);
+
+void handleStartCapture(AsyncWebServerRequest *request);
+void handleStopCapture(AsyncWebServerRequest *request);
+void handleGetCaptureStatus(AsyncWebServerRequest *request);
+void handleDownloadCapture(AsyncWebServerRequest *request);
+bool checkCaptureGeneration(AsyncWebServerRequest *request, uint32_t generation);
+
+void handleGetConsumption(AsyncWebServerRequest *request);
+void handleGetConsumptionEvents(AsyncWebServerRequest *request);
+void handleStartConsumptionSession(AsyncWebServerRequest *request);
+
+void handleGetBootTimes(AsyncWebServerRequest *request);
+void handleGetBench(AsyncWebServerRequest *request);
+void handleGetMetrics(AsyncWebServerRequest *request);
+
+ArRequestHandlerFunction timed(MetricsRoute route, ArRequestHandlerFunction handler);
+
+int parseIdList(const String &list, int ids[], int maxIds);
+bool parseLimit(const String &text, float &limit);
+
+template <size_t SIZE>
+bool sendFromCache(AsyncWebServerRequest *request, const CachedBody<SIZE> &cache, uint32_t version);
+template <size_t SIZE>
+void sendCachedBody(AsyncWebServerRequest *request, const CachedBody<SIZE> &cache);
+
 
 /* Route Handler Implementations */
-void setupRoutes(AsyncWebServer &server, HX711 scales[], int numScales)
+// Every handler is wrapped by timed() so /metrics can count and time it
+void setupRoutes(AsyncWebServer &server)
 {
     /* GENERAL ROUTES */
-    server.on("/", HTTP_GET, handleRoot);   
+    server.on("/", HTTP_GET, timed(ROUTE_ROOT, handleRoot));   
 
     /* SCALE ROUTES */
 
     // Route to handle /weight and /weight/ID
-    server.on("^/weight(?:/(\\d+))?$", HTTP_GET, [](AsyncWebServerRequest *request)
+    server.on("^/weight(?:/(\\d+))?$", HTTP_GET, timed(ROUTE_WEIGHT, [](AsyncWebServerRequest *request)
               {
         if (request->pathArg(0) == "")
         {
@@ -45,10 +107,22 @@ void setupRoutes(AsyncWebServer &server, HX711 scales[], int numScales)
             // ID provided
             int id = request->pathArg(0).toInt();
             handleGetWeightByID(request, id);
-        } });
+        } }));
+
+    // Route to handle /weight/ID/stable, answers once the weight has settled
+    server.on("^/weight/(\\d+)/stable$", HTTP_GET, timed(ROUTE_WEIGHT_STABLE, [](AsyncWebServerRequest *request)
+              { handleWaitForStableByID(request, request->pathArg(0).toInt()); }));
+    startStableWaiters();
+
+    // Route to handle /weight/ID/history, min/max/mean per 1 s, 10 s or 1 min
+    server.on("^/weight/(\\d+)/history$", HTTP_GET, timed(ROUTE_WEIGHT_HISTORY, [](AsyncWebServerRequest *request)
+              { handleGetHistoryByID(request, request->pathArg(0).toInt()); }));
+
+    // WebSocket at /weight/stream pushing all weights at a client-chosen interval
+    setupWeightStream(server);
 
     // Route to handle /calibration_factor and /calibration_factor/ID
-    server.on("^/calibration_factor(?:/(\\d+))?$", HTTP_GET, [](AsyncWebServerRequest *request)
+    server.on("^/calibration_factor(?:/(\\d+))?$", HTTP_GET, timed(ROUTE_CALIBRATION, [](AsyncWebServerRequest *request)
               {
         if (request->pathArg(0) == "")
         {
@@ -60,10 +134,10 @@ void setupRoutes(AsyncWebServer &server, HX711 scales[], int numScales)
             // ID provided
             int id = request->pathArg(0).toInt();
             handleGetCalibrationFactorByID(request, id);
-        } });
+        } }));
 
     // Set calibration factor for a specific load cell
-    server.on("^/calibration_factor(?:/(\\d+))?$", HTTP_POST, [](AsyncWebServerRequest *request)
+    server.on("^/calibration_factor(?:/(\\d+))?$", HTTP_POST, timed(ROUTE_CALIBRATION, [](AsyncWebServerRequest *request)
               {
         if (request->pathArg(0) == "")
         {
@@ -73,7 +147,78 @@ void setupRoutes(AsyncWebServer &server, HX711 scales[], int numScales)
         {
             int id = request->pathArg(0).toInt();
             handleSetCalibrationFactorByID(request, id);
-        } });
+        } }));
+
+    // Re-tare all load cells (/tare) or a specific one (/tare/ID)
+    server.on("^/tare(?:/(\\d+))?$", HTTP_POST, timed(ROUTE_TARE, [](AsyncWebServerRequest *request)
+              {
+        int id = request->pathArg(0) == "" ? 0 : request->pathArg(0).toInt();
+        handleTare(request, id); }));
+
+    // Calibrate all cells at once: readings at zero, then at a known mass
+    server.on("^/calibration$", HTTP_GET, timed(ROUTE_CALIBRATION_RUN, handleGetCalibrationRun));
+    server.on("/calibration/zero", HTTP_POST, timed(ROUTE_CALIBRATION_RUN, [](AsyncWebServerRequest *request)
+              { handleCalibrationPoint(request, true); }));
+    server.on("/calibration/mass", HTTP_POST, timed(ROUTE_CALIBRATION_RUN, [](AsyncWebServerRequest *request)
+              { handleCalibrationPoint(request, false); }));
+
+    // Low and high thresholds per cell, crossings are posted to the webhook
+    server.on("^/alerts$", HTTP_GET, timed(ROUTE_ALERTS, handleGetAlerts));
+    server.on("^/alerts/(\\d+)$", HTTP_GET, timed(ROUTE_ALERTS, [](AsyncWebServerRequest *request)
+              { handleGetAlertsByID(request, request->pathArg(0).toInt()); }));
+    server.on("^/alerts/(\\d+)$", HTTP_POST, timed(ROUTE_ALERTS, [](AsyncWebServerRequest *request)
+              { handleSetAlertsByID(request, request->pathArg(0).toInt()); }));
+    server.on("^/alerts/webhook$", HTTP_POST, timed(ROUTE_ALERTS, handleSetWebhook));
+
+    /* FILTER ROUTES */
+
+    // Get or change the filter chain of a specific load cell
+    server.on("^/filter/(\\d+)$", HTTP_GET, timed(ROUTE_FILTER, [](AsyncWebServerRequest *request)
+              { handleGetFilterByID(request, request->pathArg(0).toInt()); }));
+
+    server.on("^/filter/(\\d+)$", HTTP_POST, timed(ROUTE_FILTER, [](AsyncWebServerRequest *request)
+              { handleSetFilterByID(request, request->pathArg(0).toInt()); }));
+
+    /* ACQUISITION ROUTES */
+
+    // Output rate mode and gain of the HX711s
+    server.on("^/acquisition$", HTTP_GET, timed(ROUTE_ACQUISITION, handleGetAcquisition));
+    server.on("^/acquisition/(\\d+)$", HTTP_GET, timed(ROUTE_ACQUISITION, [](AsyncWebServerRequest *request)
+              { handleGetAcquisitionByID(request, request->pathArg(0).toInt()); }));
+    server.on("^/acquisition/(\\d+)$", HTTP_POST, timed(ROUTE_ACQUISITION, [](AsyncWebServerRequest *request)
+              { handleSetAcquisitionByID(request, request->pathArg(0).toInt()); }));
+
+    /* DRIFT ROUTES */
+
+    // Auto-zero and the drift model of the zero offsets
+    server.on("^/drift$", HTTP_GET, timed(ROUTE_DRIFT, handleGetDrift));
+    server.on("^/drift/(\\d+)$", HTTP_GET, timed(ROUTE_DRIFT, [](AsyncWebServerRequest *request)
+              { handleGetDriftByID(request, request->pathArg(0).toInt()); }));
+    server.on("^/drift/(\\d+)$", HTTP_POST, timed(ROUTE_DRIFT, [](AsyncWebServerRequest *request)
+              { handleSetDriftByID(request, request->pathArg(0).toInt()); }));
+
+    /* CAPTURE ROUTES */
+
+    // Record raw readings of all cells and download them in binary form
+    server.on("/capture/start", HTTP_POST, timed(ROUTE_CAPTURE, handleStartCapture));
+    server.on("/capture/stop", HTTP_POST, timed(ROUTE_CAPTURE, handleStopCapture));
+    server.on("/capture/status", HTTP_GET, timed(ROUTE_CAPTURE, handleGetCaptureStatus));
+    server.on("^/capture$", HTTP_GET, timed(ROUTE_CAPTURE, handleDownloadCapture));
+
+    /* CONSUMPTION ROUTES */
+
+    // Grams used per cell, the dip and refill log, and sessions to total a batch
+    server.on("^/consumption$", HTTP_GET, timed(ROUTE_CONSUMPTION, handleGetConsumption));
+    server.on("/consumption/events", HTTP_GET, timed(ROUTE_CONSUMPTION, handleGetConsumptionEvents));
+    server.on("/consumption/session", HTTP_POST, timed(ROUTE_CONSUMPTION, handleStartConsumptionSession));
+
+    server.on("/boot", HTTP_GET, timed(ROUTE_BOOT, handleGetBootTimes));
+
+    // Micro-benchmarks of the request and sample paths, see bench.h
+    server.on("/bench", HTTP_GET, timed(ROUTE_BENCH, handleGetBench));
+
+    // Counters and latency histograms for Prometheus
+    server.on("/metrics", HTTP_GET, timed(ROUTE_METRICS, handleGetMetrics));
 }
 
 // Handle root URL
@@ -85,36 +230,110 @@ void handleRoot(AsyncWebServerRequest *request)
 // Handle GET request for all weights
 void handleGetWeight(AsyncWebServerRequest *request)
 {
-    JsonDocument jsonDoc;
-    JsonArray loadCells = jsonDoc["load_cells"].to<JsonArray>();
+    if (request->hasParam("ids") || request->hasParam("fields"))
+    {
+        handleGetSelectedWeights(request);
+        return;
+    }
 
-    for (int i = 0; i < NUM_LOAD_CELLS; ++i)
+    // Versions only grow, their sum moves whenever one of them does
+    uint32_t version = 0;
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        version += getWeightVersion(i);
+    }
+    if (sendFromCache(request, weightsCache, version))
     {
-        JsonObject cell = loadCells.add<JsonObject>();
+        return;
+    }
 
-        cell["id"] = i + 1;
-        if (!scales[i].is_ready())
-        {
-            cell["error"] = "Load cell not connected or not detected";
-        }
-        else
+    LoadCellReading readings[MAX_LOAD_CELLS];
+
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        readings[i] = getLatestReading(i); // Filtered, no negative values
+    }
+
+    weightsCache.length = formatWeights(weightsCache.body, sizeof(weightsCache.body), readings, cellConfig.count);
+    weightsCache.version = version;
+    sendCachedBody(request, weightsCache);
+}
+
+// Handle GET request for some cells and fields in one round trip,
+// e.g. /weight?ids=1,3&fields=weight,stable,raw. Both parameters are optional.
+void handleGetSelectedWeights(AsyncWebServerRequest *request)
+{
+    int ids[MAX_LOAD_CELLS];
+    int count = cellConfig.count;
+    for (int i = 0; i < count; ++i)
+    {
+        ids[i] = i + 1;
+    }
+    if (request->hasParam("ids"))
+    {
+        count = parseIdList(request->getParam("ids")->value(), ids, MAX_LOAD_CELLS);
+        if (count < 0)
         {
-            float weight = scales[i].get_units(5); // Read average of 5 readings
-            // Ensure weight is rounded to 1 decimal and no negative values
-            weight = (weight <= 0) ? 0 : round(weight * 10) / 10.0;
-            cell["weight"] = weight;
+            sendErrorResponse(request, 400, "Invalid load cell ID");
+            return;
         }
     }
 
-    String jsonResponse;
-    serializeJson(jsonDoc, jsonResponse);
-    sendJSONResponse(request, 200, jsonResponse);
+    uint8_t fields = DEFAULT_READING_FIELDS;
+    if (request->hasParam("fields") && !parseReadingFields(request->getParam("fields")->value().c_str(), fields))
+    {
+        sendErrorResponse(request, 400, "Invalid field, use weight, stable, raw or timestamp");
+        return;
+    }
+
+    // Only the requested cells are read
+    LoadCellReading readings[MAX_LOAD_CELLS];
+    for (int i = 0; i < count; ++i)
+    {
+        readings[i] = getLatestReading(ids[i] - 1);
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatSelectedWeights(body, sizeof(body), ids, readings, count, fields);
+    sendJSONResponse(request, 200, body, length);
 }
 
 // Handle GET request for weight by ID
 void handleGetWeightByID(AsyncWebServerRequest *request, int id)
 {
-    if (id < 1 || id > NUM_LOAD_CELLS)
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int index = id - 1;
+
+    // A cached body is only built while the cell is connected, a disconnect
+    // moves the version
+    CachedBody<CELL_BODY_SIZE> &cache = weightCaches[index];
+    uint32_t version = getWeightVersion(index);
+    if (sendFromCache(request, cache, version))
+    {
+        return;
+    }
+
+    LoadCellReading reading = getLatestReading(index);
+    if (!reading.connected)
+    {
+        sendErrorResponse(request, 500, "Load cell not connected or not detected");
+        return;
+    }
+
+    cache.length = formatWeight(cache.body, sizeof(cache.body), id, reading.weight, reading.stable);
+    cache.version = version;
+    sendCachedBody(request, cache);
+}
+
+// Handle GET request waiting until the weight is stable, or ?timeout= ms passed
+void handleWaitForStableByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
     {
         sendErrorResponse(request, 400, "Invalid load cell ID");
         return;
@@ -122,24 +341,83 @@ void handleGetWeightByID(AsyncWebServerRequest *request, int id)
 
     int index = id - 1;
 
-    if (!scales[index].is_ready())
+    uint32_t timeoutMs = STABLE_WAIT_DEFAULT_TIMEOUT_MS;
+    if (request->hasParam("timeout"))
+    {
+        timeoutMs = constrain(request->getParam("timeout")->value().toInt(), 0, STABLE_WAIT_MAX_TIMEOUT_MS);
+    }
+
+    LoadCellReading reading = getLatestReading(index);
+    if (!reading.connected)
     {
         sendErrorResponse(request, 500, "Load cell not connected or not detected");
         return;
     }
 
-    float weight = scales[index].get_units(5);
-    // Ensure weight is rounded to 1 decimal and no negative values
-    weight = (weight <= 2) ? 0 : round(weight * 10) / 10.0;
+    // Already settled (or no waiting wanted), answer right away
+    if (reading.stable || timeoutMs == 0)
+    {
+        char body[RESPONSE_BUFFER_SIZE];
+        size_t length = formatStableWait(body, sizeof(body), id, reading, 0);
+        sendJSONResponse(request, 200, body, length);
+        return;
+    }
 
-    String jsonResponse = "{\"id\": " + String(id) + ", \"weight\": " + String(weight, 1) + "}";
-    sendJSONResponse(request, 200, jsonResponse);
+    if (!addStableWaiter(request, index, timeoutMs))
+    {
+        sendErrorResponse(request, 503, "Too many requests waiting for a stable weight");
+    }
+}
+
+// Handle GET request for the weight history of a load cell. ?from= is a
+// device timestamp in ms (negative: ms before now, default: as far back as
+// kept), ?step= 1, 10 or 60 s (default: the finest that reaches back to from).
+// Streamed bucket by bucket, hours of history need no large buffer.
+void handleGetHistoryByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    if (!isHistoryEnabled())
+    {
+        sendErrorResponse(request, 503, "History is off, not enough memory");
+        return;
+    }
+
+    int index = id - 1;
+    uint32_t fromMs = 0;
+    if (request->hasParam("from"))
+    {
+        long long from = strtoll(request->getParam("from")->value().c_str(), nullptr, 10);
+        long long now = millis();
+        fromMs = (uint32_t)constrain(from < 0 ? now + from : from, 0LL, now);
+    }
+
+    int tier = selectHistoryTier(index, fromMs);
+    if (request->hasParam("step"))
+    {
+        long step = request->getParam("step")->value().toInt();
+        tier = step > 0 ? findHistoryTier(step * 1000) : -1;
+        if (tier < 0)
+        {
+            sendErrorResponse(request, 400, "'step' must be 1, 10 or 60");
+            return;
+        }
+    }
+
+    std::shared_ptr<HistoryEncoder> encoder = std::make_shared<HistoryEncoder>(index, tier, fromMs);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [encoder](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                                     { return encoder->read(buffer, maxLen); });
+    request->send(response);
 }
 
 // Handle GET request for calibration factor by ID
 void handleGetCalibrationFactorByID(AsyncWebServerRequest *request, int id)
 {
-    if (id < 1 || id > NUM_LOAD_CELLS)
+    if (id < 1 || id > cellConfig.count)
     {
         sendErrorResponse(request, 400, "Invalid load cell ID");
         return;
@@ -147,51 +425,67 @@ void handleGetCalibrationFactorByID(AsyncWebServerRequest *request, int id)
 
     int index = id - 1;
 
-    String jsonResponse = "{\"id\": " + String(id) + ", \"calibration_factor\": " + String(calibration_factors[index], 2) + "}";
-    sendJSONResponse(request, 200, jsonResponse);
+    CachedBody<CELL_BODY_SIZE> &cache = calibrationFactorCaches[index];
+    uint32_t version = getCalibrationVersion(index);
+    if (sendFromCache(request, cache, version))
+    {
+        return;
+    }
+
+    cache.length = formatCalibrationFactor(cache.body, sizeof(cache.body), id, getLatestReading(index).factor);
+    cache.version = version;
+    sendCachedBody(request, cache);
 }
 
 // Handle GET request for all calibration factors
 void handleGetCalibrationFactors(AsyncWebServerRequest *request)
 {
-    JsonDocument jsonDoc;
-
-    JsonArray calFactors = jsonDoc["calibration_factors"].to<JsonArray>();
-
-    for (int i = 0; i < NUM_LOAD_CELLS; ++i)
+    uint32_t version = 0;
+    for (int i = 0; i < cellConfig.count; ++i)
     {
-        JsonObject calFactor = calFactors.add<JsonObject>();
+        version += getCalibrationVersion(i);
+    }
+    if (sendFromCache(request, calibrationFactorsCache, version))
+    {
+        return;
+    }
 
-        calFactor["id"] = i + 1;
-        calFactor["calibration_factor"] = calibration_factors[i];
+    float factors[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        factors[i] = getLatestReading(i).factor;
     }
 
-    String jsonResponse;
-    serializeJson(jsonDoc, jsonResponse);
-    sendJSONResponse(request, 200, jsonResponse);
+    calibrationFactorsCache.length = formatCalibrationFactors(calibrationFactorsCache.body, sizeof(calibrationFactorsCache.body),
+                                                              factors, cellConfig.count);
+    calibrationFactorsCache.version = version;
+    sendCachedBody(request, calibrationFactorsCache);
 }
 
 // Handle POST request to set calibration factor
 void handleSetCalibrationFactorByID(AsyncWebServerRequest *request, int id)
 {
-    if (id < 1 || id > NUM_LOAD_CELLS)
+    if (id < 1 || id > cellConfig.count)
     {
         sendErrorResponse(request, 400, "Invalid load cell ID");
         return;
     }
 
-    int index = id - 1;
-
     if (request->hasParam("value", true))
     {
         float newCalFactor = request->getParam("value", true)->value().toFloat();
-        calibration_factors[index] = newCalFactor;
+        if (newCalFactor == 0 || !isfinite(newCalFactor))
+        {
+            sendErrorResponse(request, 400, "Calibration factor must be a non-zero number");
+            return;
+        }
 
-        // Update the scale's calibration factor
-        scales[index].set_scale(calibration_factors[index]);
+        // Applied by the sampler task between two samples and saved to SPIFFS
+        setCalibrationFactor(id - 1, newCalFactor);
 
-        String response = "{\"message\": \"Calibration factor updated successfully\", \"id\": " + String(id) + ", \"calibration_factor\": " + String(calibration_factors[index], 2) + "}";
-        sendJSONResponse(request, 200, response);
+        char body[RESPONSE_BUFFER_SIZE];
+        size_t length = formatCalibrationFactor(body, sizeof(body), id, newCalFactor, "Calibration factor updated successfully");
+        sendJSONResponse(request, 200, body, length);
     }
     else
     {
@@ -199,20 +493,808 @@ void handleSetCalibrationFactorByID(AsyncWebServerRequest *request, int id)
     }
 }
 
+// Handle POST request to tare one cell (id >= 1) or all cells (id 0).
+// The new offset is taken from the next readings and saved to SPIFFS.
+void handleTare(AsyncWebServerRequest *request, int id)
+{
+    if (id < 0 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int samples = TARE_DEFAULT_SAMPLES;
+    if (request->hasParam("samples", true))
+    {
+        samples = constrain(request->getParam("samples", true)->value().toInt(), 1, 100);
+    }
+
+    requestTare(id - 1, samples);
+
+    char body[RESPONSE_BUFFER_SIZE];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject();
+    json.add("message", "Tare started, remove all weight from the plate");
+    if (id > 0)
+    {
+        json.add("id", id);
+    }
+    json.add("samples", samples);
+    json.endObject();
+    sendJSONResponse(request, 202, body, json.length());
+}
+
+// Handle GET request for the progress and result of the calibration run
+void handleGetCalibrationRun(AsyncWebServerRequest *request)
+{
+    CalibrationStatus statuses[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        statuses[i] = getCalibrationStatus(i);
+    }
+
+    char body[CALIBRATION_BUFFER_SIZE];
+    size_t length = formatCalibrationRun(body, sizeof(body), statuses, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST /calibration/zero, which starts a run on the cells in ?ids=
+// (default all), and /calibration/mass?grams=, which adds a known mass to
+// the run (default all cells in it). The sampler collects the readings in
+// the background and applies the fit as soon as a cell has both.
+void handleCalibrationPoint(AsyncWebServerRequest *request, bool zero)
+{
+    int ids[MAX_LOAD_CELLS];
+    int count = 0;
+    if (request->hasParam("ids", true))
+    {
+        count = parseIdList(request->getParam("ids", true)->value(), ids, MAX_LOAD_CELLS);
+        if (count <= 0)
+        {
+            sendErrorResponse(request, 400, "Invalid load cell ID");
+            return;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < cellConfig.count; ++i)
+        {
+            CalibrationState state = getCalibrationStatus(i).state;
+            if (zero || state == CALIBRATION_WAITING || state == CALIBRATION_CALIBRATED)
+            {
+                ids[count++] = i + 1;
+            }
+        }
+    }
+
+    float grams = 0;
+    if (!zero)
+    {
+        if (!request->hasParam("grams", true))
+        {
+            sendErrorResponse(request, 400, "Missing 'grams' parameter");
+            return;
+        }
+        grams = request->getParam("grams", true)->value().toFloat();
+        if (!(grams > 0) || !isfinite(grams))
+        {
+            sendErrorResponse(request, 400, "'grams' must be a positive number");
+            return;
+        }
+    }
+
+    int samples = CALIBRATION_DEFAULT_SAMPLES;
+    if (request->hasParam("samples", true))
+    {
+        samples = constrain(request->getParam("samples", true)->value().toInt(), 1, CALIBRATION_MAX_SAMPLES);
+    }
+
+    // A mass needs a zero point, and the previous mass must be done
+    uint32_t mask = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        CalibrationState state = getCalibrationStatus(ids[i] - 1).state;
+        if (!zero && state != CALIBRATION_WAITING && state != CALIBRATION_CALIBRATED)
+        {
+            count = 0;
+            break;
+        }
+        mask |= 1UL << (ids[i] - 1);
+    }
+    if (count == 0)
+    {
+        sendErrorResponse(request, 409, "No zero point, start with POST /calibration/zero");
+        return;
+    }
+
+    requestCalibrationPoint(mask, grams, samples, zero);
+
+    char body[RESPONSE_BUFFER_SIZE];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject();
+    json.add("message", zero ? "Calibration started, remove all weight from the plates" : "Keep the mass on the plates until the readings are collected");
+    json.beginArray("ids");
+    for (int i = 0; i < count; ++i)
+    {
+        json.add(nullptr, ids[i]);
+    }
+    json.endArray();
+    json.add("grams", grams, 1);
+    json.add("samples", samples);
+    json.endObject();
+    sendJSONResponse(request, 202, body, json.length());
+}
+
+// Handle GET request for the thresholds, levels and webhook of all cells
+void handleGetAlerts(AsyncWebServerRequest *request)
+{
+    AlertThresholds thresholds[MAX_LOAD_CELLS];
+    AlertLevel levels[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        thresholds[i] = getAlertThresholds(i);
+        levels[i] = getAlertLevel(i);
+    }
+    char url[WEBHOOK_URL_SIZE];
+    getWebhookUrl(url, sizeof(url));
+
+    char body[ALERTS_BUFFER_SIZE];
+    size_t length = formatAlerts(body, sizeof(body), url, getQueuedAlerts(), thresholds, levels, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the thresholds and level of a load cell
+void handleGetAlertsByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatAlertCell(body, sizeof(body), id, getAlertThresholds(id - 1), getAlertLevel(id - 1));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to change the thresholds of a load cell. Parameters
+// left out keep their value, 'off' clears a limit. Saved to SPIFFS.
+void handleSetAlertsByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int index = id - 1;
+    AlertThresholds thresholds = getAlertThresholds(index);
+
+    if (request->hasParam("low", true) && !parseLimit(request->getParam("low", true)->value(), thresholds.low))
+    {
+        sendErrorResponse(request, 400, "'low' must be a number of grams or 'off'");
+        return;
+    }
+
+    if (request->hasParam("high", true) && !parseLimit(request->getParam("high", true)->value(), thresholds.high))
+    {
+        sendErrorResponse(request, 400, "'high' must be a number of grams or 'off'");
+        return;
+    }
+
+    if (request->hasParam("hysteresis", true))
+    {
+        float hysteresis = request->getParam("hysteresis", true)->value().toFloat();
+        if (hysteresis < 0 || !isfinite(hysteresis))
+        {
+            sendErrorResponse(request, 400, "'hysteresis' must be a non-negative number of grams");
+            return;
+        }
+        thresholds.hysteresis = hysteresis;
+    }
+
+    if (thresholds.low >= thresholds.high)
+    {
+        sendErrorResponse(request, 400, "'low' must be below 'high'");
+        return;
+    }
+
+    // Evaluated by the sampler from the next stable reading on
+    setAlertThresholds(index, thresholds);
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatAlertCell(body, sizeof(body), id, thresholds, getAlertLevel(index));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to set the URL alerts are posted to, an empty 'url'
+// turns the webhook off
+void handleSetWebhook(AsyncWebServerRequest *request)
+{
+    if (!request->hasParam("url", true))
+    {
+        sendErrorResponse(request, 400, "Missing 'url' parameter");
+        return;
+    }
+
+    if (!setWebhookUrl(request->getParam("url", true)->value().c_str()))
+    {
+        sendErrorResponse(request, 400, "'url' must be an http:// URL of at most 127 characters");
+        return;
+    }
+    handleGetAlerts(request);
+}
+
+// Handle GET request for the filter settings of a load cell
+void handleGetFilterByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatFilterConfig(body, sizeof(body), id, getFilterConfig(id - 1));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to change filter settings, parameters left out keep their value
+void handleSetFilterByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int index = id - 1;
+    FilterConfig config = getFilterConfig(index);
+
+    if (request->hasParam("median", true))
+    {
+        int window = request->getParam("median", true)->value().toInt();
+        if (window < 1 || window > MEDIAN_MAX_WINDOW || window % 2 == 0)
+        {
+            sendErrorResponse(request, 400, "'median' must be an odd window between 1 and 9");
+            return;
+        }
+        config.medianWindow = window;
+    }
+
+    if (request->hasParam("smoothing", true))
+    {
+        const String &smoothing = request->getParam("smoothing", true)->value();
+        if (smoothing == "none")
+        {
+            config.smoothing = SMOOTHING_NONE;
+        }
+        else if (smoothing == "ema")
+        {
+            config.smoothing = SMOOTHING_EMA;
+        }
+        else if (smoothing == "kalman")
+        {
+            config.smoothing = SMOOTHING_KALMAN;
+        }
+        else
+        {
+            sendErrorResponse(request, 400, "'smoothing' must be none, ema or kalman");
+            return;
+        }
+    }
+
+    if (request->hasParam("alpha", true))
+    {
+        float alpha = request->getParam("alpha", true)->value().toFloat();
+        if (alpha <= 0 || alpha > 1)
+        {
+            sendErrorResponse(request, 400, "'alpha' must be in (0, 1]");
+            return;
+        }
+        config.emaAlpha = alpha;
+    }
+
+    if (request->hasParam("q", true))
+    {
+        config.kalmanProcessNoise = max(0.0f, request->getParam("q", true)->value().toFloat());
+    }
+
+    if (request->hasParam("r", true))
+    {
+        config.kalmanMeasurementNoise = max(0.0001f, request->getParam("r", true)->value().toFloat());
+    }
+
+    if (request->hasParam("deadband", true))
+    {
+        config.deadband = max(0.0f, request->getParam("deadband", true)->value().toFloat());
+    }
+
+    if (request->hasParam("zero_band", true))
+    {
+        config.zeroBand = max(0.0f, request->getParam("zero_band", true)->value().toFloat());
+    }
+
+    setFilterConfig(index, config);
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatFilterConfig(body, sizeof(body), id, config);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the rate and gain of all cells
+void handleGetAcquisition(AsyncWebServerRequest *request)
+{
+    AcquisitionStatus statuses[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        statuses[i] = getAcquisitionStatus(i);
+    }
+
+    char body[ACQUISITION_BUFFER_SIZE];
+    size_t length = formatAcquisition(body, sizeof(body), statuses, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the rate and gain of a load cell
+void handleGetAcquisitionByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatAcquisitionCell(body, sizeof(body), id, getAcquisitionStatus(id - 1));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to change the mode or gain of a load cell, or to keep
+// it at the fast rate for 'active_ms' (e.g. before a dip). The gain is saved
+// with the calibration, the mode comes from /cells.json at boot.
+void handleSetAcquisitionByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int index = id - 1;
+    AcquisitionMode mode = getAcquisitionStatus(index).mode;
+    if (request->hasParam("mode", true) && !parseAcquisitionMode(request->getParam("mode", true)->value().c_str(), mode))
+    {
+        sendErrorResponse(request, 400, "'mode' must be auto, fast or slow");
+        return;
+    }
+
+    int gain = 0;
+    if (request->hasParam("gain", true))
+    {
+        gain = request->getParam("gain", true)->value().toInt();
+        if (gain != 128 && gain != 64 && gain != 32)
+        {
+            sendErrorResponse(request, 400, "'gain' must be 128 or 64 (channel A) or 32 (channel B)");
+            return;
+        }
+    }
+
+    long activeMs = 0;
+    if (request->hasParam("active_ms", true))
+    {
+        activeMs = request->getParam("active_ms", true)->value().toInt();
+        if (activeMs <= 0 || activeMs > 600000)
+        {
+            sendErrorResponse(request, 400, "'active_ms' must be between 1 and 600000");
+            return;
+        }
+    }
+
+    // Applied by the sampler task before its next reading
+    setAcquisitionMode(index, mode);
+    if (gain != 0)
+    {
+        setGain(index, gain);
+    }
+    if (activeMs != 0)
+    {
+        holdFastRate(index, activeMs);
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatAcquisitionCell(body, sizeof(body), id, getAcquisitionStatus(index));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the zero corrections of all cells
+void handleGetDrift(AsyncWebServerRequest *request)
+{
+    DriftStatus statuses[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        statuses[i] = getDriftStatus(i);
+    }
+
+    char body[DRIFT_BUFFER_SIZE];
+    size_t length = formatDrift(body, sizeof(body), getChipTemperature(), statuses, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+void handleGetDriftByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatDriftCell(body, sizeof(body), id, getDriftStatus(id - 1));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to change auto-zero ('on' or 'off'), the drift model
+// ('off', 'time' or 'temperature') and its rate in grams per hour or °C.
+// Not saved, cells.json sets them at boot.
+void handleSetDriftByID(AsyncWebServerRequest *request, int id)
+{
+    if (id < 1 || id > cellConfig.count)
+    {
+        sendErrorResponse(request, 400, "Invalid load cell ID");
+        return;
+    }
+
+    int index = id - 1;
+    DriftConfig config = getDriftStatus(index).config;
+    if (request->hasParam("auto_zero", true))
+    {
+        String value = request->getParam("auto_zero", true)->value();
+        if (value != "on" && value != "off")
+        {
+            sendErrorResponse(request, 400, "'auto_zero' must be on or off");
+            return;
+        }
+        config.autoZero = value == "on";
+    }
+
+    if (request->hasParam("drift", true) && !parseDriftSource(request->getParam("drift", true)->value().c_str(), config.source))
+    {
+        sendErrorResponse(request, 400, "'drift' must be off, time or temperature");
+        return;
+    }
+
+    if (request->hasParam("drift_rate", true))
+    {
+        config.rate = request->getParam("drift_rate", true)->value().toFloat();
+        if (!isfinite(config.rate))
+        {
+            sendErrorResponse(request, 400, "'drift_rate' must be a number of grams");
+            return;
+        }
+    }
+
+    // Applied by the sampler task, drift counts from then on
+    setDriftConfig(index, config);
+
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatDriftCell(body, sizeof(body), id, getDriftStatus(index));
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to start a raw capture, optional 'samples' limits its length
+void handleStartCapture(AsyncWebServerRequest *request)
+{
+    uint32_t samples = CAPTURE_MAX_SAMPLES;
+    if (request->hasParam("samples", true))
+    {
+        samples = constrain(request->getParam("samples", true)->value().toInt(), 1, CAPTURE_MAX_SAMPLES);
+    }
+
+    if (!startCapture(samples))
+    {
+        sendErrorResponse(request, 500, "Not enough memory for the capture buffer");
+        return;
+    }
+    handleGetCaptureStatus(request);
+}
+
+// Handle POST request to stop a running capture early
+void handleStopCapture(AsyncWebServerRequest *request)
+{
+    stopCapture();
+    handleGetCaptureStatus(request);
+}
+
+// Handle GET request for the state of the capture
+void handleGetCaptureStatus(AsyncWebServerRequest *request)
+{
+    const CaptureBuffer &capture = getCapture();
+
+    char body[RESPONSE_BUFFER_SIZE];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject();
+    json.add("running", capture.isRunning());
+    json.add("samples", (unsigned long)capture.getCount());
+    json.add("max_samples", (unsigned long)capture.getMaxSamples());
+    json.endObject();
+    sendJSONResponse(request, 200, body, json.length());
+}
+
+// Handle GET request to download the samples captured so far.
+// ?format=raw (default) sends fixed 8 byte records, ?format=delta varint deltas.
+void handleDownloadCapture(AsyncWebServerRequest *request)
+{
+    const CaptureBuffer &capture = getCapture();
+    uint32_t count = capture.getCount();
+    uint32_t generation = capture.getGeneration();
+
+    if (generation == 0)
+    {
+        sendErrorResponse(request, 404, "No capture recorded");
+        return;
+    }
+
+    bool delta = request->hasParam("format") && request->getParam("format")->value() == "delta";
+    AsyncWebServerResponse *response;
+
+    if (delta)
+    {
+        // Length is not known up front, encode chunk by chunk
+        std::shared_ptr<CaptureDeltaEncoder> encoder = std::make_shared<CaptureDeltaEncoder>(capture, count);
+        response = request->beginChunkedResponse("application/octet-stream", [request, encoder, generation](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                 {
+            size_t length = encoder->read(buffer, maxLen);
+            return checkCaptureGeneration(request, generation) ? length : RESPONSE_TRY_AGAIN; });
+    }
+    else
+    {
+        response = request->beginResponse("application/octet-stream", capture.rawSize(count), [request, count, generation](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                          {
+            size_t length = getCapture().readRaw(buffer, maxLen, index, count);
+            return checkCaptureGeneration(request, generation) ? length : RESPONSE_TRY_AGAIN; });
+    }
+
+    response->addHeader("Content-Disposition", delta ? "attachment; filename=capture.hxd" : "attachment; filename=capture.hxc");
+    request->send(response);
+}
+
+// Called by the download fillers after reading samples. If a new capture
+// overwrote them meanwhile, the bytes just read may mix both captures, and
+// ending early would leave a raw download short of its Content-Length. The
+// connection is closed instead; the filler then returns RESPONSE_TRY_AGAIN,
+// which ESPAsyncWebServer hands back without touching the freed request.
+bool checkCaptureGeneration(AsyncWebServerRequest *request, uint32_t generation)
+{
+    if (getCapture().isGeneration(generation))
+    {
+        return true;
+    }
+    request->client()->close();
+    return false;
+}
+
+// Handle GET request for the consumption totals of all cells
+void handleGetConsumption(AsyncWebServerRequest *request)
+{
+    ConsumptionSummary summary;
+    getConsumption(summary);
+
+    char body[CONSUMPTION_BUFFER_SIZE];
+    size_t length = formatConsumption(body, sizeof(body), summary, millis() - summary.sessionStartMs, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the dips and refills after ?since= (a sequence
+// number, default 0), at most CONSUMPTION_EVENTS_PER_PAGE at a time
+void handleGetConsumptionEvents(AsyncWebServerRequest *request)
+{
+    uint32_t since = 0;
+    if (request->hasParam("since"))
+    {
+        since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+    }
+
+    ConsumptionEvent events[CONSUMPTION_EVENTS_PER_PAGE];
+    uint32_t last = 0;
+    uint32_t dropped = 0;
+    int count = getConsumptionEvents(since, events, CONSUMPTION_EVENTS_PER_PAGE, last, dropped);
+    uint32_t next = count > 0 ? events[count - 1].sequence : min(since, last);
+
+    char body[CONSUMPTION_BUFFER_SIZE];
+    size_t length = formatConsumptionEvents(body, sizeof(body), events, count, next, dropped, next < last);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle POST request to close the current session and start a new one,
+// answers with the totals of the closed session
+void handleStartConsumptionSession(AsyncWebServerRequest *request)
+{
+    ConsumptionSummary summary;
+    startConsumptionSession(summary);
+
+    char body[CONSUMPTION_BUFFER_SIZE];
+    size_t length = formatConsumption(body, sizeof(body), summary, millis() - summary.sessionStartMs, cellConfig.count);
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the startup milestones, in ms since power on.
+// Phases not reached yet are left out.
+void handleGetBootTimes(AsyncWebServerRequest *request)
+{
+    char body[RESPONSE_BUFFER_SIZE];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject();
+    json.add("uptime_ms", (unsigned long)millis());
+    json.beginObject("boot_ms");
+    for (int i = 0; i < BOOT_PHASE_COUNT; ++i)
+    {
+        uint32_t time = getBootPhaseTime((BootPhase)i);
+        if (time != 0)
+        {
+            json.add(getBootPhaseName((BootPhase)i), (unsigned long)time);
+        }
+    }
+    json.endObject();
+    json.endObject();
+    sendJSONResponse(request, 200, body, json.length());
+}
+
+// Handle GET request for a benchmark run, ?iterations=N (up to
+// BENCH_MAX_ITERATIONS). Blocks the server for the duration of the run.
+void handleGetBench(AsyncWebServerRequest *request)
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    if (request->hasParam("iterations"))
+    {
+        iterations = constrain(request->getParam("iterations")->value().toInt(), 1, BENCH_MAX_ITERATIONS);
+    }
+
+    char body[BENCH_RESULT_SIZE];
+    size_t length = runBenchmarks(body, sizeof(body), cellConfig.count, iterations);
+    if (length == 0)
+    {
+        sendErrorResponse(request, 409, "Benchmark already running");
+        return;
+    }
+    sendJSONResponse(request, 200, body, length);
+}
+
+// Handle GET request for the runtime metrics in the Prometheus text format
+void handleGetMetrics(AsyncWebServerRequest *request)
+{
+    std::shared_ptr<MetricsEncoder> encoder = std::make_shared<MetricsEncoder>(cellConfig.count);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; version=0.0.4", [encoder](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                                     { return encoder->read(buffer, maxLen); });
+    request->send(response);
+}
+
 /* Helper Functions */
 
-// Send a JSON response
-void sendJSONResponse(AsyncWebServerRequest *request, int statusCode, const String &jsonContent)
+// Wrap a route handler so each request is counted and its handler time
+// recorded for /metrics
+ArRequestHandlerFunction timed(MetricsRoute route, ArRequestHandlerFunction handler)
+{
+    return [route, handler](AsyncWebServerRequest *request)
+    {
+        uint32_t start = micros();
+        handler(request);
+        observeRequest(route, micros() - start);
+    };
+}
+
+// Send a JSON response. The body is copied straight into a response stream
+// sized to fit, no intermediate String or JsonDocument is built.
+void sendJSONResponse(AsyncWebServerRequest *request, int statusCode, const char *body, size_t length, const char *etag)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json", length);
+    response->setCode(statusCode);
+    if (etag != nullptr)
+    {
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", CACHE_CONTROL);
+    }
+    response->write((const uint8_t *)body, length);
+    request->send(response);
+    countResponse(statusCode);
+}
+
+// Answer a GET from its cache: 304 if the client's If-None-Match names the
+// current version, the stored body if it was built from that version.
+// Returns false if the caller has to build the body (without a sensor read
+// or serialization otherwise).
+template <size_t SIZE>
+bool sendFromCache(AsyncWebServerRequest *request, const CachedBody<SIZE> &cache, uint32_t version)
+{
+    char etag[ETAG_SIZE];
+    formatETag(etag, sizeof(etag), version);
+
+    const AsyncWebHeader *ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch != nullptr && etagMatches(ifNoneMatch->value().c_str(), etag))
+    {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", CACHE_CONTROL);
+        request->send(response);
+        countResponse(304);
+        countCacheResult(CACHE_NOT_MODIFIED);
+        return true;
+    }
+
+    if (!cache.isCurrent(version))
+    {
+        countCacheResult(CACHE_MISS);
+        return false;
+    }
+
+    sendJSONResponse(request, 200, cache.body, cache.length, etag);
+    countCacheResult(CACHE_HIT);
+    return true;
+}
+
+// Send a body just stored in its cache, tagged with its version
+template <size_t SIZE>
+void sendCachedBody(AsyncWebServerRequest *request, const CachedBody<SIZE> &cache)
+{
+    char etag[ETAG_SIZE];
+    formatETag(etag, sizeof(etag), cache.version);
+    sendJSONResponse(request, 200, cache.body, cache.length, etag);
+}
+
+// Parse a comma separated list of load cell IDs such as "1,3", duplicates
+// are dropped. Returns the number of IDs, or -1 if one is invalid.
+int parseIdList(const String &list, int ids[], int maxIds)
 {
-    request->send(statusCode, "application/json", jsonContent);
+    int count = 0;
+    uint32_t seen = 0;
+    int start = 0;
+    while (start <= (int)list.length())
+    {
+        int end = list.indexOf(',', start);
+        if (end < 0)
+        {
+            end = list.length();
+        }
+
+        String item = list.substring(start, end);
+        int id = item.toInt();
+        if (id < 1 || id > cellConfig.count || String(id) != item)
+        {
+            return -1;
+        }
+        if (!(seen & (1UL << id)) && count < maxIds)
+        {
+            seen |= 1UL << id;
+            ids[count++] = id;
+        }
+        start = end + 1;
+    }
+    return count;
+}
+
+// Parse a threshold in grams, 'off' clears it (NAN)
+bool parseLimit(const String &text, float &limit)
+{
+    if (text == "off")
+    {
+        limit = NAN;
+        return true;
+    }
+
+    char *end = nullptr;
+    float value = strtof(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0' || !isfinite(value))
+    {
+        return false;
+    }
+    limit = value;
+    return true;
 }
 
 // Send an error response in JSON format
-void sendErrorResponse(AsyncWebServerRequest *request, int statusCode, const String &errorMessage)
+void sendErrorResponse(AsyncWebServerRequest *request, int statusCode, const char *errorMessage)
 {
-    JsonDocument jsonDoc;
-    jsonDoc["error"] = errorMessage;
-    String jsonResponse;
-    serializeJson(jsonDoc, jsonResponse);
-    request->send(statusCode, "application/json", jsonResponse);
+    char body[RESPONSE_BUFFER_SIZE];
+    size_t length = formatError(body, sizeof(body), errorMessage);
+    sendJSONResponse(request, statusCode, body, length);
 }
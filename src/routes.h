@@ -2,10 +2,9 @@
 #define ROUTES_H
 
 #include <ESPAsyncWebServer.h>
-#include "HX711.h"
 
-extern const int NUM_LOAD_CELLS;
-
-void setupRoutes(AsyncWebServer &server, HX711 scales[], int numScales);
+void setupRoutes(AsyncWebServer &server);
+void sendJSONResponse(AsyncWebServerRequest *request, int statusCode, const char *body, size_t length, const char *etag = nullptr);
+void sendErrorResponse(AsyncWebServerRequest *request, int statusCode, const char *errorMessage);
 
 #endif
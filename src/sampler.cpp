@@ -0,0 +1,954 @@
+#include <Arduino.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include "HX711.h"
+#include "acquisition.h"
+#include "activity.h"
+#include "alerts.h"
+#include "boot_timing.h"
+#include "calibration.h"
+#include "calibration_store.h"
+#include "capture.h"
+#include "consumption.h"
+#include "cores.h"
+#include "drift.h"
+#include "filters.h"
+#include "history.h"
+#include "metrics.h"
+#include "sampler.h"
+#include "seqlock.h"
+#include "stability.h"
+
+// Tare running in the sampler task for one cell
+struct TareState
+{
+    int remaining; // samples still to collect, 0 if no tare is running
+    long long sum;
+    int count;
+};
+
+// HX711 driver as seen by the acquisition engine
+class HX711Source : public LoadCellSource
+{
+public:
+    HX711 *scale = nullptr;
+
+    int index = 0;
+
+    bool isReady() override { return scale->is_ready(); }
+    long read() override
+    {
+        uint32_t start = micros();
+        long value = scale->read();
+        observeScaleRead(index, micros() - start);
+        return value;
+    }
+};
+
+// Sampler state
+static HX711 *sampledScales = nullptr;
+static int numSampledScales = 0;
+static HX711Source sources[MAX_LOAD_CELLS];
+static int doutPins[MAX_LOAD_CELLS];
+static LoadCellSource *sourcePointers[MAX_LOAD_CELLS];
+static AcquisitionEngine engine;
+static TaskHandle_t samplerTaskHandle = nullptr;
+static FilterChain filters[MAX_LOAD_CELLS];
+static FilterConfig pendingFilterConfigs[MAX_LOAD_CELLS];
+static bool filterConfigPending[MAX_LOAD_CELLS];
+static float pendingFactors[MAX_LOAD_CELLS];
+static bool factorPending[MAX_LOAD_CELLS];
+static StabilityDetector stabilityDetectors[MAX_LOAD_CELLS];
+static CaptureBuffer capture;
+static TareState tares[MAX_LOAD_CELLS];
+static LoadCellReading latestReadings[MAX_LOAD_CELLS];            // owned by the sampler task
+static Seqlock<LoadCellReading> publishedReadings[MAX_LOAD_CELLS]; // copies for all other tasks
+static LoadCellReading versionedReadings[MAX_LOAD_CELLS];          // state behind the current versions
+static std::atomic<uint32_t> weightVersions[MAX_LOAD_CELLS];
+static std::atomic<uint32_t> calibrationVersions[MAX_LOAD_CELLS];
+static uint32_t disconnectCounts[MAX_LOAD_CELLS];
+static uint32_t lastSampleTimes[MAX_LOAD_CELLS]; // millis() of the latest conversion, settling ones included
+static portMUX_TYPE controlMux = portMUX_INITIALIZER_UNLOCKED; // tare, filter, calibration and acquisition requests
+
+// Output rate and gain
+static int8_t ratePins[MAX_LOAD_CELLS];
+static ActivityDetector activityDetectors[MAX_LOAD_CELLS];
+static uint8_t settlingReadings[MAX_LOAD_CELLS]; // readings still to drop
+static uint32_t rateSwitchCounts[MAX_LOAD_CELLS];
+static uint16_t rateWindowCounts[MAX_LOAD_CELLS];
+static uint32_t rateWindowStart = 0;
+static AcquisitionStatus acquisition[MAX_LOAD_CELLS]; // written under controlMux
+static uint8_t pendingGains[MAX_LOAD_CELLS];          // 0 if none
+static uint32_t pendingHolds[MAX_LOAD_CELLS];         // ms, 0 if none
+
+// Calibration runs, written under controlMux
+static CalibrationFit calibrationFits[MAX_LOAD_CELLS];
+static CalibrationStatus calibrations[MAX_LOAD_CELLS];
+static uint32_t calibrationStarts[MAX_LOAD_CELLS]; // millis() from which readings count
+
+// Zero tracking
+static DriftStatus drifts[MAX_LOAD_CELLS];        // written under controlMux
+static DriftConfig pendingDrifts[MAX_LOAD_CELLS];
+static bool driftPending[MAX_LOAD_CELLS];
+static ZeroTracker zeroTrackers[MAX_LOAD_CELLS];
+static float driftReferences[MAX_LOAD_CELLS]; // °C when the zero was last set
+static uint64_t driftElapsedMs[MAX_LOAD_CELLS]; // since then, summed so millis() may wrap
+static uint32_t driftClocks[MAX_LOAD_CELLS];    // millis() up to which it is summed
+static long modelledCounts[MAX_LOAD_CELLS];   // offset moved by the drift model since
+static uint32_t autoZeroCounts[MAX_LOAD_CELLS];
+static float chipTemperature = 0; // °C, smoothed
+static uint32_t driftUpdateStart = 0;
+
+// Function Prototypes
+static void samplerTask(void *parameter);
+static void IRAM_ATTR onDataReady();
+static void onSample(int index, long raw, void *context);
+static void onTareSample(int index, long raw, void *context);
+static void publishWeight(int index, long raw, uint32_t timestamp);
+static void publishReading(int index);
+static void applyCalibration();
+static void applyAcquisition();
+static void applyGain(int index, uint8_t gain);
+static void updateRate(int index, long raw, uint32_t timestamp);
+static bool updateTare(int index, long raw);
+static bool updateCalibration(int index, long raw, uint32_t timestamp);
+static void restartWeight(int index);
+static void endCalibration(int index, CalibrationError error);
+static void applyDrift();
+static void updateZeroTracking(int index, long raw, uint32_t timestamp);
+static void restartDrift(int index);
+static float driftPosition(int index);
+static void *allocateCaptureMemory(size_t size);
+
+// Attach the acquisition engine to the load cells, which were begun with gains
+void beginSampler(HX711 scales[], const CellConfig &config, const uint8_t gains[])
+{
+    sampledScales = scales;
+    numSampledScales = min(config.count, MAX_LOAD_CELLS);
+
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        sources[i].scale = &scales[i];
+        sources[i].index = i;
+        sourcePointers[i] = &sources[i];
+        doutPins[i] = config.doutPins[i];
+
+        // Start at rest, the boot tare gets the low-noise rate
+        ratePins[i] = config.ratePins[i];
+        bool fast = config.modes[i] == ACQUISITION_FAST;
+        acquisition[i] = {config.modes[i], ratePins[i] >= 0, fast, false, gains[i], 0};
+        drifts[i] = {config.drifts[i], 0, 0};
+        if (ratePins[i] >= 0)
+        {
+            pinMode(ratePins[i], OUTPUT);
+            digitalWrite(ratePins[i], fast ? HIGH : LOW);
+        }
+    }
+    engine.begin(sourcePointers, numSampledScales);
+}
+
+// Tare the cells in mask in parallel (before the sampler task runs),
+// returns false if a cell did not respond
+bool tareScales(uint32_t mask, int times, uint32_t timeoutMs)
+{
+    long long sums[MAX_LOAD_CELLS] = {0};
+    int counts[MAX_LOAD_CELLS] = {0};
+    void *context[] = {sums, counts};
+
+    uint32_t start = millis();
+    bool done = false;
+    while (!done && millis() - start < timeoutMs)
+    {
+        if (engine.service(onTareSample, context) == 0)
+        {
+            delay(1);
+        }
+
+        done = true;
+        for (int i = 0; i < numSampledScales; ++i)
+        {
+            done = done && (counts[i] >= times || !(mask & (1UL << i)));
+        }
+    }
+
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        if (counts[i] > 0 && (mask & (1UL << i)))
+        {
+            sampledScales[i].set_offset(sums[i] / counts[i]);
+        }
+    }
+    return done;
+}
+
+// Start the background task that continuously reads all load cells
+void startSampler()
+{
+    // Publish the calibration before the first sample, the task has not
+    // started yet so this is still the only writer. Drift counts from the
+    // zero found at boot.
+    chipTemperature = temperatureRead();
+    driftUpdateStart = millis();
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        latestReadings[i].offset = sampledScales[i].get_offset();
+        latestReadings[i].factor = sampledScales[i].get_scale();
+        publishReading(i);
+        restartDrift(i);
+    }
+
+    xTaskCreatePinnedToCore(samplerTask, "sampler", 4096, nullptr, SAMPLER_TASK_PRIORITY, &samplerTaskHandle, SENSOR_CORE);
+}
+
+// Re-tare a cell (or all cells with index -1) from the next readings.
+// The sampler task applies the new offset and flags it for saving.
+void requestTare(int index, int times)
+{
+    taskENTER_CRITICAL(&controlMux);
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        if (index < 0 || index == i)
+        {
+            tares[i] = {times, 0, 0};
+        }
+    }
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+bool isTareRunning(int index)
+{
+    return tares[index].remaining > 0;
+}
+
+// Return a copy of the latest reading of a load cell, never blocks the sampler
+LoadCellReading getLatestReading(int index)
+{
+    return publishedReadings[index].read();
+}
+
+// Raw readings taken from a cell since boot, including tare readings
+uint32_t getSampleCount(int index)
+{
+    return engine.sampleCount(index);
+}
+
+// Polls of a cell that found no conversion ready, mostly from the poll
+// timeout and from wakeups by another cell's data ready edge
+uint32_t getNotReadyCount(int index)
+{
+    return engine.notReadyCount(index);
+}
+
+// Times a cell went quiet for SAMPLE_TIMEOUT_MS
+uint32_t getDisconnectCount(int index)
+{
+    return disconnectCounts[index];
+}
+
+// Changes of the weight, stable flag or connected state of a cell, i.e. of
+// its entry in GET /weight. Read before getLatestReading(), a reading is
+// never older than the version.
+uint32_t getWeightVersion(int index)
+{
+    return weightVersions[index].load(std::memory_order_acquire);
+}
+
+// Changes of the calibration factor of a cell
+uint32_t getCalibrationVersion(int index)
+{
+    return calibrationVersions[index].load(std::memory_order_acquire);
+}
+
+// Change the calibration factor of a cell. The sampler task applies it and
+// publishes it together with a weight computed with it, so readers never see
+// a weight and factor that do not belong together.
+void setCalibrationFactor(int index, float factor)
+{
+    taskENTER_CRITICAL(&controlMux);
+    pendingFactors[index] = factor;
+    factorPending[index] = true;
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (samplerTaskHandle != nullptr)
+    {
+        xTaskNotifyGive(samplerTaskHandle);
+    }
+}
+
+// Replace the filter chain settings of a cell, applied before its next sample
+void setFilterConfig(int index, const FilterConfig &config)
+{
+    taskENTER_CRITICAL(&controlMux);
+    pendingFilterConfigs[index] = config;
+    filterConfigPending[index] = true;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+FilterConfig getFilterConfig(int index)
+{
+    FilterConfig config;
+
+    taskENTER_CRITICAL(&controlMux);
+    config = filterConfigPending[index] ? pendingFilterConfigs[index] : filters[index].getConfig();
+    taskEXIT_CRITICAL(&controlMux);
+
+    return config;
+}
+
+// Start recording raw readings of all cells, allocates the buffer on first use
+bool startCapture(uint32_t maxSamples)
+{
+    if (!capture.allocate(CAPTURE_MAX_SAMPLES, allocateCaptureMemory))
+    {
+        return false;
+    }
+    capture.start(numSampledScales, maxSamples, micros());
+    return true;
+}
+
+void stopCapture()
+{
+    capture.stop();
+}
+
+const CaptureBuffer &getCapture()
+{
+    return capture;
+}
+
+// Applied by the sampler task with the next reading of the cell
+void setAcquisitionMode(int index, AcquisitionMode mode)
+{
+    taskENTER_CRITICAL(&controlMux);
+    acquisition[index].mode = mode;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+// Treat the cell as active for a while, e.g. right before the robot dips
+void holdFastRate(int index, uint32_t durationMs)
+{
+    taskENTER_CRITICAL(&controlMux);
+    pendingHolds[index] = max(pendingHolds[index], durationMs);
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+// Switch between 128 and 64 on channel A and 32 on channel B. Offset and
+// factor are rescaled with the gain, so the weight stays the same.
+void setGain(int index, uint8_t gain)
+{
+    taskENTER_CRITICAL(&controlMux);
+    pendingGains[index] = gain;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+AcquisitionStatus getAcquisitionStatus(int index)
+{
+    taskENTER_CRITICAL(&controlMux);
+    AcquisitionStatus status = acquisition[index];
+    uint8_t gain = pendingGains[index];
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (gain != 0)
+    {
+        status.gain = gain;
+    }
+    return status;
+}
+
+// Times the RATE pin of a cell was switched
+uint32_t getRateSwitchCount(int index)
+{
+    return rateSwitchCounts[index];
+}
+
+// Collect samples readings at a known mass on the cells in mask. restart
+// begins a new run with this mass as its first point, usually the zero,
+// otherwise the mass is added to the run of each cell. The sampler task
+// fits and applies the calibration once a cell has two masses.
+void requestCalibrationPoint(uint32_t mask, float grams, int samples, bool restart)
+{
+    uint32_t start = millis() + CALIBRATION_SETTLE_MS;
+
+    taskENTER_CRITICAL(&controlMux);
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        if (!(mask & (1UL << i)))
+        {
+            continue;
+        }
+
+        CalibrationStatus &status = calibrations[i];
+        if (restart)
+        {
+            calibrationFits[i].reset();
+            status = {CALIBRATION_IDLE, CALIBRATION_OK, 0, 0, 0, 0, 0, 0};
+        }
+        status.state = CALIBRATION_COLLECTING;
+        status.remaining = samples;
+        status.grams = grams;
+        calibrationStarts[i] = start;
+    }
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+CalibrationStatus getCalibrationStatus(int index)
+{
+    taskENTER_CRITICAL(&controlMux);
+    CalibrationStatus status = calibrations[index];
+    taskEXIT_CRITICAL(&controlMux);
+    return status;
+}
+
+// Change auto-zero and the drift model of a cell. The sampler task applies
+// it, drift is counted from that moment on.
+void setDriftConfig(int index, const DriftConfig &config)
+{
+    taskENTER_CRITICAL(&controlMux);
+    pendingDrifts[index] = config;
+    driftPending[index] = true;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+DriftStatus getDriftStatus(int index)
+{
+    taskENTER_CRITICAL(&controlMux);
+    DriftStatus status = drifts[index];
+    if (driftPending[index])
+    {
+        status.config = pendingDrifts[index];
+    }
+    taskEXIT_CRITICAL(&controlMux);
+    return status;
+}
+
+// Temperature of the ESP32 the drift model follows, not of the load cells
+float getChipTemperature()
+{
+    return chipTemperature;
+}
+
+// Times auto-zero moved the zero of a cell
+uint32_t getAutoZeroCount(int index)
+{
+    return autoZeroCounts[index];
+}
+
+// Clock out every load cell as soon as its conversion is ready
+static void samplerTask(void *parameter)
+{
+    // DOUT falls when a conversion is ready. Attached here so the GPIO
+    // interrupt is serviced on the sensor core as well.
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        attachInterrupt(digitalPinToInterrupt(doutPins[i]), onDataReady, FALLING);
+    }
+
+    for (;;)
+    {
+        applyCalibration();
+        applyAcquisition();
+        applyDrift();
+        engine.service(onSample, nullptr);
+
+        // Mark cells as disconnected if they stopped producing samples
+        uint32_t now = millis();
+        for (int i = 0; i < numSampledScales; ++i)
+        {
+            if (latestReadings[i].connected && now - lastSampleTimes[i] > SAMPLE_TIMEOUT_MS)
+            {
+                latestReadings[i].connected = false;
+                latestReadings[i].stable = false;
+                publishReading(i);
+                stabilityDetectors[i].reset();
+                disconnectCounts[i]++;
+                endCalibration(i, CALIBRATION_DISCONNECTED);
+            }
+        }
+
+        // Conversions per second, over one second windows
+        if (now - rateWindowStart >= 1000)
+        {
+            taskENTER_CRITICAL(&controlMux);
+            for (int i = 0; i < numSampledScales; ++i)
+            {
+                acquisition[i].sps = rateWindowCounts[i] * 1000 / (now - rateWindowStart);
+                rateWindowCounts[i] = 0;
+            }
+            taskEXIT_CRITICAL(&controlMux);
+            rateWindowStart = now;
+        }
+
+        // Sleep until a DOUT line falls. The timeout covers edges that were
+        // missed while another cell was being clocked out.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SAMPLER_WAIT_TIMEOUT_MS));
+    }
+}
+
+static void IRAM_ATTR onDataReady()
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    if (samplerTaskHandle != nullptr)
+    {
+        vTaskNotifyGiveFromISR(samplerTaskHandle, &higherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+// Run a new raw value through the filter chain and publish the result
+static void onSample(int index, long raw, void *context)
+{
+    uint32_t now = millis();
+    lastSampleTimes[index] = now;
+    rateWindowCounts[index]++;
+
+    // Not yet at the new rate or gain
+    if (settlingReadings[index] > 0)
+    {
+        settlingReadings[index]--;
+        return;
+    }
+
+    capture.record(index, raw, micros());
+    bool tared = updateTare(index, raw);
+    bool calibrated = updateCalibration(index, raw, now);
+    if (tared || calibrated)
+    {
+        restartWeight(index);
+    }
+
+    if (filterConfigPending[index])
+    {
+        taskENTER_CRITICAL(&controlMux);
+        filters[index].configure(pendingFilterConfigs[index]);
+        filterConfigPending[index] = false;
+        taskEXIT_CRITICAL(&controlMux);
+    }
+
+    publishWeight(index, raw, now);
+
+    // Only now is the new offset in the reading the calibration is saved from
+    if (tared || calibrated)
+    {
+        markCalibrationDirty();
+    }
+    updateZeroTracking(index, raw, now);
+    updateHistory(index, latestReadings[index]);
+    updateRate(index, raw, now);
+    markBootPhase(BOOT_FIRST_READING);
+}
+
+// Same conversion as HX711::get_units(), then filtered incrementally. The
+// reading is published with the calibration it was computed with.
+static void publishWeight(int index, long raw, uint32_t timestamp)
+{
+    HX711 &scale = sampledScales[index];
+    LoadCellReading &reading = latestReadings[index];
+
+    reading.offset = scale.get_offset();
+    reading.factor = scale.get_scale();
+    reading.weight = filters[index].update((raw - reading.offset) / reading.factor);
+    reading.stable = stabilityDetectors[index].update(reading.weight, timestamp);
+    reading.connected = true;
+    reading.raw = raw;
+    reading.timestamp = timestamp;
+    publishReading(index);
+}
+
+// Hand the sampler's reading to the other tasks. The versions only move
+// when a value shown by GET /weight or /calibration_factor changed, so a
+// weight held by the deadband leaves them alone.
+static void publishReading(int index)
+{
+    const LoadCellReading &reading = latestReadings[index];
+    LoadCellReading &previous = versionedReadings[index];
+
+    // Published first, a reader that sees the new version also sees the reading
+    publishedReadings[index].write(reading);
+    updateConsumption(index, reading);
+    updateAlerts(index, reading);
+
+    if (reading.connected != previous.connected || reading.stable != previous.stable || reading.weight != previous.weight)
+    {
+        weightVersions[index].fetch_add(1, std::memory_order_release);
+    }
+    if (reading.factor != previous.factor)
+    {
+        calibrationVersions[index].fetch_add(1, std::memory_order_release);
+    }
+    previous = reading;
+}
+
+// Take over calibration factors set with setCalibrationFactor()
+static void applyCalibration()
+{
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        taskENTER_CRITICAL(&controlMux);
+        bool pending = factorPending[i];
+        float factor = pendingFactors[i];
+        factorPending[i] = false;
+        taskEXIT_CRITICAL(&controlMux);
+
+        if (!pending)
+        {
+            continue;
+        }
+
+        sampledScales[i].set_scale(factor);
+        if (latestReadings[i].connected)
+        {
+            // The weight jumps, recompute it from the last raw value
+            filters[i].configure(filters[i].getConfig());
+            stabilityDetectors[i].reset();
+            publishWeight(i, latestReadings[i].raw, latestReadings[i].timestamp);
+        }
+        else
+        {
+            latestReadings[i].factor = factor;
+            publishReading(i);
+        }
+        markCalibrationDirty();
+    }
+}
+
+// Take over gains and holds requested by other tasks
+static void applyAcquisition()
+{
+    uint32_t now = millis();
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        taskENTER_CRITICAL(&controlMux);
+        uint8_t gain = pendingGains[i];
+        uint32_t hold = pendingHolds[i];
+        pendingGains[i] = 0;
+        pendingHolds[i] = 0;
+        taskEXIT_CRITICAL(&controlMux);
+
+        if (hold != 0)
+        {
+            activityDetectors[i].hold(hold, now);
+        }
+        if (gain != 0 && gain != acquisition[i].gain)
+        {
+            applyGain(i, gain);
+        }
+    }
+}
+
+// Raw counts are proportional to the gain. Channel B is assumed to see the
+// same bridge, a different sensor on it needs its own tare and calibration.
+static void applyGain(int index, uint8_t gain)
+{
+    HX711 &scale = sampledScales[index];
+    uint8_t previous = acquisition[index].gain;
+
+    scale.set_gain(gain);
+    scale.set_offset(scale.get_offset() * gain / previous);
+    scale.set_scale(scale.get_scale() * gain / previous);
+    settlingReadings[index] = ACQUISITION_SETTLE_READINGS;
+
+    taskENTER_CRITICAL(&controlMux);
+    acquisition[index].gain = gain;
+
+    // Readings already summed by a running tare are at the old gain
+    TareState &tare = tares[index];
+    if (tare.remaining > 0)
+    {
+        tare = {tare.remaining + tare.count, 0, 0};
+    }
+    taskEXIT_CRITICAL(&controlMux);
+
+    // As are the readings of a calibration run
+    endCalibration(index, CALIBRATION_GAIN_CHANGED);
+    restartDrift(index);
+
+    latestReadings[index].offset = scale.get_offset();
+    latestReadings[index].factor = scale.get_scale();
+    publishReading(index);
+    markCalibrationDirty();
+}
+
+// Follow the mode: 80 SPS while the cell is active in auto mode. The
+// activity is judged on the unfiltered weight, the median would delay it.
+static void updateRate(int index, long raw, uint32_t timestamp)
+{
+    const LoadCellReading &reading = latestReadings[index];
+    bool active = activityDetectors[index].update((raw - reading.offset) / reading.factor, timestamp);
+
+    taskENTER_CRITICAL(&controlMux);
+    AcquisitionStatus &status = acquisition[index];
+    bool fast = status.mode == ACQUISITION_FAST || (status.mode == ACQUISITION_AUTO && active);
+    bool switching = status.switchable && fast != status.fast;
+    status.active = active;
+    if (switching)
+    {
+        status.fast = fast;
+    }
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (switching)
+    {
+        digitalWrite(ratePins[index], fast ? HIGH : LOW);
+        settlingReadings[index] = ACQUISITION_SETTLE_READINGS;
+        rateSwitchCounts[index]++;
+    }
+}
+
+// Accumulate raw values for tareScales()
+static void onTareSample(int index, long raw, void *context)
+{
+    long long *sums = (long long *)((void **)context)[0];
+    int *counts = (int *)((void **)context)[1];
+    sums[index] += raw;
+    counts[index]++;
+}
+
+// Prefer PSRAM for the capture buffer if the board has it
+static void *allocateCaptureMemory(size_t size)
+{
+    void *memory = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return memory != nullptr ? memory : malloc(size);
+}
+
+// Collect readings for a running tare and apply the new offset when done.
+// Returns true if it was applied.
+static bool updateTare(int index, long raw)
+{
+    long offset = 0;
+    bool finished = false;
+
+    taskENTER_CRITICAL(&controlMux);
+    TareState &tare = tares[index];
+    if (tare.remaining > 0)
+    {
+        tare.sum += raw;
+        tare.count++;
+        if (--tare.remaining == 0)
+        {
+            offset = tare.sum / tare.count;
+            finished = true;
+        }
+    }
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (!finished)
+    {
+        return false;
+    }
+
+    sampledScales[index].set_offset(offset);
+    return true;
+}
+
+// Collect readings for a calibration run. When a mass is done, fit the
+// line through all readings of the run and apply it like a tare. Returns
+// true if a fit was applied.
+static bool updateCalibration(int index, long raw, uint32_t timestamp)
+{
+    CalibrationFit fit;
+    bool finished = false;
+
+    taskENTER_CRITICAL(&controlMux);
+    CalibrationStatus &status = calibrations[index];
+    if (status.state == CALIBRATION_COLLECTING && status.remaining > 0 && (int32_t)(timestamp - calibrationStarts[index]) >= 0)
+    {
+        calibrationFits[index].add(status.grams, raw);
+        if (--status.remaining == 0)
+        {
+            status.points++;
+            fit = calibrationFits[index];
+            finished = true;
+        }
+    }
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (!finished)
+    {
+        return false;
+    }
+
+    // A single mass has no line through it, the run waits for the next one
+    float factor = 0;
+    long offset = 0;
+    float residual = 0;
+    bool solved = fit.solve(factor, offset, residual);
+    CalibrationError error = CALIBRATION_OK;
+    if (solved && fabsf(factor) < CALIBRATION_MIN_FACTOR)
+    {
+        error = CALIBRATION_NO_RESPONSE;
+    }
+    else if (solved && residual > CALIBRATION_MAX_RESIDUAL_GRAMS)
+    {
+        error = CALIBRATION_UNSTABLE;
+    }
+
+    // Unless a new request came in while solving
+    taskENTER_CRITICAL(&controlMux);
+    bool current = status.state == CALIBRATION_COLLECTING && status.remaining == 0;
+    if (current)
+    {
+        status.state = error != CALIBRATION_OK ? CALIBRATION_FAILED : solved ? CALIBRATION_CALIBRATED : CALIBRATION_WAITING;
+        status.error = error;
+        if (solved)
+        {
+            status.factor = factor;
+            status.offset = offset;
+            status.residual = residual;
+        }
+    }
+    taskEXIT_CRITICAL(&controlMux);
+
+    if (!current || !solved || error != CALIBRATION_OK)
+    {
+        return false;
+    }
+
+    sampledScales[index].set_offset(offset);
+    sampledScales[index].set_scale(factor);
+    return true;
+}
+
+// The zero of a cell was just set by a tare or a calibration run. The
+// weight jumps, so filtering, stability detection and drift start afresh.
+static void restartWeight(int index)
+{
+    filters[index].configure(filters[index].getConfig());
+    stabilityDetectors[index].reset();
+    restartDrift(index);
+}
+
+// Stop the run of a cell whose readings can no longer be fitted together.
+// A run that was not applied yet fails, an applied one just ends.
+static void endCalibration(int index, CalibrationError error)
+{
+    taskENTER_CRITICAL(&controlMux);
+    CalibrationStatus &status = calibrations[index];
+    if (status.state == CALIBRATION_COLLECTING || status.state == CALIBRATION_WAITING)
+    {
+        status.state = CALIBRATION_FAILED;
+        status.error = error;
+        status.remaining = 0;
+    }
+    else if (status.state == CALIBRATION_CALIBRATED)
+    {
+        status.state = CALIBRATION_IDLE;
+    }
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+/* Zero Tracking */
+
+// Take over drift settings, then move the zero of every cell along its
+// drift model. The steps are a fraction of a gram, small enough for the
+// filters to follow without a restart.
+static void applyDrift()
+{
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        taskENTER_CRITICAL(&controlMux);
+        bool pending = driftPending[i];
+        if (pending)
+        {
+            drifts[i].config = pendingDrifts[i];
+            driftPending[i] = false;
+        }
+        taskEXIT_CRITICAL(&controlMux);
+
+        if (pending)
+        {
+            restartDrift(i);
+        }
+    }
+
+    uint32_t now = millis();
+    if (now - driftUpdateStart < DRIFT_UPDATE_MS)
+    {
+        return;
+    }
+    driftUpdateStart = now;
+    chipTemperature += DRIFT_TEMPERATURE_ALPHA * (temperatureRead() - chipTemperature);
+
+    for (int i = 0; i < numSampledScales; ++i)
+    {
+        driftElapsedMs[i] += now - driftClocks[i];
+        driftClocks[i] = now;
+
+        const DriftConfig &config = drifts[i].config;
+        if (config.source == DRIFT_OFF || config.rate == 0)
+        {
+            continue;
+        }
+
+        // The zero rises by rate per hour or °C, the offset follows it
+        HX711 &scale = sampledScales[i];
+        float grams = config.rate * driftPosition(i);
+        long counts = lroundf(grams * scale.get_scale());
+        if (counts == modelledCounts[i])
+        {
+            continue;
+        }
+        scale.set_offset(scale.get_offset() + counts - modelledCounts[i]);
+        modelledCounts[i] = counts;
+
+        taskENTER_CRITICAL(&controlMux);
+        drifts[i].modelled = grams;
+        taskEXIT_CRITICAL(&controlMux);
+        markCalibrationDrifted();
+    }
+}
+
+// Follow the zero of an empty cell, see ZeroTracker. Judged on the
+// unfiltered weight, the zero band of the filters hides small offsets.
+static void updateZeroTracking(int index, long raw, uint32_t timestamp)
+{
+    const LoadCellReading &reading = latestReadings[index];
+    if (!drifts[index].config.autoZero)
+    {
+        return;
+    }
+
+    ZeroTracker &tracker = zeroTrackers[index];
+    float step = tracker.update((raw - reading.offset) / reading.factor, reading.stable, timestamp);
+    long counts = lroundf(step * reading.factor);
+    if (counts == 0)
+    {
+        return;
+    }
+
+    HX711 &scale = sampledScales[index];
+    scale.set_offset(scale.get_offset() + counts);
+    autoZeroCounts[index]++;
+
+    taskENTER_CRITICAL(&controlMux);
+    drifts[index].tracked = tracker.getTotal();
+    taskEXIT_CRITICAL(&controlMux);
+    markCalibrationDrifted();
+}
+
+// The zero was just set, by a tare, a calibration, a gain change or new
+// drift settings. Corrections count from here.
+static void restartDrift(int index)
+{
+    zeroTrackers[index].reset();
+    driftReferences[index] = chipTemperature;
+    driftElapsedMs[index] = 0;
+    driftClocks[index] = millis();
+    modelledCounts[index] = 0;
+
+    taskENTER_CRITICAL(&controlMux);
+    drifts[index].tracked = 0;
+    drifts[index].modelled = 0;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+// How far a cell moved along its drift model since the zero was last set,
+// in hours or °C
+static float driftPosition(int index)
+{
+    if (drifts[index].config.source == DRIFT_TEMPERATURE)
+    {
+        return chipTemperature - driftReferences[index];
+    }
+    return driftElapsedMs[index] / 3600000.0f;
+}
+
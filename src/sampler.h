@@ -0,0 +1,55 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include "HX711.h"
+#include "acquisition_status.h"
+#include "calibration.h"
+#include "capture.h"
+#include "cell_config.h"
+#include "filters.h"
+#include "readings.h"
+
+// A cell without a new sample for this long is reported as not connected
+#define SAMPLE_TIMEOUT_MS 500
+
+// Readings averaged by a tare requested through the API
+#define TARE_DEFAULT_SAMPLES 10
+
+// Longest the sampler sleeps without a data ready interrupt
+#define SAMPLER_WAIT_TIMEOUT_MS 5
+
+// Readings dropped after a rate or gain change, the HX711 output takes four
+// conversions to settle
+#define ACQUISITION_SETTLE_READINGS 4
+
+void beginSampler(HX711 scales[], const CellConfig &config, const uint8_t gains[]);
+bool tareScales(uint32_t mask, int times, uint32_t timeoutMs);
+void requestTare(int index, int times);
+bool isTareRunning(int index);
+void startSampler();
+LoadCellReading getLatestReading(int index);
+uint32_t getSampleCount(int index);
+uint32_t getNotReadyCount(int index);
+uint32_t getDisconnectCount(int index);
+uint32_t getWeightVersion(int index);
+uint32_t getCalibrationVersion(int index);
+void setCalibrationFactor(int index, float factor);
+void setFilterConfig(int index, const FilterConfig &config);
+FilterConfig getFilterConfig(int index);
+bool startCapture(uint32_t maxSamples);
+void stopCapture();
+const CaptureBuffer &getCapture();
+void setAcquisitionMode(int index, AcquisitionMode mode);
+void holdFastRate(int index, uint32_t durationMs);
+void setGain(int index, uint8_t gain);
+AcquisitionStatus getAcquisitionStatus(int index);
+uint32_t getRateSwitchCount(int index);
+void requestCalibrationPoint(uint32_t mask, float grams, int samples, bool restart);
+CalibrationStatus getCalibrationStatus(int index);
+void setDriftConfig(int index, const DriftConfig &config);
+DriftStatus getDriftStatus(int index);
+float getChipTemperature();
+uint32_t getAutoZeroCount(int index);
+
+#endif
@@ -0,0 +1,218 @@
+// Host implementation of sim/native/Arduino.h and freertos_sim.h
+
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <random>
+#include <thread>
+#include "sim_hardware.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+static uint32_t uptimeMs = 0;
+
+/* Time */
+
+// 32 bits as on the ESP32, so it wraps after 49.7 days
+unsigned long millis()
+{
+    return (uint32_t)(uptimeMs + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count());
+}
+
+void simSetUptime(uint32_t ms)
+{
+    uptimeMs = ms;
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+/* Chip */
+
+float temperatureRead()
+{
+    return simTemperature();
+}
+
+/* Random */
+
+uint32_t esp_random()
+{
+    static std::random_device device;
+    return device();
+}
+
+/* GPIO, there is no pin state to simulate */
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) { simWritePin(pin, value); }
+int digitalRead(uint8_t pin) { return HIGH; }
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+// DOUT edges are not simulated, the sampler task wakes on its poll timeout
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {}
+void detachInterrupt(uint8_t pin) {}
+
+/* Tasks */
+
+struct SimTask
+{
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+};
+
+static thread_local SimTask *currentTask = nullptr;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    // Tasks run until the process exits, so the task object is never freed
+    SimTask *task = new SimTask();
+    if (handle != nullptr)
+    {
+        *handle = task;
+    }
+
+    std::thread([task, function, parameter]()
+                {
+        currentTask = task;
+        function(parameter); })
+        .detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    return xTaskCreate(function, name, stackDepth, parameter, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Only self-deletion is used. A thread cannot be ended from inside its
+    // function, so it is parked instead.
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+    *previousWake += increment;
+    int32_t remaining = (int32_t)(*previousWake - xTaskGetTickCount());
+    if (remaining > 0)
+    {
+        delay(remaining);
+    }
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return millis();
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+/* Task notifications */
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait)
+{
+    if (currentTask == nullptr)
+    {
+        // Called from the setup()/loop() thread, which has no task object
+        delay(ticksToWait);
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> lock(currentTask->mutex);
+    currentTask->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait), []
+                                   { return currentTask->notifications > 0; });
+
+    uint32_t value = currentTask->notifications;
+    if (value > 0)
+    {
+        currentTask->notifications = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->notified.notify_one();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+    xTaskNotifyGive(task);
+}
+
+/* Semaphores */
+
+struct SimSemaphore
+{
+    std::recursive_timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new SimSemaphore();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    return new SimSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    if (ticksToWait == portMAX_DELAY)
+    {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
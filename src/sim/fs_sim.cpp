@@ -0,0 +1,71 @@
+// Host implementation of sim/native/FS.h and SPIFFS.h
+
+#include <SPIFFS.h>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include "sim_hardware.h"
+
+SPIFFSFS SPIFFS;
+
+// SPIFFS paths start with '/', map them below the root directory
+static std::string hostPath(const char *path)
+{
+    return std::string(simFileSystemRoot()) + (path[0] == '/' ? "" : "/") + path;
+}
+
+namespace fs
+{
+
+File FS::open(const char *path, const char *mode, bool create)
+{
+    return File(fopen(hostPath(path).c_str(), mode));
+}
+
+bool FS::exists(const char *path)
+{
+    struct stat info;
+    return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+} // namespace fs
+
+bool SPIFFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles)
+{
+    struct stat info;
+    if (stat(simFileSystemRoot(), &info) == 0)
+    {
+        return S_ISDIR(info.st_mode);
+    }
+    return formatOnFail && mkdir(simFileSystemRoot(), 0755) == 0;
+}
+
+size_t SPIFFSFS::usedBytes()
+{
+    size_t used = 0;
+    DIR *dir = opendir(simFileSystemRoot());
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+    while (struct dirent *entry = readdir(dir))
+    {
+        struct stat info;
+        if (stat(hostPath(entry->d_name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+        {
+            used += info.st_size;
+        }
+    }
+    closedir(dir);
+    return used;
+}
@@ -0,0 +1,61 @@
+// Allocation counting for the native benchmarks (sim_hardware.h). Replaces
+// the global operator new; only threads that asked are counted, so the
+// sampler and other tasks running at the same time do not show up.
+
+#include <cstdlib>
+#include <new>
+#include "sim_hardware.h"
+
+static thread_local bool counting = false;
+static thread_local SimAllocations allocations;
+
+void simStartAllocationCount()
+{
+    allocations = {0, 0};
+    counting = true;
+}
+
+SimAllocations simStopAllocationCount()
+{
+    counting = false;
+    return allocations;
+}
+
+void *operator new(size_t size)
+{
+    if (counting)
+    {
+        allocations.count++;
+        allocations.bytes += size;
+    }
+    if (void *p = malloc(size != 0 ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
@@ -0,0 +1,177 @@
+// Host implementation of sim/native/HTTPClient.h
+
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Function Prototypes
+static int connectTo(const std::string &host, uint16_t port, int32_t timeoutMs);
+static bool sendAll(int socket, const char *data, size_t length);
+
+bool HTTPClient::begin(const String &url)
+{
+    std::string text = url.c_str();
+    const std::string scheme = "http://";
+    if (text.compare(0, scheme.size(), scheme) != 0)
+    {
+        return false;
+    }
+
+    size_t hostStart = scheme.size();
+    size_t pathStart = text.find('/', hostStart);
+    std::string authority = text.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+    path = pathStart == std::string::npos ? "/" : text.substr(pathStart);
+
+    size_t colon = authority.rfind(':');
+    host = authority.substr(0, colon);
+    port = colon == std::string::npos ? 80 : (uint16_t)atoi(authority.c_str() + colon + 1);
+    headers.clear();
+    return !host.empty() && port != 0;
+}
+
+void HTTPClient::end()
+{
+    headers.clear();
+}
+
+void HTTPClient::addHeader(const String &name, const String &value)
+{
+    headers.push_back(std::string(name.c_str()) + ": " + value.c_str());
+}
+
+int HTTPClient::POST(uint8_t *payload, size_t size)
+{
+    // The device has no route out without WiFi
+    if (!WiFi.isConnected())
+    {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+
+    int socket = connectTo(host, port, connectTimeoutMs);
+    if (socket < 0)
+    {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string head = "POST " + path + " HTTP/1.1\r\nHost: " + host + ":" + std::to_string(port) + "\r\n";
+    for (const std::string &header : headers)
+    {
+        head += header + "\r\n";
+    }
+    head += "Content-Length: " + std::to_string(size) + "\r\nConnection: close\r\n\r\n";
+
+    if (!sendAll(socket, head.data(), head.size()))
+    {
+        close(socket);
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    if (!sendAll(socket, (const char *)payload, size))
+    {
+        close(socket);
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+
+    // Only the status line is needed
+    struct timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string status;
+    char c;
+    while (status.find("\r\n") == std::string::npos && status.size() < 256)
+    {
+        ssize_t received = recv(socket, &c, 1, 0);
+        if (received <= 0)
+        {
+            close(socket);
+            return received < 0 ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+        }
+        status += c;
+    }
+    close(socket);
+
+    int code = 0;
+    if (sscanf(status.c_str(), "HTTP/%*s %d", &code) != 1)
+    {
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+    return code;
+}
+
+String HTTPClient::errorToString(int error)
+{
+    switch (error)
+    {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+        return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+        return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+        return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:
+        return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:
+        return "connection lost";
+    case HTTPC_ERROR_READ_TIMEOUT:
+        return "read timeout";
+    default:
+        return String();
+    }
+}
+
+// Non-blocking connect so the connect timeout applies as on the ESP32
+static int connectTo(const std::string &host, uint16_t port, int32_t timeoutMs)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *address = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0)
+    {
+        return -1;
+    }
+
+    int socket = ::socket(address->ai_family, address->ai_socktype, 0);
+    if (socket < 0)
+    {
+        freeaddrinfo(address);
+        return -1;
+    }
+
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+    int result = connect(socket, address->ai_addr, address->ai_addrlen);
+    freeaddrinfo(address);
+
+    if (result < 0)
+    {
+        struct pollfd descriptor = {socket, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&descriptor, 1, timeoutMs) != 1 || getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0)
+        {
+            close(socket);
+            return -1;
+        }
+    }
+    fcntl(socket, F_SETFL, flags);
+    return socket;
+}
+
+static bool sendAll(int socket, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
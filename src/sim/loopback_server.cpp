@@ -0,0 +1,785 @@
+// Host implementation of sim/native/ESPAsyncWebServer.h
+
+#include <ESPAsyncWebServer.h>
+#include <lwip/priv/tcp_priv.h>
+#include <lwip/tcpip.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <regex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "sim_hardware.h"
+
+// Largest request head or body accepted by the localhost listener
+#define SIM_HTTP_MAX_REQUEST 65536
+
+// Handlers, fillers and WebSocket events run under this lock, like on the
+// single AsyncTCP task of the ESP32
+static std::recursive_mutex asyncTcp;
+
+// Stands in for the tcpip thread, which owns the PCB lists
+static std::mutex tcpipThread;
+struct tcp_pcb *tcp_active_pcbs = nullptr;
+
+// Function Prototypes
+static WebRequestMethod parseMethod(const std::string &method);
+static String urlDecode(const std::string &text);
+static void parseParameters(const std::string &text, bool form, std::vector<AsyncWebParameter> &parameters);
+static void serveConnection(AsyncWebServer *server, int socket);
+static const char *reasonPhrase(int code);
+
+/* Responses */
+
+std::string AsyncCallbackResponse::simBody(AsyncClient *client)
+{
+    std::string body;
+    uint8_t buffer[1460];
+    for (;;)
+    {
+        size_t maxLen = sizeof(buffer);
+        if (!chunked)
+        {
+            if (body.size() >= length)
+            {
+                break;
+            }
+            maxLen = min(maxLen, length - body.size());
+        }
+
+        size_t n = filler(buffer, maxLen, body.size());
+        if (client->simClosed())
+        {
+            break;
+        }
+        if (n == RESPONSE_TRY_AGAIN)
+        {
+            // Asked again on the next poll, other requests are served meanwhile
+            asyncTcp.unlock();
+            client->simWaitForPoll();
+            asyncTcp.lock();
+            continue;
+        }
+        if (n == 0 || n > maxLen)
+        {
+            break;
+        }
+        body.append((const char *)buffer, n);
+    }
+    return body;
+}
+
+/* Connections */
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx)
+{
+    std::lock_guard<std::mutex> lock(tcpipThread);
+    function(ctx);
+    return ERR_OK;
+}
+
+AsyncClient::AsyncClient() : connectionPcb{nullptr, this, simPoll}
+{
+    std::lock_guard<std::mutex> lock(tcpipThread);
+    connectionPcb.next = tcp_active_pcbs;
+    tcp_active_pcbs = &connectionPcb;
+}
+
+AsyncClient::~AsyncClient()
+{
+    std::lock_guard<std::mutex> lock(tcpipThread);
+    for (tcp_pcb **link = &tcp_active_pcbs; *link != nullptr; link = &(*link)->next)
+    {
+        if (*link == &connectionPcb)
+        {
+            *link = connectionPcb.next;
+            break;
+        }
+    }
+}
+
+void AsyncClient::close(bool now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    polled.notify_all();
+}
+
+bool AsyncClient::simClosed()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return closed;
+}
+
+void AsyncClient::simWaitForPoll()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    polled.wait_for(lock, std::chrono::milliseconds(500), [this]
+                    { return pollPending; });
+    pollPending = false;
+}
+
+err_t AsyncClient::simPoll(void *arg, tcp_pcb *pcb)
+{
+    AsyncClient *client = (AsyncClient *)arg;
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->pollPending = true;
+    client->polled.notify_all();
+    return ERR_OK;
+}
+
+/* Requests */
+
+AsyncWebServerRequest::AsyncWebServerRequest(WebRequestMethod method, const String &url,
+                                             const std::vector<AsyncWebParameter> &parameters,
+                                             const std::vector<AsyncWebHeader> &headers)
+    : requestMethod(method), requestUrl(url), parameters(parameters), requestHeaders(headers)
+{
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest()
+{
+    delete response;
+}
+
+const AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const
+{
+    for (const AsyncWebParameter &parameter : parameters)
+    {
+        if (parameter.name() == name && parameter.isPost() == post)
+        {
+            return &parameter;
+        }
+    }
+    return nullptr;
+}
+
+bool AsyncWebServerRequest::hasArg(const char *name) const
+{
+    for (const AsyncWebParameter &parameter : parameters)
+    {
+        if (parameter.name() == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const String &AsyncWebServerRequest::arg(const String &name) const
+{
+    static const String empty;
+    for (const AsyncWebParameter &parameter : parameters)
+    {
+        if (parameter.name() == name)
+        {
+            return parameter.value();
+        }
+    }
+    return empty;
+}
+
+const String &AsyncWebServerRequest::pathArg(size_t index) const
+{
+    static const String empty;
+    return index < pathArgs.size() ? pathArgs[index] : empty;
+}
+
+const AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const
+{
+    for (const AsyncWebHeader &header : requestHeaders)
+    {
+        if (header.name().equalsIgnoreCase(name))
+        {
+            return &header;
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content)
+{
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response)
+{
+    {
+        std::lock_guard<std::mutex> lock(responseMutex);
+        if (this->response != nullptr)
+        {
+            // Only the first response is sent
+            delete response;
+            return;
+        }
+        this->response = response;
+    }
+    responseSent.notify_all();
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content)
+{
+    return new AsyncBasicResponse(code, contentType.isEmpty() ? String("text/plain") : contentType, content);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(const String &contentType, size_t length, AwsResponseFiller filler,
+                                                             AwsTemplateProcessor processor)
+{
+    return new AsyncCallbackResponse(contentType, length, filler, false);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller filler,
+                                                                    AwsTemplateProcessor processor)
+{
+    return new AsyncCallbackResponse(contentType, 0, filler, true);
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String &contentType, size_t bufferSize)
+{
+    return new AsyncResponseStream(contentType, bufferSize);
+}
+
+bool AsyncWebServerRequest::simWaitForResponse(uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(responseMutex);
+    return responseSent.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+                                 { return response != nullptr; });
+}
+
+void AsyncWebServerRequest::simDisconnect()
+{
+    if (disconnectHandler)
+    {
+        disconnectHandler();
+    }
+}
+
+/* Handlers */
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+    if (!(method & request->method()))
+    {
+        return false;
+    }
+
+#ifdef ASYNCWEBSERVER_REGEX
+    if (uri.startsWith("^") && uri.endsWith("$"))
+    {
+        std::regex pattern(uri.c_str());
+        std::smatch matches;
+        std::string url(request->url().c_str());
+        if (!std::regex_search(url, matches, pattern))
+        {
+            return false;
+        }
+
+        // Groups that did not take part in the match become empty arguments
+        std::vector<String> args;
+        for (size_t i = 1; i < matches.size(); ++i)
+        {
+            args.push_back(String(matches[i].str()));
+        }
+        request->simSetPathArgs(args);
+        return true;
+    }
+#endif
+
+    if (uri.endsWith("*"))
+    {
+        return request->url().startsWith(uri.substring(0, uri.length() - 1));
+    }
+    return uri == request->url() || request->url().startsWith(uri + "/");
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+    if (onRequest)
+    {
+        onRequest(request);
+    }
+    else
+    {
+        request->send(500);
+    }
+}
+
+/* WebSocket */
+
+void AsyncWebSocketClient::text(const char *message, size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!closed)
+    {
+        frames.emplace_back(message, length);
+    }
+}
+
+bool AsyncWebSocketClient::canSend()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !closed && frames.size() < WS_MAX_QUEUED_MESSAGES;
+}
+
+void AsyncWebSocketClient::close(uint16_t code, const char *message)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+}
+
+std::vector<std::string> AsyncWebSocketClient::simTakeFrames()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> taken;
+    taken.swap(frames);
+    return taken;
+}
+
+bool AsyncWebSocketClient::simClosed()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return closed;
+}
+
+size_t AsyncWebSocket::count()
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    size_t open = 0;
+    for (const auto &client : clients)
+    {
+        open += client->simClosed() ? 0 : 1;
+    }
+    return open;
+}
+
+AsyncWebSocketClient *AsyncWebSocket::client(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (const auto &client : clients)
+    {
+        if (client->id() == id && !client->simClosed())
+        {
+            return client.get();
+        }
+    }
+    return nullptr;
+}
+
+bool AsyncWebSocket::availableForWriteAll()
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (const auto &client : clients)
+    {
+        if (!client->simClosed() && !client->canSend())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AsyncWebSocket::textAll(const char *message, size_t length)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (const auto &client : clients)
+    {
+        client->text(message, length);
+    }
+}
+
+AsyncWebSocketClient *AsyncWebSocket::simConnect(const char *query)
+{
+    AsyncWebSocketClient *client;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        clients.emplace_back(new AsyncWebSocketClient(this, nextId++));
+        client = clients.back().get();
+    }
+
+    std::vector<AsyncWebParameter> parameters;
+    parseParameters(query, false, parameters);
+    AsyncWebServerRequest request(HTTP_GET, socketUrl, parameters, {});
+
+    std::lock_guard<std::recursive_mutex> lock(asyncTcp);
+    if (eventHandler)
+    {
+        eventHandler(this, client, WS_EVT_CONNECT, &request, nullptr, 0);
+    }
+
+    // The server may have refused the client right away
+    if (client->simClosed() && eventHandler)
+    {
+        eventHandler(this, client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    }
+    return client;
+}
+
+void AsyncWebSocket::simReceive(AsyncWebSocketClient *client, const char *message)
+{
+    std::string data(message);
+    AwsFrameInfo info = {};
+    info.message_opcode = WS_TEXT;
+    info.opcode = WS_TEXT;
+    info.final = 1;
+    info.len = data.size();
+
+    std::lock_guard<std::recursive_mutex> lock(asyncTcp);
+    if (eventHandler && !client->simClosed())
+    {
+        eventHandler(this, client, WS_EVT_DATA, &info, (uint8_t *)&data[0], data.size());
+    }
+}
+
+void AsyncWebSocket::simDisconnect(AsyncWebSocketClient *client)
+{
+    std::lock_guard<std::recursive_mutex> lock(asyncTcp);
+    if (client->simClosed())
+    {
+        return;
+    }
+    client->close();
+    if (eventHandler)
+    {
+        eventHandler(this, client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    }
+}
+
+/* Server */
+
+void AsyncWebServer::begin()
+{
+    if (simHttpPort() != 0)
+    {
+        std::thread(&AsyncWebServer::listen, this).detach();
+    }
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+{
+    callbackHandlers.emplace_back(new AsyncCallbackWebHandler(uri, method, onRequest));
+    handlers.push_back(callbackHandlers.back().get());
+    return *callbackHandlers.back();
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler)
+{
+    handlers.push_back(handler);
+    return *handler;
+}
+
+SimHttpResponse AsyncWebServer::simRequest(const char *method, const char *url, const char *body,
+                                           const std::vector<std::pair<String, String>> &headers,
+                                           uint32_t timeoutMs)
+{
+    WebRequestMethod requestMethod = parseMethod(method);
+    std::string target(url);
+    size_t queryStart = target.find('?');
+
+    std::vector<AsyncWebParameter> parameters;
+    if (queryStart != std::string::npos)
+    {
+        parseParameters(target.substr(queryStart + 1), false, parameters);
+    }
+    if (requestMethod == HTTP_POST || requestMethod == HTTP_PUT || requestMethod == HTTP_PATCH)
+    {
+        parseParameters(body, true, parameters);
+    }
+
+    std::vector<AsyncWebHeader> requestHeaders;
+    for (const auto &header : headers)
+    {
+        requestHeaders.emplace_back(header.first, header.second);
+    }
+
+    AsyncWebServerRequest *request = new AsyncWebServerRequest(requestMethod, urlDecode(target.substr(0, queryStart)),
+                                                               parameters, requestHeaders);
+    SimAllocations handlerAllocations;
+    {
+        std::lock_guard<std::recursive_mutex> lock(asyncTcp);
+        simStartAllocationCount();
+        AsyncWebHandler *handler = nullptr;
+        for (AsyncWebHandler *candidate : handlers)
+        {
+            if (candidate->canHandle(request))
+            {
+                handler = candidate;
+                break;
+            }
+        }
+
+        if (handler != nullptr)
+        {
+            handler->handleRequest(request);
+        }
+        else if (notFoundHandler)
+        {
+            notFoundHandler(request);
+        }
+        else
+        {
+            request->send(404);
+        }
+        handlerAllocations = simStopAllocationCount();
+    }
+
+    // Deferred responses are sent later from another task
+    SimHttpResponse result = {0, "", {}, "", handlerAllocations, false};
+    bool sent = request->simWaitForResponse(timeoutMs);
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(asyncTcp);
+        if (sent)
+        {
+            AsyncWebServerResponse *response = request->simResponse();
+            result.code = response->simCode();
+            result.contentType = response->simContentType().c_str();
+            for (const AsyncWebHeader &header : response->simHeaders())
+            {
+                result.headers.emplace_back(header.name().c_str(), header.value().c_str());
+            }
+            simStartAllocationCount();
+            result.body = response->simBody(request->client());
+            result.closed = request->client()->simClosed();
+            SimAllocations bodyAllocations = simStopAllocationCount();
+            result.allocations.count += bodyAllocations.count;
+            result.allocations.bytes += bodyAllocations.bytes;
+        }
+        request->simDisconnect();
+    }
+    delete request;
+
+    return result;
+}
+
+AsyncWebSocket *AsyncWebServer::simWebSocket(const char *url)
+{
+    for (AsyncWebHandler *handler : handlers)
+    {
+        AsyncWebSocket *socket = dynamic_cast<AsyncWebSocket *>(handler);
+        if (socket != nullptr && strcmp(socket->url(), url) == 0)
+        {
+            return socket;
+        }
+    }
+    return nullptr;
+}
+
+// Accept HTTP/1.1 connections on localhost, one thread per connection
+void AsyncWebServer::listen()
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(simHttpPort());
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(listener, 16) != 0)
+    {
+        Serial.printf("[sim] Cannot listen on 127.0.0.1:%u\n", simHttpPort());
+        close(listener);
+        return;
+    }
+    Serial.printf("[sim] Port %u is served on http://127.0.0.1:%u\n", port, simHttpPort());
+
+    for (;;)
+    {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection >= 0)
+        {
+            std::thread(serveConnection, this, connection).detach();
+        }
+    }
+}
+
+/* Helpers */
+
+static WebRequestMethod parseMethod(const std::string &method)
+{
+    static const struct
+    {
+        const char *name;
+        WebRequestMethod method;
+    } methods[] = {
+        {"GET", HTTP_GET},
+        {"POST", HTTP_POST},
+        {"DELETE", HTTP_DELETE},
+        {"PUT", HTTP_PUT},
+        {"PATCH", HTTP_PATCH},
+        {"HEAD", HTTP_HEAD},
+        {"OPTIONS", HTTP_OPTIONS},
+    };
+    for (const auto &entry : methods)
+    {
+        if (method == entry.name)
+        {
+            return entry.method;
+        }
+    }
+    return HTTP_GET;
+}
+
+static String urlDecode(const std::string &text)
+{
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == '+')
+        {
+            decoded += ' ';
+        }
+        else if (text[i] == '%' && i + 2 < text.size() && isxdigit(text[i + 1]) && isxdigit(text[i + 2]))
+        {
+            decoded += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        }
+        else
+        {
+            decoded += text[i];
+        }
+    }
+    return String(decoded);
+}
+
+// Split "a=1&b=2" into parameters
+static void parseParameters(const std::string &text, bool form, std::vector<AsyncWebParameter> &parameters)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('&', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+
+        std::string pair = text.substr(start, end - start);
+        if (!pair.empty())
+        {
+            size_t equals = pair.find('=');
+            std::string name = pair.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : pair.substr(equals + 1);
+            parameters.emplace_back(urlDecode(name), urlDecode(value), form);
+        }
+        start = end + 1;
+    }
+}
+
+// Read one request, answer it and close, as ESPAsyncWebServer does
+static void serveConnection(AsyncWebServer *server, int connection)
+{
+    std::string data;
+    char buffer[2048];
+    size_t headEnd;
+    while ((headEnd = data.find("\r\n\r\n")) == std::string::npos)
+    {
+        ssize_t n = recv(connection, buffer, sizeof(buffer), 0);
+        if (n <= 0 || data.size() > SIM_HTTP_MAX_REQUEST)
+        {
+            close(connection);
+            return;
+        }
+        data.append(buffer, n);
+    }
+
+    // Request line and headers
+    std::string head = data.substr(0, headEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t methodEnd = requestLine.find(' ');
+    size_t targetEnd = requestLine.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || targetEnd == std::string::npos)
+    {
+        close(connection);
+        return;
+    }
+    std::string method = requestLine.substr(0, methodEnd);
+    std::string target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+
+    std::vector<std::pair<String, String>> headers;
+    size_t contentLength = 0;
+    size_t lineStart = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+    while (lineStart < head.size())
+    {
+        size_t end = head.find("\r\n", lineStart);
+        if (end == std::string::npos)
+        {
+            end = head.size();
+        }
+        std::string line = head.substr(lineStart, end - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos)
+        {
+            String name(line.substr(0, colon));
+            String value(line.substr(colon + 1));
+            value.trim();
+            if (name.equalsIgnoreCase("Content-Length"))
+            {
+                contentLength = min((size_t)value.toInt(), (size_t)SIM_HTTP_MAX_REQUEST);
+            }
+            headers.emplace_back(name, value);
+        }
+        lineStart = end + 2;
+    }
+
+    // Body
+    std::string body = data.substr(headEnd + 4);
+    while (body.size() < contentLength)
+    {
+        ssize_t n = recv(connection, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        body.append(buffer, n);
+    }
+    body.resize(min(body.size(), contentLength));
+
+    SimHttpResponse response = server->simRequest(method.c_str(), target.c_str(), body.c_str(), headers);
+    // A response cut off by AsyncClient::close() is dropped with the connection
+    if (response.code != 0 && !response.closed)
+    {
+        std::string message = "HTTP/1.1 " + std::to_string(response.code) + " " + reasonPhrase(response.code) + "\r\n";
+        message += "Content-Type: " + response.contentType + "\r\n";
+        message += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+        for (const auto &header : response.headers)
+        {
+            message += header.first + ": " + header.second + "\r\n";
+        }
+        message += "Connection: close\r\n\r\n";
+        if (method != "HEAD")
+        {
+            message += response.body;
+        }
+        send(connection, message.data(), message.size(), MSG_NOSIGNAL);
+    }
+    close(connection);
+}
+
+static const char *reasonPhrase(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 202:
+        return "Accepted";
+    case 204:
+        return "No Content";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 409:
+        return "Conflict";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "";
+    }
+}
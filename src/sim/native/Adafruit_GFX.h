@@ -0,0 +1,120 @@
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+// The drawing primitives of Adafruit_GFX the firmware uses, on top of a
+// subclass's drawPixel(). Text uses 6x8 cells like the built-in font, but
+// the glyphs are not letters: column 0 holds the character code and column
+// 1 its complement, so the simulated panel (sim_hardware.h) can read text
+// back out of the pixels it received over I2C.
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print
+{
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+    {
+        for (int16_t i = 0; i < h; ++i)
+        {
+            drawPixel(x, y + i, color);
+        }
+    }
+
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+    {
+        for (int16_t i = 0; i < w; ++i)
+        {
+            drawPixel(x + i, y, color);
+        }
+    }
+
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        for (int16_t i = 0; i < w; ++i)
+        {
+            drawFastVLine(x + i, y, h, color);
+        }
+    }
+
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        drawFastHLine(x, y, w, color);
+        drawFastHLine(x, y + h - 1, w, color);
+        drawFastVLine(x, y, h, color);
+        drawFastVLine(x + w - 1, y, h, color);
+    }
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size)
+    {
+        uint8_t columns[5] = {(uint8_t)(c & 0x7F), (uint8_t)(~c & 0x7F), 0, 0, 0};
+        for (int8_t i = 0; i < 6; ++i)
+        {
+            uint8_t line = i < 5 ? columns[i] : 0;
+            for (int8_t j = 0; j < 8; ++j, line >>= 1)
+            {
+                if ((line & 1) || bg != color)
+                {
+                    fillRect(x + i * size, y + j * size, size, size, (line & 1) ? color : bg);
+                }
+            }
+        }
+    }
+
+    size_t write(uint8_t c) override
+    {
+        if (c == '\n')
+        {
+            cursor_x = 0;
+            cursor_y += textsize * 8;
+            return 1;
+        }
+        if (c == '\r')
+        {
+            return 1;
+        }
+        if (wrap && cursor_x + textsize * 6 > _width)
+        {
+            cursor_x = 0;
+            cursor_y += textsize * 8;
+        }
+        drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+        cursor_x += textsize * 6;
+        return 1;
+    }
+    using Print::write;
+
+    void setCursor(int16_t x, int16_t y)
+    {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    void setTextSize(uint8_t s) { textsize = s > 0 ? s : 1; }
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; } // transparent background
+    void setTextColor(uint16_t c, uint16_t bg)
+    {
+        textcolor = c;
+        textbgcolor = bg;
+    }
+    void setTextWrap(bool w) { wrap = w; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+protected:
+    const int16_t WIDTH, HEIGHT;
+    int16_t _width, _height;
+    int16_t cursor_x = 0, cursor_y = 0;
+    uint16_t textcolor = 1, textbgcolor = 1;
+    uint8_t textsize = 1;
+    bool wrap = true;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SIM_ADAFRUIT_SH1106_H
+#define SIM_ADAFRUIT_SH1106_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+#include <string.h>
+
+#define SH1106_SWITCHCAPVCC 0x2
+#define SH1106_LCDWIDTH 128
+#define SH1106_LCDHEIGHT 64
+#define BLACK 0
+#define WHITE 1
+
+// Framebuffer for the 128x64 OLED. Like the library, display() sends all
+// 8 pages over Wire, where the simulated panel (sim_hardware.h) receives them.
+class Adafruit_SH1106 : public Adafruit_GFX
+{
+public:
+    Adafruit_SH1106(int8_t reset = -1) : Adafruit_GFX(SH1106_LCDWIDTH, SH1106_LCDHEIGHT) { clearDisplay(); }
+
+    void begin(uint8_t vccstate = SH1106_SWITCHCAPVCC, uint8_t i2caddr = 0x3C, bool reset = true)
+    {
+        address = i2caddr;
+        Wire.begin();
+    }
+
+    void clearDisplay() { memset(buffer, 0, sizeof(buffer)); }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        if (x < 0 || x >= SH1106_LCDWIDTH || y < 0 || y >= SH1106_LCDHEIGHT)
+        {
+            return;
+        }
+        uint8_t &byte = buffer[x + (y / 8) * SH1106_LCDWIDTH];
+        byte = color == WHITE ? byte | (1 << (y & 7)) : byte & ~(1 << (y & 7));
+    }
+
+    // Page address, then the page in 8 transfers of 16 bytes, from column 2
+    // of the 132 column RAM
+    void display()
+    {
+        for (int page = 0; page < SH1106_LCDHEIGHT / 8; ++page)
+        {
+            Wire.beginTransmission(address);
+            Wire.write(0x00);
+            Wire.write(0xB0 + page);
+            Wire.write(0x02);
+            Wire.write(0x10);
+            Wire.endTransmission();
+
+            for (int chunk = 0; chunk < SH1106_LCDWIDTH; chunk += 16)
+            {
+                Wire.beginTransmission(address);
+                Wire.write(0x40);
+                Wire.write(buffer + page * SH1106_LCDWIDTH + chunk, 16);
+                Wire.endTransmission();
+            }
+        }
+    }
+
+private:
+    uint8_t address = 0x3C;
+    uint8_t buffer[SH1106_LCDWIDTH * SH1106_LCDHEIGHT / 8];
+};
+
+#endif
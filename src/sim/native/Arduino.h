@@ -0,0 +1,324 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses.
+// Only compiled into [env:native]; time runs on the host clock, Serial
+// writes to stdout and GPIO/interrupts are no-ops (the simulated HX711 is
+// polled, see sim/native/HX711.h).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "freertos_sim.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/* Time */
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+/* Chip */
+
+// Internal sensor, °C
+float temperatureRead();
+
+/* Random */
+
+uint32_t esp_random();
+
+/* GPIO */
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+/* String */
+
+class String
+{
+public:
+    String() {}
+    String(const char *value) : value(value != nullptr ? value : "") {}
+    String(const std::string &value) : value(value) {}
+    String(char c) : value(1, c) {}
+    explicit String(int number) : value(std::to_string(number)) {}
+    explicit String(unsigned int number) : value(std::to_string(number)) {}
+    explicit String(long number) : value(std::to_string(number)) {}
+    explicit String(unsigned long number) : value(std::to_string(number)) {}
+    explicit String(float number, unsigned int decimals = 2) { format(number, decimals); }
+    explicit String(double number, unsigned int decimals = 2) { format(number, decimals); }
+
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    void reserve(unsigned int size) { value.reserve(size); }
+
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(value.c_str(), nullptr); }
+    double toDouble() const { return strtod(value.c_str(), nullptr); }
+
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : '\0'; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    int indexOf(char c, unsigned int from = 0) const { return position(value.find(c, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return position(value.find(s.value, from)); }
+    int lastIndexOf(char c) const { return position(value.rfind(c)); }
+
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            std::swap(from, to);
+        }
+        return from < value.size() ? String(value.substr(from, to - from)) : String();
+    }
+
+    bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return value.size() >= suffix.value.size() &&
+               value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+    }
+    bool equalsIgnoreCase(const String &other) const
+    {
+        return value.size() == other.value.size() && strncasecmp(value.c_str(), other.value.c_str(), value.size()) == 0;
+    }
+
+    void trim()
+    {
+        size_t start = value.find_first_not_of(" \t\r\n");
+        size_t end = value.find_last_not_of(" \t\r\n");
+        value = start == std::string::npos ? std::string() : value.substr(start, end - start + 1);
+    }
+    void toLowerCase()
+    {
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    }
+
+    bool concat(const String &s)
+    {
+        value += s.value;
+        return true;
+    }
+    bool concat(const char *s)
+    {
+        value += s != nullptr ? s : "";
+        return true;
+    }
+    bool concat(char c)
+    {
+        value += c;
+        return true;
+    }
+    String &operator+=(const String &s)
+    {
+        value += s.value;
+        return *this;
+    }
+    String &operator+=(const char *s)
+    {
+        concat(s);
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        value += c;
+        return *this;
+    }
+
+    friend String operator+(const String &a, const String &b) { return String(a.value + b.value); }
+    friend String operator+(const String &a, const char *b) { return String(a.value + (b != nullptr ? b : "")); }
+    friend String operator+(const char *a, const String &b) { return String((a != nullptr ? a : "") + b.value); }
+
+    bool operator==(const String &other) const { return value == other.value; }
+    bool operator==(const char *other) const { return value == (other != nullptr ? other : ""); }
+    bool operator!=(const String &other) const { return !(*this == other); }
+    bool operator!=(const char *other) const { return !(*this == other); }
+    bool operator<(const String &other) const { return value < other.value; }
+
+private:
+    std::string value;
+
+    static int position(size_t index) { return index == std::string::npos ? -1 : (int)index; }
+
+    void format(double number, unsigned int decimals)
+    {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+        value = buffer;
+    }
+};
+
+// Result type of String concatenation in the Arduino core, some libraries
+// (e.g. ArduinoJson) name it
+class StringSumHelper : public String
+{
+public:
+    StringSumHelper(const String &s) : String(s) {}
+};
+
+/* Print and Stream */
+
+class Print;
+
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size-- > 0)
+        {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char *s) { return s != nullptr ? write((const uint8_t *)s, strlen(s)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0)
+        {
+            return 0;
+        }
+        if ((size_t)length < sizeof(buffer))
+        {
+            return write((const uint8_t *)buffer, length);
+        }
+
+        std::string large(length + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&large[0], large.size(), format, args);
+        va_end(args);
+        return write((const uint8_t *)large.data(), length);
+    }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return printf("%d", n); }
+    size_t print(unsigned int n) { return printf("%u", n); }
+    size_t print(long n) { return printf("%ld", n); }
+    size_t print(unsigned long n) { return printf("%lu", n); }
+    size_t print(double n, int decimals = 2) { return printf("%.*f", decimals, n); }
+    size_t print(const Printable &p) { return p.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    size_t println(double n, int decimals) { return print(n, decimals) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(char *buffer, size_t length)
+    {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0)
+        {
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+    String readStringUntil(char terminator)
+    {
+        std::string s;
+        int c;
+        while ((c = read()) >= 0 && c != terminator)
+        {
+            s += (char)c;
+        }
+        return String(s);
+    }
+};
+
+// Serial monitor on stdout, reads from stdin are not supported
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+/* ESP */
+
+// Heap figures of the host process are meaningless, the simulation reports
+// what a typical ESP32 would. The cycle counter runs at 1 GHz, i.e. counts ns.
+class EspClass
+{
+public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 1000; }
+    uint32_t getFreeHeap() { return 200 * 1024; }
+    uint32_t getMinFreeHeap() { return 180 * 1024; }
+    uint32_t getMaxAllocHeap() { return 110 * 1024; }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#endif
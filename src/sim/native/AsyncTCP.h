@@ -0,0 +1,40 @@
+#ifndef SIM_ASYNCTCP_H
+#define SIM_ASYNCTCP_H
+
+// Transport of the simulated web server is in sim/loopback_server.cpp
+
+#include <condition_variable>
+#include <mutex>
+#include <lwip/tcp.h>
+
+// One connection of the simulated server. Its PCB is in tcp_active_pcbs
+// while the client exists, and a poll of the PCB wakes simWaitForPoll().
+class AsyncClient
+{
+public:
+    AsyncClient();
+    ~AsyncClient();
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    tcp_pcb *pcb() { return &connectionPcb; }
+
+    // Ends the response where it is, the client sees the connection drop
+    void close(bool now = false);
+    bool simClosed();
+
+    // Simulation: wait until the connection is polled, at most the 500 ms
+    // of the lwIP poll interval
+    void simWaitForPoll();
+
+private:
+    tcp_pcb connectionPcb;
+    std::mutex mutex;
+    std::condition_variable polled;
+    bool pollPending = false;
+    bool closed = false;
+
+    static err_t simPoll(void *arg, tcp_pcb *pcb);
+};
+
+#endif
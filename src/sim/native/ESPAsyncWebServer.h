@@ -0,0 +1,390 @@
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+// Loopback stand-in for the ESPAsyncWebServer API used by the firmware.
+// Requests are dispatched to the registered handlers either in-process with
+// AsyncWebServer::simRequest() or from a plain HTTP/1.1 listener on
+// localhost (see simSetHttpPort()). Handlers run one at a time, like on the
+// single AsyncTCP task; a filler that returns RESPONSE_TRY_AGAIN is asked
+// again when its connection is polled (see AsyncClient).
+// WebSockets are in-process only, see AsyncWebSocket::simConnect().
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../sim_hardware.h"
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+class AsyncWebSocket;
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void()> ArDisconnectHandler;
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+// Returned by a filler that has no data yet, AsyncTCP asks again later
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+typedef std::function<String(const String &)> AwsTemplateProcessor;
+
+class AsyncWebParameter
+{
+public:
+    AsyncWebParameter(const String &name, const String &value, bool form = false)
+        : parameterName(name), parameterValue(value), form(form) {}
+
+    const String &name() const { return parameterName; }
+    const String &value() const { return parameterValue; }
+    bool isPost() const { return form; }
+    bool isFile() const { return false; }
+
+private:
+    String parameterName;
+    String parameterValue;
+    bool form;
+};
+
+class AsyncWebHeader
+{
+public:
+    AsyncWebHeader(const String &name, const String &value) : headerName(name), headerValue(value) {}
+
+    const String &name() const { return headerName; }
+    const String &value() const { return headerValue; }
+
+private:
+    String headerName;
+    String headerValue;
+};
+
+/* Responses */
+
+class AsyncWebServerResponse
+{
+public:
+    AsyncWebServerResponse(int code, const String &contentType) : code(code), contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { this->code = code; }
+    void setContentType(const String &type) { contentType = type; }
+    void setContentLength(size_t length) {}
+    void addHeader(const String &name, const String &value) { headers.emplace_back(name, value); }
+
+    int simCode() const { return code; }
+    const String &simContentType() const { return contentType; }
+    const std::vector<AsyncWebHeader> &simHeaders() const { return headers; }
+
+    // Produce the complete body, as the AsyncTCP task would while sending
+    // on client
+    virtual std::string simBody(AsyncClient *client) = 0;
+
+protected:
+    int code;
+    String contentType;
+    std::vector<AsyncWebHeader> headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse
+{
+public:
+    AsyncBasicResponse(int code, const String &contentType, const String &content)
+        : AsyncWebServerResponse(code, contentType), content(content.c_str(), content.length()) {}
+
+    std::string simBody(AsyncClient *client) override { return content; }
+
+private:
+    std::string content;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+public:
+    AsyncResponseStream(const String &contentType, size_t bufferSize)
+        : AsyncWebServerResponse(200, contentType)
+    {
+        content.reserve(bufferSize);
+    }
+
+    size_t write(uint8_t c) override
+    {
+        content += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        content.append((const char *)data, length);
+        return length;
+    }
+    using Print::write;
+
+    std::string simBody(AsyncClient *client) override { return content; }
+
+private:
+    std::string content;
+};
+
+// Body produced by a filler callback, with a known length or chunked
+class AsyncCallbackResponse : public AsyncWebServerResponse
+{
+public:
+    AsyncCallbackResponse(const String &contentType, size_t length, AwsResponseFiller filler, bool chunked)
+        : AsyncWebServerResponse(200, contentType), length(length), filler(filler), chunked(chunked) {}
+
+    std::string simBody(AsyncClient *client) override;
+
+private:
+    size_t length;
+    AwsResponseFiller filler;
+    bool chunked;
+};
+
+/* Requests */
+
+class AsyncWebServerRequest
+{
+public:
+    AsyncWebServerRequest(WebRequestMethod method, const String &url,
+                          const std::vector<AsyncWebParameter> &parameters,
+                          const std::vector<AsyncWebHeader> &headers);
+    ~AsyncWebServerRequest();
+
+    WebRequestMethodComposite method() const { return requestMethod; }
+    const String &url() const { return requestUrl; }
+
+    size_t params() const { return parameters.size(); }
+    const AsyncWebParameter *getParam(size_t index) const { return index < parameters.size() ? &parameters[index] : nullptr; }
+    bool hasParam(const String &name, bool post = false, bool file = false) const { return getParam(name, post, file) != nullptr; }
+    const AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+
+    bool hasArg(const char *name) const;
+    const String &arg(const String &name) const;
+    const String &pathArg(size_t index) const;
+
+    size_t headers() const { return requestHeaders.size(); }
+    bool hasHeader(const String &name) const { return getHeader(name) != nullptr; }
+    const AsyncWebHeader *getHeader(const String &name) const;
+
+    void send(int code, const String &contentType = String(), const String &content = String());
+    void send(AsyncWebServerResponse *response);
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+    AsyncWebServerResponse *beginResponse(const String &contentType, size_t length, AwsResponseFiller filler,
+                                          AwsTemplateProcessor processor = nullptr);
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler,
+                                                 AwsTemplateProcessor processor = nullptr);
+    AsyncResponseStream *beginResponseStream(const String &contentType, size_t bufferSize = 1460);
+
+    void onDisconnect(ArDisconnectHandler handler) { disconnectHandler = handler; }
+    AsyncClient *client() { return &connection; }
+
+    // Simulation: path arguments captured by a regex route
+    void simSetPathArgs(const std::vector<String> &args) { pathArgs = args; }
+
+    // Simulation: wait until a response was sent, false on timeout
+    bool simWaitForResponse(uint32_t timeoutMs);
+
+    // Simulation: the client went away (after the response or on timeout)
+    void simDisconnect();
+
+    AsyncWebServerResponse *simResponse() { return response; }
+
+private:
+    WebRequestMethod requestMethod;
+    String requestUrl;
+    std::vector<AsyncWebParameter> parameters;
+    std::vector<AsyncWebHeader> requestHeaders;
+    std::vector<String> pathArgs;
+    ArDisconnectHandler disconnectHandler;
+    AsyncClient connection;
+
+    std::mutex responseMutex;
+    std::condition_variable responseSent;
+    AsyncWebServerResponse *response = nullptr;
+};
+
+/* Handlers */
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) { return false; }
+    virtual void handleRequest(AsyncWebServerRequest *request) {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncCallbackWebHandler(const String &uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+        : uri(uri), method(method), onRequest(onRequest) {}
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+private:
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+};
+
+/* WebSocket */
+
+typedef enum
+{
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+typedef enum
+{
+    WS_CONTINUATION,
+    WS_TEXT,
+    WS_BINARY,
+    WS_DISCONNECT = 0x08,
+    WS_PING,
+    WS_PONG
+} AwsFrameType;
+
+typedef struct
+{
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+// Messages a client may have queued before canSend() reports false
+#define WS_MAX_QUEUED_MESSAGES 32
+
+class AsyncWebSocketClient
+{
+public:
+    AsyncWebSocketClient(AsyncWebSocket *server, uint32_t id) : server(server), clientId(id) {}
+
+    uint32_t id() const { return clientId; }
+    AsyncWebSocket *getServer() { return server; }
+
+    void text(const char *message, size_t length);
+    void text(const char *message) { text(message, strlen(message)); }
+    void text(const String &message) { text(message.c_str(), message.length()); }
+    bool canSend();
+    // Simulated clients take every frame right away, nothing stays queued
+    size_t queueLen() { return 0; }
+    void close(uint16_t code = 0, const char *message = nullptr);
+
+    // Simulation: frames received by the client since the last call
+    std::vector<std::string> simTakeFrames();
+    bool simClosed();
+
+private:
+    AsyncWebSocket *server;
+    uint32_t clientId;
+    std::mutex mutex;
+    std::vector<std::string> frames;
+    bool closed = false;
+};
+
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                           void *arg, uint8_t *data, size_t length)>
+    AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler
+{
+public:
+    AsyncWebSocket(const String &url) : socketUrl(url) {}
+
+    const char *url() const { return socketUrl.c_str(); }
+    void onEvent(AwsEventHandler handler) { eventHandler = handler; }
+
+    size_t count();
+    AsyncWebSocketClient *client(uint32_t id);
+    void cleanupClients(uint16_t maxClients = 8) {}
+    bool availableForWriteAll();
+
+    void textAll(const char *message, size_t length);
+    void textAll(const char *message) { textAll(message, strlen(message)); }
+    void textAll(const String &message) { textAll(message.c_str(), message.length()); }
+
+    // Simulation: open a client, query as in "interval=250"
+    AsyncWebSocketClient *simConnect(const char *query = "");
+    void simReceive(AsyncWebSocketClient *client, const char *message);
+    void simDisconnect(AsyncWebSocketClient *client);
+
+private:
+    String socketUrl;
+    AwsEventHandler eventHandler;
+    std::mutex clientsMutex;
+    std::vector<std::unique_ptr<AsyncWebSocketClient>> clients;
+    uint32_t nextId = 1;
+};
+
+/* Server */
+
+// Response as seen by a client of the simulated server
+struct SimHttpResponse
+{
+    int code; // 0 if no response was sent before the timeout
+    std::string contentType;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    SimAllocations allocations; // made by the handler and while producing the body
+    bool closed;                // the connection was closed before the body was complete
+};
+
+class AsyncWebServer
+{
+public:
+    AsyncWebServer(uint16_t port) : port(port) {}
+
+    void begin();
+    void end() {}
+
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+    void onNotFound(ArRequestHandlerFunction handler) { notFoundHandler = handler; }
+
+    // Simulation: handle one request in-process. body holds the form
+    // parameters of a POST ("a=1&b=2"), url may carry a query string.
+    SimHttpResponse simRequest(const char *method, const char *url, const char *body = "",
+                               const std::vector<std::pair<String, String>> &headers = {},
+                               uint32_t timeoutMs = 65000);
+
+    // Simulation: the WebSocket registered for url, nullptr if none
+    AsyncWebSocket *simWebSocket(const char *url);
+
+private:
+    uint16_t port;
+    std::vector<AsyncWebHandler *> handlers;
+    std::vector<std::unique_ptr<AsyncCallbackWebHandler>> callbackHandlers;
+    ArRequestHandlerFunction notFoundHandler;
+
+    void listen();
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SIM_FS_H
+#define SIM_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs
+{
+
+// File on the host file system, closed when the last copy goes away
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(FILE *file)
+    {
+        if (file != nullptr)
+        {
+            this->file.reset(file, fclose);
+        }
+    }
+
+    explicit operator bool() const { return file != nullptr; }
+
+    size_t write(uint8_t c) override { return file ? fwrite(&c, 1, 1, file.get()) : 0; }
+    size_t write(const uint8_t *buffer, size_t size) override { return file ? fwrite(buffer, 1, size, file.get()) : 0; }
+    using Print::write;
+
+    int available() override
+    {
+        if (!file)
+        {
+            return 0;
+        }
+        long position = ftell(file.get());
+        fseek(file.get(), 0, SEEK_END);
+        long end = ftell(file.get());
+        fseek(file.get(), position, SEEK_SET);
+        return (int)(end - position);
+    }
+
+    int read() override { return file ? fgetc(file.get()) : -1; }
+    size_t read(uint8_t *buffer, size_t size) { return file ? fread(buffer, 1, size, file.get()) : 0; }
+
+    int peek() override
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            ungetc(c, file.get());
+        }
+        return c;
+    }
+
+    size_t size() const
+    {
+        if (!file)
+        {
+            return 0;
+        }
+        long position = ftell(file.get());
+        fseek(file.get(), 0, SEEK_END);
+        long end = ftell(file.get());
+        fseek(file.get(), position, SEEK_SET);
+        return end;
+    }
+
+    bool seek(uint32_t position) { return file && fseek(file.get(), position, SEEK_SET) == 0; }
+    size_t position() const { return file ? ftell(file.get()) : 0; }
+    void flush()
+    {
+        if (file)
+        {
+            fflush(file.get());
+        }
+    }
+    void close() { file.reset(); }
+
+private:
+    std::shared_ptr<FILE> file;
+};
+
+// File system rooted at a host directory
+class FS
+{
+public:
+    File open(const char *path, const char *mode = "r", bool create = false);
+    File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+// The part of the ESP32 HTTPClient the firmware uses: one blocking request
+// per begin()/end() over a plain TCP socket, http:// URLs only
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient
+{
+public:
+    bool begin(const String &url);
+    void end();
+
+    void setConnectTimeout(int32_t timeoutMs) { connectTimeoutMs = timeoutMs; }
+    void setTimeout(uint16_t timeoutMs) { this->timeoutMs = timeoutMs; }
+    void setReuse(bool reuse) {}
+    void addHeader(const String &name, const String &value);
+
+    // Status code of the response, or one of the HTTPC_ERROR_ codes
+    int POST(uint8_t *payload, size_t size);
+    int POST(const String &payload) { return POST((uint8_t *)payload.c_str(), payload.length()); }
+
+    static String errorToString(int error);
+
+private:
+    std::string host;
+    uint16_t port = 80;
+    std::string path;
+    std::vector<std::string> headers;
+    int32_t connectTimeoutMs = 5000;
+    uint16_t timeoutMs = 5000;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SIM_HX711_DRIVER_H
+#define SIM_HX711_DRIVER_H
+
+#include <Arduino.h>
+#include "../sim_hardware.h"
+
+// Same interface as the bogde HX711 library, reading from the simulated
+// load cell wired to the DOUT pin passed to begin()
+class HX711
+{
+public:
+    void begin(byte dout, byte pd_sck, byte gain = 128)
+    {
+        cell = &simLoadCell(dout);
+        set_gain(gain);
+    }
+
+    bool is_ready() { return cell != nullptr && cell->isReady(); }
+
+    void wait_ready(unsigned long delay_ms = 0)
+    {
+        while (!is_ready())
+        {
+            delay(delay_ms);
+        }
+    }
+
+    bool wait_ready_timeout(unsigned long timeout = 1000, unsigned long delay_ms = 0)
+    {
+        unsigned long start = millis();
+        while (millis() - start < timeout)
+        {
+            if (is_ready())
+            {
+                return true;
+            }
+            delay(delay_ms);
+        }
+        return false;
+    }
+
+    void set_gain(byte gain = 128) { this->gain = gain; }
+
+    // Both channels see the same bridge, the counts scale with the gain
+    long read() { return cell != nullptr ? cell->read() * gain / 128 : 0; }
+
+    long read_average(byte times = 10)
+    {
+        long sum = 0;
+        for (byte i = 0; i < times; i++)
+        {
+            sum += read();
+        }
+        return times > 0 ? sum / times : 0;
+    }
+
+    double get_value(byte times = 1) { return read_average(times) - offset; }
+    float get_units(byte times = 1) { return get_value(times) / scale; }
+
+    void tare(byte times = 10) { set_offset(read_average(times)); }
+
+    void set_scale(float scale = 1.f) { this->scale = scale; }
+    float get_scale() { return scale; }
+    void set_offset(long offset = 0) { this->offset = offset; }
+    long get_offset() { return offset; }
+
+    void power_down() {}
+    void power_up() {}
+
+private:
+    SimulatedHX711 *cell = nullptr;
+    byte gain = 128;
+    long offset = 0;
+    float scale = 1.f;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+class IPAddress : public Printable
+{
+public:
+    IPAddress() : octets{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return octets[index]; }
+
+    String toString() const
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buffer);
+    }
+
+    size_t printTo(Print &p) const override { return p.print(toString()); }
+
+private:
+    uint8_t octets[4];
+};
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum
+{
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_MAX = 255
+} arduino_event_id_t;
+
+typedef struct
+{
+    struct
+    {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+// Station that connects to a simulated access point (see simSetWiFi()).
+// Events are delivered from a separate thread, like the WiFi event task.
+class WiFiClass
+{
+public:
+    bool mode(wifi_mode_t mode) { return true; }
+    void setAutoReconnect(bool autoReconnect) {}
+    int onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+
+    wl_status_t begin(const String &ssid, const String &password);
+    bool reconnect();
+    bool disconnect(bool wifiOff = false);
+
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    IPAddress localIP();
+    int8_t RSSI() { return isConnected() ? -58 : 0; }
+    String SSID() { return ssid; }
+
+private:
+    String ssid;
+    IPAddress staticIP;
+    bool hasStaticIP = false;
+    std::vector<WiFiEventFuncCb> callbacks;
+
+    void associate();
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+#include <vector>
+
+// I2C bus, the only device on it is the simulated display (sim_hardware.h).
+// A transmission takes as long as its bytes would at the set clock.
+class TwoWire
+{
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0)
+    {
+        if (frequency != 0)
+        {
+            clock = frequency;
+        }
+        return true;
+    }
+    void setClock(uint32_t frequency) { clock = frequency; }
+    uint32_t getClock() { return clock; }
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t length);
+
+    // 0 on success, 2 if no device acknowledged the address
+    uint8_t endTransmission(bool sendStop = true);
+
+private:
+    uint32_t clock = 100000;
+    uint8_t address = 0;
+    std::vector<uint8_t> pending;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// The FreeRTOS calls the firmware makes, mapped onto std::thread and
+// std::mutex. One tick is one millisecond. Priorities and core affinity
+// are accepted and ignored, the host scheduler decides.
+
+#include <mutex>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+struct SimTask;
+typedef SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+struct SimSemaphore;
+typedef SimSemaphore *SemaphoreHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+/* Tasks */
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+BaseType_t xPortGetCoreID();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+/* Task notifications */
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+void xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+#define portYIELD_FROM_ISR(...)
+
+/* Critical sections */
+
+struct portMUX_TYPE
+{
+    std::recursive_mutex mutex;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED \
+    {                                \
+    }
+
+inline void taskENTER_CRITICAL(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void taskEXIT_CRITICAL(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE *mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE *mux) { mux->mutex.unlock(); }
+
+/* Semaphores, both kinds are recursive mutexes here */
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+#define xSemaphoreTakeRecursive xSemaphoreTake
+#define xSemaphoreGiveRecursive xSemaphoreGive
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SIM_LWIP_OPT_H
+#define SIM_LWIP_OPT_H
+
+// lwIP options the firmware sizes itself by, as in the Arduino core
+
+// TCP connections, CONFIG_LWIP_MAX_ACTIVE_TCP
+#define MEMP_NUM_TCP_PCB 16
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SIM_LWIP_TCP_PRIV_H
+#define SIM_LWIP_TCP_PRIV_H
+
+#include <lwip/tcp.h>
+
+// Open connections, owned by the tcpip thread
+extern struct tcp_pcb *tcp_active_pcbs;
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_LWIP_TCP_H
+#define SIM_LWIP_TCP_H
+
+// The parts of lwIP's TCP PCB the firmware uses, see sim/loopback_server.cpp
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_MEM -1
+
+struct tcp_pcb;
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *pcb);
+
+struct tcp_pcb
+{
+    struct tcp_pcb *next;
+    void *callback_arg; // the AsyncClient of the connection
+    tcp_poll_fn poll;
+};
+
+#endif
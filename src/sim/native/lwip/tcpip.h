@@ -0,0 +1,11 @@
+#ifndef SIM_LWIP_TCPIP_H
+#define SIM_LWIP_TCPIP_H
+
+#include <lwip/tcp.h>
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+// Runs function in the simulated tcpip thread
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+
+#endif
@@ -0,0 +1,302 @@
+// Entry point of [env:native]: runs the firmware's setup() and loop() on the
+// simulated board (sim_hardware.h). Without --request it keeps running and
+// serves HTTP on localhost until killed or --run expires. With --request the
+// steps run in order after boot, each response is printed, and the program
+// exits, which makes it usable from CI scripts.
+//
+//   pio run -e native && .pio/build/native/program [options]
+//     --port N             serve HTTP on 127.0.0.1:N, 0 = off (default 8080)
+//     --fs DIR             directory standing in for SPIFFS (default sim_spiffs)
+//     --sps 10|80          HX711 output rate (default 10)
+//     --trace PIN=FILE     replay raw readings on the cell whose DOUT is PIN
+//     --rate-pin PIN=GPIO  wire RATE of the cell whose DOUT is PIN to GPIO
+//     --uptime MS          start millis() at MS, e.g. 4294900000 to test its wrap
+//     --no-wifi            the access point never answers
+//     --request "M URL [FORM]"  e.g. "POST /tare/1 samples=5", repeatable
+//     --ws "URL[?QUERY]"   open the WebSocket, print its frames at exit
+//     --sleep MS           pause between steps
+//     --run SECONDS        exit after this long
+//     --display            print the OLED contents at exit
+//     --bench N            after the steps, time the hot routes N times each
+//     --bench-out FILE     where the benchmark JSON goes (default stdout)
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "request_bench.h"
+#include "sim_hardware.h"
+
+void setup();
+void loop();
+
+extern AsyncWebServer server; // Defined in main.cpp
+
+struct Step
+{
+    enum Kind
+    {
+        REQUEST,
+        WEBSOCKET,
+        SLEEP
+    } kind;
+    std::string argument;
+};
+
+struct OpenSocket
+{
+    std::string url;
+    AsyncWebSocketClient *client;
+};
+
+// Function Prototypes
+static void usage(const char *program);
+static bool runRequest(const std::string &line);
+static bool openSocket(const std::string &target, std::vector<OpenSocket> &sockets);
+static void printBody(const std::string &body);
+
+int main(int argc, char **argv)
+{
+    std::vector<Step> steps;
+    long runSeconds = -1;
+    bool printDisplay = false;
+    long benchIterations = 0;
+    const char *benchPath = "-";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = option != "--no-wifi" && option != "--display";
+        if (takesValue && value == nullptr)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (option == "--port")
+        {
+            simSetHttpPort(atoi(value));
+        }
+        else if (option == "--fs")
+        {
+            simSetFileSystemRoot(value);
+        }
+        else if (option == "--sps")
+        {
+            simSetSampleRate(atoi(value));
+        }
+        else if (option == "--trace")
+        {
+            const char *equals = strchr(value, '=');
+            if (equals == nullptr || !simLoadTrace(atoi(value), equals + 1))
+            {
+                fprintf(stderr, "Cannot load trace %s\n", value);
+                return 2;
+            }
+        }
+        else if (option == "--rate-pin")
+        {
+            const char *equals = strchr(value, '=');
+            if (equals == nullptr)
+            {
+                fprintf(stderr, "Invalid --rate-pin %s, expected PIN=GPIO\n", value);
+                return 2;
+            }
+            simConnectRatePin(atoi(equals + 1), atoi(value));
+        }
+        else if (option == "--temperature")
+        {
+            // START or START+PER_MINUTE, e.g. 40+0.5
+            char *end;
+            float celsius = strtof(value, &end);
+            simSetTemperature(celsius, *end == '+' || *end == '-' ? strtof(end, nullptr) : 0.0f);
+        }
+        else if (option == "--uptime")
+        {
+            simSetUptime(strtoul(value, nullptr, 10));
+        }
+        else if (option == "--no-wifi")
+        {
+            simSetWiFi(false, simWiFiConnectDelay());
+        }
+        else if (option == "--request")
+        {
+            steps.push_back({Step::REQUEST, value});
+        }
+        else if (option == "--ws")
+        {
+            steps.push_back({Step::WEBSOCKET, value});
+        }
+        else if (option == "--sleep")
+        {
+            steps.push_back({Step::SLEEP, value});
+        }
+        else if (option == "--run")
+        {
+            runSeconds = atol(value);
+        }
+        else if (option == "--display")
+        {
+            printDisplay = true;
+        }
+        else if (option == "--bench")
+        {
+            benchIterations = atol(value);
+            if (benchIterations < 1)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (option == "--bench-out")
+        {
+            benchPath = value;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        i += takesValue ? 1 : 0;
+    }
+
+    setup();
+
+    // loop() runs on its own thread, like the Arduino loop task
+    std::thread([]
+                {
+        for (;;)
+        {
+            loop();
+        } })
+        .detach();
+
+    bool ok = true;
+    std::vector<OpenSocket> sockets;
+    for (const Step &step : steps)
+    {
+        if (step.kind == Step::REQUEST)
+        {
+            ok = runRequest(step.argument) && ok;
+        }
+        else if (step.kind == Step::WEBSOCKET)
+        {
+            ok = openSocket(step.argument, sockets) && ok;
+        }
+        else
+        {
+            delay(atol(step.argument.c_str()));
+        }
+    }
+
+    if (runSeconds >= 0)
+    {
+        delay(runSeconds * 1000);
+    }
+    else if (steps.empty() && benchIterations == 0)
+    {
+        for (;;)
+        {
+            delay(1000);
+        }
+    }
+
+    for (const OpenSocket &socket : sockets)
+    {
+        printf("\n=== WS %s\n", socket.url.c_str());
+        for (const std::string &frame : socket.client->simTakeFrames())
+        {
+            printf("%s\n", frame.c_str());
+        }
+    }
+
+    if (printDisplay)
+    {
+        printf("\n=== Display (%llu bytes over I2C)\n%s", (unsigned long long)simPanelBytes(), simPanelText().c_str());
+    }
+    fflush(stdout);
+
+    if (benchIterations > 0)
+    {
+        ok = runRequestBench(server, benchIterations, benchPath) && ok;
+    }
+
+    // The firmware tasks never return, leave without unwinding them
+    _exit(ok ? 0 : 1);
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--port N] [--fs DIR] [--sps 10|80] [--trace PIN=FILE]\n"
+            "          [--rate-pin PIN=GPIO] [--temperature C[+PER_MINUTE]] [--uptime MS] [--no-wifi]\n"
+            "          [--request \"METHOD URL [FORM]\"] [--ws \"URL[?QUERY]\"] [--sleep MS]\n"
+            "          [--run SECONDS] [--display] [--bench N] [--bench-out FILE]\n",
+            program);
+}
+
+// Send "METHOD URL [FORM]" to the server and print the response,
+// false if no response came back
+static bool runRequest(const std::string &line)
+{
+    size_t methodEnd = line.find(' ');
+    if (methodEnd == std::string::npos)
+    {
+        fprintf(stderr, "Invalid request \"%s\"\n", line.c_str());
+        return false;
+    }
+    size_t urlEnd = line.find(' ', methodEnd + 1);
+    std::string method = line.substr(0, methodEnd);
+    std::string url = line.substr(methodEnd + 1, urlEnd == std::string::npos ? std::string::npos : urlEnd - methodEnd - 1);
+    std::string form = urlEnd == std::string::npos ? "" : line.substr(urlEnd + 1);
+
+    uint32_t start = millis();
+    SimHttpResponse response = server.simRequest(method.c_str(), url.c_str(), form.c_str());
+    printf("\n=== %s %s -> %d %s (%lu ms)\n", method.c_str(), url.c_str(), response.code,
+           response.contentType.c_str(), (unsigned long)(millis() - start));
+    for (const auto &header : response.headers)
+    {
+        printf("%s: %s\n", header.first.c_str(), header.second.c_str());
+    }
+    printBody(response.body);
+    if (response.closed)
+    {
+        printf("(connection closed after %zu bytes)\n", response.body.size());
+    }
+    fflush(stdout);
+
+    return response.code != 0;
+}
+
+static bool openSocket(const std::string &target, std::vector<OpenSocket> &sockets)
+{
+    size_t queryStart = target.find('?');
+    std::string url = target.substr(0, queryStart);
+    AsyncWebSocket *socket = server.simWebSocket(url.c_str());
+    if (socket == nullptr)
+    {
+        fprintf(stderr, "No WebSocket at %s\n", url.c_str());
+        return false;
+    }
+
+    std::string query = queryStart == std::string::npos ? "" : target.substr(queryStart + 1);
+    sockets.push_back({target, socket->simConnect(query.c_str())});
+    return true;
+}
+
+// Text bodies as they are, binary ones (e.g. /capture) as a size
+static void printBody(const std::string &body)
+{
+    for (unsigned char c : body)
+    {
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t')
+        {
+            printf("<%zu bytes of binary data>\n", body.size());
+            return;
+        }
+    }
+    printf("%s\n", body.c_str());
+}
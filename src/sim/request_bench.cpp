@@ -0,0 +1,102 @@
+// Host side of the benchmark suite, see request_bench.h and src/bench.h
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "request_bench.h"
+
+// The hot routes and the error path. GET / only sends a constant and
+// shows the cost of the simulated server itself.
+static const char *const benchRequests[] = {
+    "GET /",
+    "GET /weight",
+    "GET /weight/1",
+    "GET /weight?ids=1,3&fields=weight,stable,raw,timestamp",
+    "GET /weight/99",
+    "GET /calibration_factor",
+    "GET /calibration_factor/1",
+    "GET /filter/1",
+    "GET /boot",
+    "GET /metrics",
+};
+
+// Function Prototypes
+static void benchRequest(AsyncWebServer &server, const std::string &line, uint32_t iterations, FILE *out);
+static uint64_t nowNs();
+
+bool runRequestBench(AsyncWebServer &server, uint32_t iterations, const char *path)
+{
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == nullptr)
+    {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    // Starts the samples/s window of the firmware benchmarks, so it covers
+    // the request benchmarks below rather than boot and tare
+    server.simRequest("GET", "/bench?iterations=1");
+
+    fprintf(out, "{\"iterations\":%lu,\"requests\":[", (unsigned long)iterations);
+    for (size_t i = 0; i < sizeof(benchRequests) / sizeof(benchRequests[0]); ++i)
+    {
+        fprintf(out, i == 0 ? "\n" : ",\n");
+        benchRequest(server, benchRequests[i], iterations, out);
+    }
+
+    std::string url = "/bench?iterations=" + std::to_string(iterations);
+    SimHttpResponse firmware = server.simRequest("GET", url.c_str());
+    fprintf(out, "\n],\n\"firmware\":%s}\n", firmware.code == 200 ? firmware.body.c_str() : "null");
+
+    bool ok = firmware.code == 200 && !ferror(out);
+    if (out != stdout)
+    {
+        ok = fclose(out) == 0 && ok;
+    }
+    else
+    {
+        fflush(out);
+    }
+    return ok;
+}
+
+// Send "METHOD URL" iterations times and write one result object
+static void benchRequest(AsyncWebServer &server, const std::string &line, uint32_t iterations, FILE *out)
+{
+    size_t methodEnd = line.find(' ');
+    std::string method = line.substr(0, methodEnd);
+    std::string url = line.substr(methodEnd + 1);
+
+    std::vector<uint64_t> durations;
+    durations.reserve(iterations);
+    SimHttpResponse response;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        uint64_t start = nowNs();
+        response = server.simRequest(method.c_str(), url.c_str());
+        durations.push_back(nowNs() - start);
+        allocations += response.allocations.count;
+        allocatedBytes += response.allocations.bytes;
+    }
+
+    std::sort(durations.begin(), durations.end());
+    fprintf(out,
+            "{\"name\":\"%s\",\"status\":%d,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,"
+            "\"bytes\":%zu,\"allocations\":%.1f,\"heap_bytes\":%.0f}",
+            line.c_str(), response.code,
+            (unsigned long long)durations[iterations * 50 / 100],
+            (unsigned long long)durations[iterations * 90 / 100],
+            (unsigned long long)durations[iterations * 99 / 100],
+            (unsigned long long)durations[iterations - 1],
+            response.body.size(), (double)allocations / iterations, (double)allocatedBytes / iterations);
+}
+
+static uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
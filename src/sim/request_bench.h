@@ -0,0 +1,12 @@
+#ifndef REQUEST_BENCH_H
+#define REQUEST_BENCH_H
+
+#include <ESPAsyncWebServer.h>
+
+// Time every benchmarked route through AsyncWebServer::simRequest() and
+// write the results as JSON to path ("-" for stdout): latency percentiles
+// in ns, status, body size and heap allocated per request. The firmware's
+// own GET /bench results are included under "firmware".
+bool runRequestBench(AsyncWebServer &server, uint32_t iterations, const char *path);
+
+#endif
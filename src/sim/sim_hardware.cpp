@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "sim_hardware.h"
+
+// Synthetic signal of a cell without a trace: empty plate, some noise
+#define SIM_DEFAULT_RAW 8400000
+#define SIM_DEFAULT_NOISE 40
+
+static std::mutex loadCellsMutex;
+static std::map<int, std::unique_ptr<SimulatedHX711>> loadCells;
+static uint32_t samplePeriodUs = 100000;
+static std::map<int, int> ratePins; // GPIO -> DOUT of the cell whose RATE it drives
+
+static float temperature = 45.0f;
+static float temperaturePerMinute = 0.0f;
+
+static std::string fileSystemRoot = "sim_spiffs";
+static bool wifiAvailable = true;
+static uint32_t wifiConnectDelayMs = 300;
+static uint16_t httpPort = 8080;
+
+SimulatedHX711 &simLoadCell(int doutPin)
+{
+    std::lock_guard<std::mutex> lock(loadCellsMutex);
+
+    std::unique_ptr<SimulatedHX711> &cell = loadCells[doutPin];
+    if (!cell)
+    {
+        // Spread the conversions so the cells are not in lockstep
+        uint32_t phaseUs = (loadCells.size() - 1) * samplePeriodUs / 4 % samplePeriodUs;
+        cell.reset(new SimulatedHX711(samplePeriodUs, phaseUs));
+        cell->setSynthetic(SIM_DEFAULT_RAW, SIM_DEFAULT_NOISE);
+    }
+    return *cell;
+}
+
+void simSetSampleRate(uint32_t samplesPerSecond)
+{
+    samplePeriodUs = 1000000 / (samplesPerSecond > 0 ? samplesPerSecond : 10);
+}
+
+void simConnectRatePin(int ratePin, int doutPin)
+{
+    std::lock_guard<std::mutex> lock(loadCellsMutex);
+    ratePins[ratePin] = doutPin;
+}
+
+void simWritePin(int pin, int value)
+{
+    int doutPin;
+    {
+        std::lock_guard<std::mutex> lock(loadCellsMutex);
+        auto wire = ratePins.find(pin);
+        if (wire == ratePins.end())
+        {
+            return;
+        }
+        doutPin = wire->second;
+    }
+    simLoadCell(doutPin).setPeriod(value ? 12500 : 100000);
+}
+
+bool simLoadTrace(int doutPin, const char *path)
+{
+    return simLoadCell(doutPin).loadTrace(path);
+}
+
+void simSetTemperature(float celsius, float perMinute)
+{
+    temperature = celsius;
+    temperaturePerMinute = perMinute;
+}
+
+float simTemperature()
+{
+    return temperature + temperaturePerMinute * micros() / 60000000.0f;
+}
+
+void simSetFileSystemRoot(const char *path)
+{
+    fileSystemRoot = path;
+}
+
+const char *simFileSystemRoot()
+{
+    return fileSystemRoot.c_str();
+}
+
+void simSetWiFi(bool available, uint32_t connectDelayMs)
+{
+    wifiAvailable = available;
+    wifiConnectDelayMs = connectDelayMs;
+}
+
+bool simWiFiAvailable()
+{
+    return wifiAvailable;
+}
+
+uint32_t simWiFiConnectDelay()
+{
+    return wifiConnectDelayMs;
+}
+
+void simSetHttpPort(uint16_t port)
+{
+    httpPort = port;
+}
+
+uint16_t simHttpPort()
+{
+    return httpPort;
+}
@@ -0,0 +1,71 @@
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "sim_hx711.h"
+
+// Simulated board for [env:native]. native_main.cpp configures it from the
+// command line before setup() runs; the library stand-ins in sim/native/
+// look up their simulated device here.
+
+// Load cell behind the HX711 whose DOUT is on doutPin. Created on first use
+// with a synthetic signal at the configured sample rate.
+SimulatedHX711 &simLoadCell(int doutPin);
+
+// HX711 output rate for cells created from now on, 10 or 80 SPS
+void simSetSampleRate(uint32_t samplesPerSecond);
+
+// Wire the HX711 RATE input of the cell at doutPin to a GPIO. Writing the
+// GPIO high switches that cell to 80 SPS, low to 10 SPS.
+void simConnectRatePin(int ratePin, int doutPin);
+
+// Called by digitalWrite()
+void simWritePin(int pin, int value);
+
+// Replay a text file with one raw reading per line on the cell at doutPin
+bool simLoadTrace(int doutPin, const char *path);
+
+// Value of millis() at the start of the program, e.g. 4294900000 to see it
+// wrap after about a minute
+void simSetUptime(uint32_t ms);
+
+// ESP32 die temperature returned by temperatureRead(), changing by
+// perMinute from the start of the program
+void simSetTemperature(float celsius, float perMinute);
+float simTemperature();
+
+// Directory that stands in for the SPIFFS partition
+void simSetFileSystemRoot(const char *path);
+const char *simFileSystemRoot();
+
+// Whether the access point answers, and how long association takes
+void simSetWiFi(bool available, uint32_t connectDelayMs);
+bool simWiFiAvailable();
+uint32_t simWiFiConnectDelay();
+
+// Localhost port the HTTP server listens on, 0 for in-process requests only
+void simSetHttpPort(uint16_t port);
+uint16_t simHttpPort();
+
+// What the OLED shows, one line per page. Text is read back from the
+// pixels received over I2C (see sim/native/Adafruit_GFX.h).
+std::string simPanelText();
+
+// Bytes sent to the OLED over I2C so far, address bytes included
+uint64_t simPanelBytes();
+
+// Heap allocations through operator new made by one thread, see
+// simStartAllocationCount()
+struct SimAllocations
+{
+    uint32_t count;
+    size_t bytes;
+};
+
+// Count the allocations of the calling thread until simStopAllocationCount()
+void simStartAllocationCount();
+SimAllocations simStopAllocationCount();
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef SIM_HX711_H
+#define SIM_HX711_H
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "../acquisition.h"
+
+// Host-side stand-in for an HX711. Conversions complete every periodUs
+// (10 SPS = 100000, 80 SPS = 12500), shifted by phaseUs so several cells are
+// not in lockstep. DOUT is "low" from the end of a conversion until it is
+// clocked out, and read() busy-waits for the readout time of the real chip.
+// Values are replayed from a trace, or a constant plus pseudo-random noise.
+class SimulatedHX711 : public LoadCellSource
+{
+public:
+    SimulatedHX711(uint32_t periodUs, uint32_t phaseUs = 0, uint32_t readoutUs = 60)
+        : periodUs(periodUs), phaseUs(phaseUs), readoutUs(readoutUs), lastReadConversion(-1),
+          base(0), noise(0), seed(12345), traceIndex(0)
+    {
+        epoch = std::chrono::steady_clock::now();
+    }
+
+    // Replay recorded raw values in a loop
+    void setTrace(const std::vector<long> &values)
+    {
+        trace = values;
+        traceIndex = 0;
+    }
+
+    // Replay a text file with one raw value per line, e.g. from
+    // utils/capture_decode.py. Returns false if it has no values.
+    bool loadTrace(const char *path)
+    {
+        FILE *file = fopen(path, "r");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        std::vector<long> values;
+        long raw;
+        while (fscanf(file, "%ld", &raw) == 1)
+        {
+            values.push_back(raw);
+        }
+        fclose(file);
+
+        if (values.empty())
+        {
+            return false;
+        }
+        setTrace(values);
+        return true;
+    }
+
+    // Constant raw value with uniform noise of +/- noise counts
+    void setSynthetic(long base, long noise)
+    {
+        this->base = base;
+        this->noise = noise;
+        trace.clear();
+    }
+
+    // Follow the RATE pin: the running conversion is abandoned and the
+    // first one at the new rate completes a full period later
+    void setPeriod(uint32_t periodUs)
+    {
+        this->periodUs = periodUs;
+        phaseUs = 0;
+        lastReadConversion = -1;
+        epoch = std::chrono::steady_clock::now();
+    }
+
+    bool isReady() override
+    {
+        int64_t conversion = completedConversions();
+        return conversion >= 0 && conversion != lastReadConversion;
+    }
+
+    long read() override
+    {
+        while (!isReady())
+        {
+        }
+        lastReadConversion = completedConversions();
+
+        // 25 clock pulses take some tens of microseconds on the real chip
+        int64_t until = elapsedUs() + readoutUs;
+        while (elapsedUs() < until)
+        {
+        }
+
+        return nextValue();
+    }
+
+private:
+    uint32_t periodUs;
+    uint32_t phaseUs;
+    uint32_t readoutUs;
+    int64_t lastReadConversion;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::vector<long> trace;
+    long base;
+    long noise;
+    uint32_t seed;
+    size_t traceIndex;
+
+    int64_t elapsedUs() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // Index of the most recently completed conversion, -1 before the first one
+    int64_t completedConversions() const
+    {
+        int64_t t = elapsedUs() - phaseUs;
+        return t < (int64_t)periodUs ? -1 : t / periodUs - 1;
+    }
+
+    long nextValue()
+    {
+        if (!trace.empty())
+        {
+            long value = trace[traceIndex];
+            traceIndex = (traceIndex + 1) % trace.size();
+            return value;
+        }
+        if (noise == 0)
+        {
+            return base;
+        }
+        seed = seed * 1664525u + 1013904223u;
+        return base + (long)(seed >> 8) % (2 * noise + 1) - noise;
+    }
+};
+
+#endif
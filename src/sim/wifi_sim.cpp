@@ -0,0 +1,89 @@
+// Host implementation of sim/native/WiFi.h
+
+#include <WiFi.h>
+#include <atomic>
+#include <thread>
+#include "sim_hardware.h"
+
+WiFiClass WiFi;
+
+// Bumped on every begin/reconnect/disconnect so stale attempts are dropped
+static std::atomic<uint32_t> attempt(0);
+static std::atomic<bool> connected(false);
+
+int WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event)
+{
+    callbacks.push_back(callback);
+    return callbacks.size();
+}
+
+bool WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet)
+{
+    staticIP = localIP;
+    hasStaticIP = true;
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const String &ssid, const String &password)
+{
+    this->ssid = ssid;
+    associate();
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::reconnect()
+{
+    associate();
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    attempt++;
+    connected = false;
+    return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+    return connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    if (!connected)
+    {
+        return IPAddress();
+    }
+    return hasStaticIP ? staticIP : IPAddress(127, 0, 0, 1);
+}
+
+// Report the outcome of an association attempt after the configured delay
+void WiFiClass::associate()
+{
+    uint32_t id = ++attempt;
+    connected = false;
+
+    std::thread([this, id]()
+                {
+        delay(simWiFiConnectDelay());
+        if (attempt != id)
+        {
+            return;
+        }
+
+        arduino_event_info_t info = {};
+        arduino_event_id_t event = ARDUINO_EVENT_WIFI_STA_GOT_IP;
+        if (!simWiFiAvailable())
+        {
+            info.wifi_sta_disconnected.reason = 201; // no AP found
+            event = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+        }
+        connected = event == ARDUINO_EVENT_WIFI_STA_GOT_IP;
+
+        for (const WiFiEventFuncCb &callback : callbacks)
+        {
+            callback(event, info);
+        } })
+        .detach();
+}
@@ -0,0 +1,141 @@
+// Host implementation of sim/native/Wire.h, with the SH1106 OLED on the bus
+
+#include <Wire.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "sim_hardware.h"
+
+#define SIM_PANEL_ADDRESS 0x3C
+#define SIM_PANEL_PAGES 8
+#define SIM_PANEL_COLUMNS 132 // RAM of the SH1106, the glass shows columns 2-129
+#define SIM_PANEL_FIRST_COLUMN 2
+
+TwoWire Wire;
+
+// Display RAM and the address pointer, as set by the commands received
+static std::mutex panelMutex;
+static uint8_t panelRam[SIM_PANEL_PAGES][SIM_PANEL_COLUMNS];
+static int panelPage = 0;
+static int panelColumn = 0;
+static uint64_t panelBytes = 0;
+
+// Function Prototypes
+static void panelCommand(uint8_t command);
+static char decodeCell(const uint8_t *columns);
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    this->address = address;
+    pending.clear();
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    pending.push_back(data);
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length)
+{
+    pending.insert(pending.end(), data, data + length);
+    return length;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    // Address and data bytes, 9 clocks each with the acknowledge bit
+    std::this_thread::sleep_for(std::chrono::microseconds((pending.size() + 1) * 9 * 1000000ULL / clock));
+    if (address != SIM_PANEL_ADDRESS)
+    {
+        return 2;
+    }
+
+    std::lock_guard<std::mutex> lock(panelMutex);
+    panelBytes += pending.size() + 1;
+    if (pending.empty())
+    {
+        return 0;
+    }
+
+    // The control byte says whether commands (0x00) or display data (0x40) follow
+    for (size_t i = 1; i < pending.size(); ++i)
+    {
+        if (pending[0] == 0x40)
+        {
+            if (panelColumn < SIM_PANEL_COLUMNS)
+            {
+                panelRam[panelPage][panelColumn++] = pending[i];
+            }
+        }
+        else
+        {
+            panelCommand(pending[i]);
+        }
+    }
+    return 0;
+}
+
+// Page and column address commands, the rest only configures the panel
+static void panelCommand(uint8_t command)
+{
+    if (command >= 0xB0 && command < 0xB0 + SIM_PANEL_PAGES)
+    {
+        panelPage = command - 0xB0;
+    }
+    else if (command <= 0x0F)
+    {
+        panelColumn = (panelColumn & 0xF0) | command;
+    }
+    else if (command <= 0x1F)
+    {
+        panelColumn = (panelColumn & 0x0F) | ((command & 0x0F) << 4);
+    }
+}
+
+std::string simPanelText()
+{
+    std::lock_guard<std::mutex> lock(panelMutex);
+
+    std::string text;
+    for (int page = 0; page < SIM_PANEL_PAGES; ++page)
+    {
+        std::string line;
+        for (int x = SIM_PANEL_FIRST_COLUMN; x + 6 <= SIM_PANEL_FIRST_COLUMN + 128; x += 6)
+        {
+            line += decodeCell(&panelRam[page][x]);
+        }
+        size_t end = line.find_last_not_of(' ');
+        text += end == std::string::npos ? "" : line.substr(0, end + 1);
+        text += '\n';
+    }
+    return text;
+}
+
+uint64_t simPanelBytes()
+{
+    std::lock_guard<std::mutex> lock(panelMutex);
+    return panelBytes;
+}
+
+// A 6x8 text cell: a glyph of the simulated Adafruit_GFX, blank, or
+// graphics ('#' if the middle column is mostly lit, '-' otherwise)
+static char decodeCell(const uint8_t *columns)
+{
+    bool blank = true;
+    for (int i = 0; i < 6; ++i)
+    {
+        blank = blank && columns[i] == 0;
+    }
+    if (blank)
+    {
+        return ' ';
+    }
+
+    if ((columns[0] | columns[1]) == 0x7F && (columns[0] & columns[1]) == 0 && columns[2] == 0 && columns[3] == 0 &&
+        columns[4] == 0 && columns[5] == 0)
+    {
+        return (char)columns[0];
+    }
+    return __builtin_popcount(columns[3]) >= 4 ? '#' : '-';
+}
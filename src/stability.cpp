@@ -0,0 +1,59 @@
+#include "stability.h"
+
+StabilityDetector::StabilityDetector()
+{
+    reset();
+}
+
+void StabilityDetector::reset()
+{
+    head = 0;
+    count = 0;
+    quiet = false;
+    quietSince = 0;
+    stable = false;
+}
+
+bool StabilityDetector::update(float weight, uint32_t nowMs)
+{
+    values[head] = weight;
+    head = (head + 1) % STABILITY_WINDOW;
+    if (count < STABILITY_WINDOW)
+    {
+        count++;
+    }
+
+    if (count < STABILITY_WINDOW)
+    {
+        stable = false;
+        return stable;
+    }
+
+    // Variance over the window, recomputed since the window is short
+    float mean = 0;
+    for (uint8_t i = 0; i < STABILITY_WINDOW; ++i)
+    {
+        mean += values[i];
+    }
+    mean /= STABILITY_WINDOW;
+
+    float variance = 0;
+    for (uint8_t i = 0; i < STABILITY_WINDOW; ++i)
+    {
+        variance += (values[i] - mean) * (values[i] - mean);
+    }
+    variance /= STABILITY_WINDOW;
+
+    if (variance > STABILITY_MAX_STDDEV * STABILITY_MAX_STDDEV)
+    {
+        quiet = false;
+    }
+    else if (!quiet)
+    {
+        quiet = true;
+        quietSince = nowMs;
+    }
+
+    stable = quiet && nowMs - quietSince >= STABILITY_HOLD_MS;
+    return stable;
+}
@@ -0,0 +1,34 @@
+#ifndef STABILITY_H
+#define STABILITY_H
+
+#include <stdint.h>
+
+// Samples in the sliding window
+#define STABILITY_WINDOW 8
+
+// A cell is stable once the standard deviation over the window stayed below
+// STABILITY_MAX_STDDEV grams for STABILITY_HOLD_MS
+#define STABILITY_MAX_STDDEV 0.2f
+#define STABILITY_HOLD_MS 300
+
+// Detects when a cell has settled, e.g. after the robot dipped a glass
+class StabilityDetector
+{
+public:
+    StabilityDetector();
+    void reset();
+
+    // Feed a new weight in grams, returns true while the cell is stable
+    bool update(float weight, uint32_t nowMs);
+    bool isStable() const { return stable; }
+
+private:
+    float values[STABILITY_WINDOW];
+    uint8_t head;
+    uint8_t count;
+    bool quiet;        // variance currently below the threshold
+    uint32_t quietSince;
+    bool stable;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <lwip/priv/tcp_priv.h>
+#include <lwip/tcpip.h>
+#include <string.h>
+#include "cores.h"
+#include "metrics.h"
+#include "responses.h"
+#include "sampler.h"
+#include "stable_wait.h"
+
+// A request parked until its cell is stable or the timeout expires. The
+// response was started when the request was parked, AsyncTCP asks its
+// filler for the body until the task has formatted it.
+struct StableWaiter
+{
+    AsyncWebServerRequest *request; // nullptr marks a free slot
+    int index;
+    uint32_t startMs;
+    uint32_t timeoutMs;
+    AsyncClient *client; // connection of the request and its lwIP PCB
+    tcp_pcb *pcb;
+    bool ready; // body formatted, for AsyncTCP to send
+    char body[STABLE_WAIT_BODY_SIZE];
+    size_t length;
+    size_t sent;
+};
+
+// Connection to poll in the tcpip thread
+struct PollRequest
+{
+    tcp_pcb *pcb;
+    void *arg;
+};
+
+static StableWaiter waiters[STABLE_WAIT_MAX_REQUESTS];
+
+// The task formats bodies and the AsyncTCP callbacks send them, each under this
+static SemaphoreHandle_t waitersMutex = nullptr;
+
+// Function Prototypes
+static void stableWaitTask(void *parameter);
+static size_t fillStableWaiter(int slot, AsyncWebServerRequest *request, uint8_t *buffer, size_t maxLen);
+static void wakeConnection(const StableWaiter &waiter);
+static void pollConnection(void *context);
+
+void startStableWaiters()
+{
+    waitersMutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(stableWaitTask, "stable_wait", 4096, nullptr, NETWORK_TASK_PRIORITY, nullptr, NETWORK_CORE);
+}
+
+// Park a request and start its chunked response, returns false if all slots
+// are taken. Runs in the route handler, on the AsyncTCP task.
+bool addStableWaiter(AsyncWebServerRequest *request, int index, uint32_t timeoutMs)
+{
+    int slot = -1;
+
+    xSemaphoreTake(waitersMutex, portMAX_DELAY);
+    for (int i = 0; i < STABLE_WAIT_MAX_REQUESTS && slot < 0; ++i)
+    {
+        if (waiters[i].request == nullptr)
+        {
+            StableWaiter &waiter = waiters[i];
+            waiter.request = request;
+            waiter.index = index;
+            waiter.startMs = millis();
+            waiter.timeoutMs = timeoutMs;
+            waiter.client = request->client();
+            waiter.pcb = waiter.client->pcb();
+            waiter.ready = false;
+            waiter.length = 0;
+            waiter.sent = 0;
+            slot = i;
+        }
+    }
+    xSemaphoreGive(waitersMutex);
+
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    // Drop the slot if the client goes away before the body was sent
+    request->onDisconnect([slot, request]()
+                          {
+        xSemaphoreTake(waitersMutex, portMAX_DELAY);
+        if (waiters[slot].request == request)
+        {
+            waiters[slot].request = nullptr;
+        }
+        xSemaphoreGive(waitersMutex); });
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [slot, request](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                                     { return fillStableWaiter(slot, request, buffer, maxLen); });
+    request->send(response);
+    countResponse(200);
+    return true;
+}
+
+// Format the answer of parked requests as soon as their cell settles or they
+// time out. Only AsyncTCP touches the requests, the task wakes their
+// connection so the body goes out without waiting for the next poll.
+static void stableWaitTask(void *parameter)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(STABLE_WAIT_TICK_MS));
+
+        xSemaphoreTake(waitersMutex, portMAX_DELAY);
+        for (int i = 0; i < STABLE_WAIT_MAX_REQUESTS; ++i)
+        {
+            StableWaiter &waiter = waiters[i];
+            if (waiter.request == nullptr || waiter.ready)
+            {
+                continue;
+            }
+
+            LoadCellReading reading = getLatestReading(waiter.index);
+            uint32_t now = millis();
+            if ((reading.connected && reading.stable) || now - waiter.startMs >= waiter.timeoutMs)
+            {
+                waiter.length = formatStableWait(waiter.body, sizeof(waiter.body), waiter.index + 1, reading, now - waiter.startMs);
+                waiter.ready = true;
+                wakeConnection(waiter);
+            }
+        }
+        xSemaphoreGive(waitersMutex);
+    }
+}
+
+// Chunked response filler, called by AsyncTCP. Asks again until the body
+// is formatted, then sends it and frees the slot.
+static size_t fillStableWaiter(int slot, AsyncWebServerRequest *request, uint8_t *buffer, size_t maxLen)
+{
+    size_t written = 0;
+
+    xSemaphoreTake(waitersMutex, portMAX_DELAY);
+    StableWaiter &waiter = waiters[slot];
+    if (waiter.request != request)
+    {
+        written = 0; // already sent
+    }
+    else if (!waiter.ready)
+    {
+        written = RESPONSE_TRY_AGAIN;
+    }
+    else
+    {
+        written = min(maxLen, waiter.length - waiter.sent);
+        memcpy(buffer, waiter.body + waiter.sent, written);
+        waiter.sent += written;
+        if (written == 0)
+        {
+            waiter.request = nullptr;
+        }
+    }
+    xSemaphoreGive(waitersMutex);
+
+    return written;
+}
+
+/* Connection Wake-up */
+
+// AsyncTCP retries a filler that asked to try again when lwIP next polls
+// the connection, every 500 ms. Polling it right away has to happen in the
+// tcpip thread, which owns the PCBs.
+static void wakeConnection(const StableWaiter &waiter)
+{
+    PollRequest *poll = new PollRequest{waiter.pcb, waiter.client};
+    if (tcpip_callback(pollConnection, poll) != ERR_OK)
+    {
+        delete poll; // the regular poll sends it
+    }
+}
+
+// Runs in the tcpip thread. The PCB is only polled while it is still open
+// and still belongs to the AsyncClient of the request, AsyncTCP then hands
+// the poll to its own task like a regular one.
+static void pollConnection(void *context)
+{
+    PollRequest *poll = (PollRequest *)context;
+    for (tcp_pcb *pcb = tcp_active_pcbs; pcb != nullptr; pcb = pcb->next)
+    {
+        if (pcb == poll->pcb && pcb->callback_arg == poll->arg && pcb->poll != nullptr)
+        {
+            pcb->poll(pcb->callback_arg, pcb);
+            break;
+        }
+    }
+    delete poll;
+}
@@ -0,0 +1,26 @@
+#ifndef STABLE_WAIT_H
+#define STABLE_WAIT_H
+
+#include <ESPAsyncWebServer.h>
+
+// Requests that can wait for a stable reading at the same time
+#define STABLE_WAIT_MAX_REQUESTS 8
+
+// Default and upper bound of the ?timeout= parameter
+#define STABLE_WAIT_DEFAULT_TIMEOUT_MS 10000
+#define STABLE_WAIT_MAX_TIMEOUT_MS 60000
+
+// How often pending requests are checked
+#define STABLE_WAIT_TICK_MS 10
+
+// Body of one answer, {"id", "stable", "weight", "waited_ms"}
+#define STABLE_WAIT_BODY_SIZE 128
+
+void startStableWaiters();
+
+// Park a request, returns false if all slots are taken. Called by the route
+// handler. The 200 response starts right away, its body is sent by AsyncTCP
+// once the stable_wait task formatted it; the task never touches the request.
+bool addStableWaiter(AsyncWebServerRequest *request, int index, uint32_t timeoutMs);
+
+#endif
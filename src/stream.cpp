@@ -0,0 +1,196 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include "cell_config.h"
+#include "cores.h"
+#include "responses.h"
+#include "sampler.h"
+#include "stream.h"
+
+// External Variables
+extern CellConfig cellConfig; // Defined in main.cpp
+
+// Per-client stream settings
+struct StreamSubscriber
+{
+    AsyncWebSocketClient *client; // nullptr marks a free slot
+    uint32_t intervalMs;
+    uint32_t lastSentMs;
+};
+
+static AsyncWebSocket weightSocket("/weight/stream");
+static StreamSubscriber subscribers[STREAM_MAX_CLIENTS];
+
+// Clients only enter and leave the table in socket events, which AsyncTCP
+// delivers before it frees a client. The stream task holds this while it
+// sends, so a disconnect waits for the send instead of freeing the client
+// under it, and the task never looks clients up in the socket's own list.
+static SemaphoreHandle_t subscribersMutex = nullptr;
+
+// Function Prototypes
+static void onStreamEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+static void streamTask(void *parameter);
+static size_t buildFrame(char *frame, size_t size, uint32_t now);
+static bool addSubscriber(AsyncWebSocketClient *client, uint32_t intervalMs);
+static void removeSubscriber(AsyncWebSocketClient *client);
+static void setSubscriberInterval(AsyncWebSocketClient *client, uint32_t intervalMs);
+static uint32_t clampInterval(long intervalMs);
+
+// Register the WebSocket endpoint and start the task that pushes frames
+void setupWeightStream(AsyncWebServer &server)
+{
+    subscribersMutex = xSemaphoreCreateMutex();
+    weightSocket.onEvent(onStreamEvent);
+    server.addHandler(&weightSocket);
+
+    xTaskCreatePinnedToCore(streamTask, "stream", 4096, nullptr, NETWORK_TASK_PRIORITY, nullptr, NETWORK_CORE);
+}
+
+// Track clients and their chosen interval. The interval is set with
+// ?interval=<ms> on connect, or later by sending {"interval": <ms>}.
+static void onStreamEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+    if (type == WS_EVT_CONNECT)
+    {
+        AsyncWebServerRequest *request = (AsyncWebServerRequest *)arg;
+        uint32_t intervalMs = STREAM_DEFAULT_INTERVAL_MS;
+        if (request != nullptr && request->hasParam("interval"))
+        {
+            intervalMs = clampInterval(request->getParam("interval")->value().toInt());
+        }
+
+        if (!addSubscriber(client, intervalMs))
+        {
+            client->text("{\"error\": \"Too many stream clients\"}");
+            client->close();
+        }
+    }
+    else if (type == WS_EVT_DISCONNECT)
+    {
+        removeSubscriber(client);
+    }
+    else if (type == WS_EVT_DATA)
+    {
+        // Only single-frame text messages are expected
+        AwsFrameInfo *info = (AwsFrameInfo *)arg;
+        if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT)
+        {
+            return;
+        }
+
+        JsonDocument jsonDoc;
+        if (deserializeJson(jsonDoc, (const char *)data, len) || !jsonDoc["interval"].is<long>())
+        {
+            client->text("{\"error\": \"Expected {\\\"interval\\\": <ms>}\"}");
+            return;
+        }
+        setSubscriberInterval(client, clampInterval(jsonDoc["interval"].as<long>()));
+    }
+}
+
+// Build one frame per tick and send it to every client whose interval has elapsed
+static void streamTask(void *parameter)
+{
+    static char frame[RESPONSE_BUFFER_SIZE];
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(STREAM_TICK_MS));
+
+        uint32_t now = millis();
+        size_t length = 0;
+
+        xSemaphoreTake(subscribersMutex, portMAX_DELAY);
+        for (int i = 0; i < STREAM_MAX_CLIENTS; ++i)
+        {
+            StreamSubscriber &subscriber = subscribers[i];
+            if (subscriber.client == nullptr || now - subscriber.lastSentMs < subscriber.intervalMs)
+            {
+                continue;
+            }
+            subscriber.lastSentMs = now;
+
+            // Serialize at most once per tick, shared by all due clients
+            if (length == 0)
+            {
+                length = buildFrame(frame, sizeof(frame), now);
+            }
+
+            // Drop frames for clients that cannot keep up instead of queueing them
+            if (subscriber.client->queueLen() < STREAM_MAX_QUEUED_FRAMES)
+            {
+                subscriber.client->text(frame, length);
+            }
+        }
+        xSemaphoreGive(subscribersMutex);
+    }
+}
+
+// Serialize the latest reading of every cell, same fields as GET /weight
+static size_t buildFrame(char *frame, size_t size, uint32_t now)
+{
+    LoadCellReading readings[MAX_LOAD_CELLS];
+    for (int i = 0; i < cellConfig.count; ++i)
+    {
+        readings[i] = getLatestReading(i);
+    }
+
+    JsonWriter json(frame, size);
+    json.beginObject();
+    json.add("timestamp", (unsigned long)now);
+    writeLoadCells(json, readings, cellConfig.count);
+    json.endObject();
+    return json.length();
+}
+
+/* Subscriber Table */
+
+static bool addSubscriber(AsyncWebSocketClient *client, uint32_t intervalMs)
+{
+    bool added = false;
+
+    xSemaphoreTake(subscribersMutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS && !added; ++i)
+    {
+        if (subscribers[i].client == nullptr)
+        {
+            subscribers[i] = {client, intervalMs, 0};
+            added = true;
+        }
+    }
+    xSemaphoreGive(subscribersMutex);
+
+    return added;
+}
+
+static void removeSubscriber(AsyncWebSocketClient *client)
+{
+    xSemaphoreTake(subscribersMutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; ++i)
+    {
+        if (subscribers[i].client == client)
+        {
+            subscribers[i].client = nullptr;
+        }
+    }
+    xSemaphoreGive(subscribersMutex);
+}
+
+static void setSubscriberInterval(AsyncWebSocketClient *client, uint32_t intervalMs)
+{
+    xSemaphoreTake(subscribersMutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; ++i)
+    {
+        if (subscribers[i].client == client)
+        {
+            subscribers[i].intervalMs = intervalMs;
+        }
+    }
+    xSemaphoreGive(subscribersMutex);
+}
+
+static uint32_t clampInterval(long intervalMs)
+{
+    return constrain(intervalMs, STREAM_MIN_INTERVAL_MS, STREAM_MAX_INTERVAL_MS);
+}
@@ -0,0 +1,43 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <ESPAsyncWebServer.h>
+#include <lwip/opt.h>
+#include "responses.h"
+
+// Frames a client may have queued or unacknowledged, newer ones are dropped
+// while it has that many. Bounds the heap a slow client can hold.
+#define STREAM_MAX_QUEUED_FRAMES 1
+
+// WebSocket clients served at the same time, the smallest of three limits.
+// TCP PCBs: AsyncTCP works on raw lwIP PCBs, so CONFIG_LWIP_MAX_SOCKETS does
+// not apply, but every connection takes one of MEMP_NUM_TCP_PCB (16 in the
+// Arduino core). When they run out lwIP kills the oldest connection, so some
+// are kept for HTTP requests including parked /weight/{id}/stable ones, the
+// webhook and a gateway's spare connections.
+#define STREAM_RESERVED_PCBS 6
+#define STREAM_PCB_LIMIT (MEMP_NUM_TCP_PCB - STREAM_RESERVED_PCBS)
+// Heap: AsyncClient, PCB and WebSocket state (about 1 KB) per client, plus
+// each queued frame twice, in its WebSocket message and in lwIP's copy
+#define STREAM_HEAP_BUDGET 49152
+#define STREAM_CLIENT_HEAP (1024 + 2 * STREAM_MAX_QUEUED_FRAMES * RESPONSE_BUFFER_SIZE)
+#define STREAM_HEAP_LIMIT (STREAM_HEAP_BUDGET / STREAM_CLIENT_HEAP)
+// Time: handing a frame to AsyncTCP (copy, queue, tcp_write through the
+// tcpip thread) takes about 150 us; the sends of a tick get half of it
+#define STREAM_SEND_US 150
+#define STREAM_TIME_LIMIT (STREAM_TICK_MS * 1000 / 2 / STREAM_SEND_US)
+
+#define STREAM_MIN2(a, b) ((a) < (b) ? (a) : (b))
+#define STREAM_MAX_CLIENTS STREAM_MIN2(STREAM_PCB_LIMIT, STREAM_MIN2(STREAM_HEAP_LIMIT, STREAM_TIME_LIMIT))
+
+// Frame interval limits and default, clients choose within these bounds
+#define STREAM_MIN_INTERVAL_MS 20
+#define STREAM_MAX_INTERVAL_MS 60000
+#define STREAM_DEFAULT_INTERVAL_MS 100
+
+// Period of the task that builds and sends frames
+#define STREAM_TICK_MS 10
+
+void setupWeightStream(AsyncWebServer &server);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ Host benchmark for the load cell acquisition engine (src/acquisition.cpp)
+ against simulated HX711s. Compares the old sequential polling (get_units(5)
+ on cell 1, then cell 2, ...) with the ready-driven engine and prints samples/s.
+
+ Build and run on Linux:
+   g++ -O2 -std=c++17 -Isrc utils/acquisition_bench.cpp src/acquisition.cpp -o acquisition_bench
+   ./acquisition_bench [cells] [sps] [seconds]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "acquisition.h"
+#include "sim/sim_hx711.h"
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void countSample(int index, long raw, void *context)
+{
+    (void)raw;
+    ((std::vector<long> *)context)->at(index)++;
+}
+
+// Build cells with evenly spread conversion phases
+static std::vector<std::unique_ptr<SimulatedHX711>> makeCells(int numCells, uint32_t periodUs)
+{
+    std::vector<std::unique_ptr<SimulatedHX711>> cells;
+    for (int i = 0; i < numCells; ++i)
+    {
+        cells.emplace_back(new SimulatedHX711(periodUs, periodUs * i / numCells));
+        cells.back()->setSynthetic(8388 * (i + 1), 50);
+    }
+    return cells;
+}
+
+static void printResult(const char *name, const std::vector<long> &counts, double seconds)
+{
+    long total = 0;
+    printf("%-12s", name);
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        printf("  cell %zu: %6.1f/s", i + 1, counts[i] / seconds);
+        total += counts[i];
+    }
+    printf("  total: %7.1f samples/s\n", total / seconds);
+}
+
+int main(int argc, char **argv)
+{
+    int numCells = argc > 1 ? atoi(argv[1]) : 3;
+    int sps = argc > 2 ? atoi(argv[2]) : 80;
+    double duration = argc > 3 ? atof(argv[3]) : 2.0;
+    uint32_t periodUs = 1000000 / sps;
+
+    printf("%d cells at %d SPS, %.1f s per run\n", numCells, sps, duration);
+
+    // Sequential: block on each cell in turn, like get_units(5) in a loop
+    {
+        auto cells = makeCells(numCells, periodUs);
+        std::vector<long> counts(numCells, 0);
+        auto start = std::chrono::steady_clock::now();
+        while (secondsSince(start) < duration)
+        {
+            for (int i = 0; i < numCells; ++i)
+            {
+                for (int k = 0; k < 5; ++k)
+                {
+                    cells[i]->read();
+                    counts[i]++;
+                }
+            }
+        }
+        printResult("sequential", counts, secondsSince(start));
+    }
+
+    // Engine: clock out whichever cell is ready
+    {
+        auto cells = makeCells(numCells, periodUs);
+        std::vector<LoadCellSource *> sources;
+        for (auto &cell : cells)
+        {
+            sources.push_back(cell.get());
+        }
+
+        AcquisitionEngine engine;
+        engine.begin(sources.data(), numCells);
+
+        std::vector<long> counts(numCells, 0);
+        auto start = std::chrono::steady_clock::now();
+        while (secondsSince(start) < duration)
+        {
+            engine.service(countSample, &counts);
+        }
+        printResult("ready-driven", counts, secondsSince(start));
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+"""
+Compare two benchmark results, e.g. of the commit before and after a change.
+Accepts the output of the native build (--bench N --bench-out FILE) and the
+body of GET /bench on the ESP32. Prints p50/p99 latency and heap per
+benchmark and exits with 1 if a p50 grew by more than --threshold percent or
+a benchmark started allocating more.
+
+    .pio/build/native/program --port 0 --bench 1000 --bench-out new.json
+    curl -o new.json "http://192.168.0.125/bench?iterations=1000"
+    python3 utils/bench_compare.py old.json new.json
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    """Benchmarks of a result file by name, as {name: result}"""
+    with open(path) as f:
+        data = json.load(f)
+
+    firmware = data.get("firmware", data) or {}
+    results = {}
+    for result in data.get("requests", []):
+        results[result["name"]] = result
+    for result in firmware.get("benchmarks", []):
+        results["firmware " + result["name"]] = result
+    for i, rate in enumerate(firmware.get("samples_per_second", [])):
+        results[f"cell {i + 1} samples/s"] = {"rate": rate}
+    return results
+
+
+def change(old, new):
+    return (new - old) * 100.0 / old if old else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=20.0, help="allowed p50 increase in percent (default 20)")
+    args = parser.parse_args()
+
+    old = load(args.old)
+    new = load(args.new)
+    regressions = []
+
+    print(f"{'benchmark':56} {'p50 ns':>16} {'change':>8} {'p99 ns':>16} {'heap bytes':>16}")
+    for name, result in new.items():
+        before = old.get(name)
+        if before is None:
+            print(f"{name:56} (new)")
+            continue
+
+        if "rate" in result:
+            print(f"{name:56} {before['rate']:>7.1f} -> {result['rate']:<6.1f}")
+            continue
+
+        p50 = change(before["p50_ns"], result["p50_ns"])
+        print(f"{name:56} {before['p50_ns']:>7} -> {result['p50_ns']:<6} {p50:>+7.1f}% "
+              f"{before['p99_ns']:>7} -> {result['p99_ns']:<6} "
+              f"{before['heap_bytes']:>7.0f} -> {result['heap_bytes']:<6.0f}")
+
+        if p50 > args.threshold:
+            regressions.append(f"{name}: p50 {p50:+.1f}%")
+        # Heap bytes vary with the body (number formatting), allocation counts do not
+        grew = result["heap_bytes"] - before["heap_bytes"]
+        if result.get("allocations", 0) > before.get("allocations", 0) or grew > before["heap_bytes"] * args.threshold / 100:
+            regressions.append(f"{name}: heap {before['heap_bytes']:.0f} -> {result['heap_bytes']:.0f} bytes")
+
+    for name in old:
+        if name not in new:
+            print(f"{name:56} (removed)")
+
+    if regressions:
+        print("\nRegressions:\n  " + "\n  ".join(regressions))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
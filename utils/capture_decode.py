@@ -0,0 +1,77 @@
+"""
+Decode a raw capture downloaded from GET /capture (either format) into CSV
+with the columns time_us,cell,raw. With --cell N only the raw values of that
+cell are written, one per line, which is the trace format of
+utils/filter_bench.cpp.
+
+    curl -o capture.hxd "http://192.168.0.125/capture?format=delta"
+    python3 utils/capture_decode.py capture.hxd > capture.csv
+    python3 utils/capture_decode.py capture.hxd --cell 1 > cell1.txt
+"""
+
+import argparse
+import struct
+import sys
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode(data):
+    magic, num_cells, count, start_us = struct.unpack_from("<4sB3xII", data, 0)
+    pos = 16
+    samples = []
+
+    if magic == b"HXC1":
+        for _ in range(count):
+            time_us, cell, raw_bytes = struct.unpack_from("<IB3s", data, pos)
+            raw = int.from_bytes(raw_bytes, "little", signed=True)
+            samples.append((time_us, cell, raw))
+            pos += 8
+    elif magic == b"HXD1":
+        time_us = 0
+        last_raw = [0] * 256
+        for _ in range(count):
+            cell = data[pos]
+            dt, pos = read_varint(data, pos + 1)
+            zigzag, pos = read_varint(data, pos)
+            time_us += dt
+            last_raw[cell] += (zigzag >> 1) ^ -(zigzag & 1)
+            samples.append((time_us, cell, last_raw[cell]))
+    else:
+        sys.exit("Not a capture file")
+
+    return num_cells, start_us, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file")
+    parser.add_argument("--cell", type=int, help="only write raw values of this cell (1-based)")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        num_cells, start_us, samples = decode(f.read())
+
+    if args.cell is not None:
+        for _, cell, raw in samples:
+            if cell == args.cell - 1:
+                print(raw)
+        return
+
+    print("time_us,cell,raw")
+    for time_us, cell, raw in samples:
+        print(f"{time_us},{cell + 1},{raw}")
+
+
+if __name__ == "__main__":
+    main()
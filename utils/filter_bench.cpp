@@ -0,0 +1,205 @@
+/*
+ Host benchmark for the per-cell filter chain (src/filters.cpp). Runs a raw
+ HX711 trace through several filter settings and prints the cost per sample,
+ the jitter while the plate is at rest and how many samples a step takes to
+ settle. The old 5-sample mean (get_units(5)) is included as a baseline.
+
+ The trace is a text file with one raw reading per line, e.g. a capture from
+ utils/hx711.cpp. Without a file a synthetic trace is used: empty plate, a
+ 100 g step, occasional spikes.
+
+ Build and run on Linux:
+   g++ -O2 -std=c++17 -Isrc utils/filter_bench.cpp src/filters.cpp -o filter_bench
+   ./filter_bench [trace.txt] [offset] [calibration_factor]
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "filters.h"
+
+struct Result
+{
+    double nsPerSample;
+    double restJitter; // standard deviation of the output before the step, in grams
+    int settleSamples; // samples after the step until the output stays within 1 g
+};
+
+static std::vector<float> loadTrace(const char *path, long offset, float factor)
+{
+    std::vector<float> weights;
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        perror(path);
+        exit(1);
+    }
+    long raw;
+    while (fscanf(file, "%ld", &raw) == 1)
+    {
+        weights.push_back((raw - offset) / factor);
+    }
+    fclose(file);
+    return weights;
+}
+
+// 200 samples empty, then 100 g, noise of about 0.3 g and a spike every 37 samples
+static std::vector<float> syntheticTrace()
+{
+    std::vector<float> weights;
+    uint32_t seed = 1;
+    for (int i = 0; i < 600; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((seed >> 8) % 1000 / 1000.0f - 0.5f) * 0.6f;
+        float weight = (i < 200 ? 0.0f : 100.0f) + noise;
+        if (i % 37 == 0)
+        {
+            weight += 40.0f;
+        }
+        weights.push_back(weight);
+    }
+    return weights;
+}
+
+// Index of the largest jump in the trace, taken as the step
+static size_t findStep(const std::vector<float> &trace)
+{
+    size_t step = 1;
+    float largest = 0;
+    for (size_t i = 5; i + 5 < trace.size(); ++i)
+    {
+        float before = (trace[i - 1] + trace[i - 2] + trace[i - 3]) / 3;
+        float after = (trace[i] + trace[i + 1] + trace[i + 2]) / 3;
+        if (fabsf(after - before) > largest)
+        {
+            largest = fabsf(after - before);
+            step = i;
+        }
+    }
+    return step;
+}
+
+template <typename Filter>
+static Result evaluate(const std::vector<float> &trace, size_t step, Filter filter)
+{
+    // First pass from a fresh filter state gives the output, the rest is timing
+    std::vector<float> output(trace.size());
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        output[i] = filter(trace[i]);
+    }
+
+    volatile float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < 1000; ++repeat)
+    {
+        for (size_t i = 0; i < trace.size(); ++i)
+        {
+            sink = filter(trace[i]);
+        }
+    }
+    (void)sink;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    Result result;
+    result.nsPerSample = ns / (1000.0 * trace.size());
+
+    // Jitter over the second half of the rest period
+    double sum = 0, sumSquares = 0;
+    size_t n = 0;
+    for (size_t i = step / 2; i < step; ++i)
+    {
+        sum += output[i];
+        sumSquares += output[i] * output[i];
+        n++;
+    }
+    double mean = n ? sum / n : 0;
+    result.restJitter = n ? sqrt(fmax(0.0, sumSquares / n - mean * mean)) : 0;
+
+    // Settled value: mean of the last quarter of the trace
+    double settled = 0;
+    size_t tail = trace.size() - trace.size() / 4;
+    for (size_t i = tail; i < trace.size(); ++i)
+    {
+        settled += output[i];
+    }
+    settled /= trace.size() - tail;
+
+    result.settleSamples = -1;
+    for (size_t i = trace.size(); i-- > step;)
+    {
+        if (fabs(output[i] - settled) > 1.0)
+        {
+            result.settleSamples = (int)(i + 1 - step);
+            break;
+        }
+    }
+    if (result.settleSamples < 0)
+    {
+        result.settleSamples = 0;
+    }
+    return result;
+}
+
+static void print(const char *name, const Result &result)
+{
+    printf("%-28s %7.1f ns/sample  jitter %6.3f g  settles in %3d samples\n",
+           name, result.nsPerSample, result.restJitter, result.settleSamples);
+}
+
+static void benchChain(const char *name, const std::vector<float> &trace, size_t step, FilterConfig config)
+{
+    FilterChain chain;
+    config.zeroBand = -1e9f; // keep negative values so the jitter is visible
+    chain.configure(config);
+    print(name, evaluate(trace, step, [&](float x)
+                         { return chain.update(x); }));
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<float> trace = argc > 1 ? loadTrace(argv[1], argc > 2 ? atol(argv[2]) : 0, argc > 3 ? atof(argv[3]) : -410.0f)
+                                        : syntheticTrace();
+    size_t step = findStep(trace);
+    printf("%zu samples, step at sample %zu\n", trace.size(), step);
+
+    // Baseline: mean of the last 5 readings, like get_units(5)
+    {
+        float window[5] = {0};
+        int head = 0, count = 0;
+        print("mean of 5 (get_units(5))", evaluate(trace, step, [&](float x)
+                                                   {
+            window[head] = x;
+            head = (head + 1) % 5;
+            count = count < 5 ? count + 1 : 5;
+            float sum = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                sum += window[i];
+            }
+            return sum / count; }));
+    }
+
+    FilterConfig config = DEFAULT_FILTER_CONFIG;
+    benchChain("default (median 5 + EMA)", trace, step, config);
+
+    config.deadband = 0;
+    benchChain("median 5 + EMA 0.3", trace, step, config);
+
+    config.smoothing = SMOOTHING_KALMAN;
+    benchChain("median 5 + Kalman", trace, step, config);
+
+    config.medianWindow = 3;
+    config.smoothing = SMOOTHING_EMA;
+    config.emaAlpha = 0.5f;
+    benchChain("median 3 + EMA 0.5", trace, step, config);
+
+    config.medianWindow = 1;
+    config.smoothing = SMOOTHING_KALMAN;
+    benchChain("Kalman only", trace, step, config);
+
+    return 0;
+}
@@ -0,0 +1,894 @@
+/*
+ HTTP gateway between the public server and the ESP32, replacing
+ utils/server_api.php (one curl process and one new TCP connection per call).
+
+ - Keeps connected spare sockets to the ESP32, so a request never waits for
+   a TCP handshake. ESPAsyncWebServer closes the connection after every
+   response; should the device keep one open, it is reused.
+ - Concurrent identical GETs are coalesced into one upstream call.
+ - GET /weight*, /calibration_factor* and /filter/ID answers are served from a
+   cache for --ttl-ms. After that they are revalidated with the ETag of the
+   firmware, which answers 304 while nothing changed.
+ - Any other method clears the cache (a tare or new factor moves the weights).
+ - GET /gateway/stats shows the counters of the gateway itself.
+
+ WebSockets (/weight/stream) are not proxied, clients connect to the device.
+
+ Build and run on Linux:
+   g++ -O2 -std=c++17 -pthread utils/gateway.cpp -o gateway
+   ./gateway --device 192.168.0.125:80 [--port 8080] [--ttl-ms 200] [--spares 2]
+
+ Locally, the native build of the firmware stands in for the device:
+   .pio/build/native/program --port 8081 --run 600 &
+   ./gateway --device 127.0.0.1:8081 --port 8080
+   curl -i http://127.0.0.1:8080/weight
+*/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define MAX_HEAD_SIZE 16384
+#define MAX_BODY_SIZE (1024 * 1024)
+
+// Long enough for GET /weight/ID/stable with its longest timeout
+#define UPSTREAM_TIMEOUT_MS 65000
+#define CLIENT_IDLE_TIMEOUT_MS 15000
+
+// An idle spare is replaced after this long, in case the device dropped it
+#define SPARE_MAX_IDLE_MS 10000
+
+#define MAX_CLIENTS 64
+#define MAX_CACHED_TARGETS 256
+
+typedef std::chrono::steady_clock Clock;
+
+struct HttpMessage
+{
+    std::string startLine;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    const std::string *header(const char *name) const;
+};
+
+// Socket plus the bytes read past the end of the previous message
+struct Connection
+{
+    int fd = -1;
+    std::string pending;
+    bool closed = false; // the last body ended with the connection
+};
+
+struct SpareConnection
+{
+    int fd;
+    Clock::time_point openedAt;
+};
+
+// Upstream call in progress, shared by all clients that asked for the same target
+struct Flight
+{
+    unsigned long generation; // of the target when the call was started
+    bool done = false;
+    HttpMessage response;
+};
+
+struct CachedTarget
+{
+    std::shared_ptr<Flight> flight;
+    unsigned long generation = 0; // bumped by every non-GET request
+    bool cached = false;
+    HttpMessage response;
+    Clock::time_point fetchedAt;
+};
+
+struct Stats
+{
+    std::atomic<unsigned long> requests{0};
+    std::atomic<unsigned long> hits{0};
+    std::atomic<unsigned long> coalesced{0};
+    std::atomic<unsigned long> revalidated{0};
+    std::atomic<unsigned long> upstreamRequests{0};
+    std::atomic<unsigned long> upstreamConnects{0};
+    std::atomic<unsigned long> sparesUsed{0};
+    std::atomic<unsigned long> reusedConnections{0};
+    std::atomic<unsigned long> upstreamErrors{0};
+};
+
+// Settings
+static std::string deviceHost = "192.168.0.125";
+static std::string devicePort = "80";
+static int listenPort = 8080;
+static int ttlMs = 200;
+static int spareCount = 2;
+
+// Upstream connections
+static std::mutex poolMutex;
+static std::condition_variable sparesNeeded;
+static std::deque<SpareConnection> spares;
+static std::vector<int> keptAlive; // connections the device left open
+
+// Coalescing and cache, by request target
+static std::mutex targetsMutex;
+static std::condition_variable flightDone;
+static std::unordered_map<std::string, CachedTarget> targets;
+
+static std::atomic<int> clientCount{0};
+static Stats stats;
+
+// Function Prototypes
+static void serveClient(int fd);
+static HttpMessage handleRequest(const HttpMessage &request, const std::string &method, const std::string &target, const char *&source);
+static HttpMessage fetchCoalesced(const HttpMessage &request, const std::string &target, const char *&source);
+static void invalidateTargets();
+static void evictIdleTargets();
+static bool exchange(const HttpMessage &request, HttpMessage &response);
+static bool exchangeOn(int fd, const HttpMessage &request, HttpMessage &response, bool &keepAlive);
+static int takeConnection(bool &reused);
+static void keepSpares();
+static int connectToDevice();
+static bool readMessage(Connection &connection, HttpMessage &message, bool isResponse, bool noBody);
+static bool fill(Connection &connection, size_t size);
+static size_t fillUntil(Connection &connection, const char *delimiter, size_t from, size_t limit);
+static bool sendAll(int fd, const std::string &data);
+static void setTimeout(int fd, int ms);
+static bool isCacheable(const std::string &target);
+static bool etagMatches(const std::string &ifNoneMatch, const std::string &etag);
+static HttpMessage makeResponse(int status, const char *reason, const std::string &body);
+static int statusOf(const HttpMessage &response);
+static std::string formatStats();
+static bool equalsIgnoreCase(const std::string &a, const char *b);
+static void usage(const char *program);
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--device" && i + 1 < argc)
+        {
+            std::string device = argv[++i];
+            size_t colon = device.rfind(':');
+            deviceHost = device.substr(0, colon);
+            devicePort = colon == std::string::npos ? "80" : device.substr(colon + 1);
+        }
+        else if (arg == "--port" && i + 1 < argc)
+        {
+            listenPort = atoi(argv[++i]);
+        }
+        else if (arg == "--ttl-ms" && i + 1 < argc)
+        {
+            ttlMs = atoi(argv[++i]);
+        }
+        else if (arg == "--spares" && i + 1 < argc)
+        {
+            spareCount = atoi(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = socket(AF_INET6, SOCK_STREAM, 0);
+    int on = 1;
+    int off = 0;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(server, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    sockaddr_in6 address = {};
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(listenPort);
+    if (bind(server, (sockaddr *)&address, sizeof(address)) != 0 || listen(server, 64) != 0)
+    {
+        perror("listen");
+        return 1;
+    }
+    printf("Gateway on port %d for %s:%s, cache %d ms, %d spare connections\n", listenPort, deviceHost.c_str(),
+           devicePort.c_str(), ttlMs, spareCount);
+    fflush(stdout);
+
+    std::thread(keepSpares).detach();
+
+    for (;;)
+    {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0)
+        {
+            continue;
+        }
+        if (clientCount.fetch_add(1) >= MAX_CLIENTS)
+        {
+            sendAll(client, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            close(client);
+            clientCount--;
+            continue;
+        }
+        std::thread([client]()
+                    {
+            serveClient(client);
+            clientCount--; })
+            .detach();
+    }
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s --device HOST[:PORT] [--port N] [--ttl-ms MS] [--spares N]\n", program);
+}
+
+/* Clients */
+
+// Answer requests of one client until it closes or stays idle
+static void serveClient(int fd)
+{
+    Connection client;
+    client.fd = fd;
+    setTimeout(fd, CLIENT_IDLE_TIMEOUT_MS);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    HttpMessage request;
+    while (readMessage(client, request, false, false))
+    {
+        stats.requests++;
+
+        size_t methodEnd = request.startLine.find(' ');
+        size_t targetEnd = request.startLine.find(' ', methodEnd + 1);
+        if (methodEnd == std::string::npos || targetEnd == std::string::npos)
+        {
+            break;
+        }
+        std::string method = request.startLine.substr(0, methodEnd);
+        std::string target = request.startLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+        std::string version = request.startLine.substr(targetEnd + 1);
+
+        const std::string *connectionHeader = request.header("Connection");
+        bool keepAlive = connectionHeader != nullptr ? !equalsIgnoreCase(*connectionHeader, "close")
+                                                     : version == "HTTP/1.1";
+
+        const char *source = "miss";
+        HttpMessage response = handleRequest(request, method, target, source);
+
+        // The client may already have this body
+        const std::string *etag = response.header("ETag");
+        const std::string *ifNoneMatch = request.header("If-None-Match");
+        bool notModified = statusOf(response) == 200 && etag != nullptr && ifNoneMatch != nullptr && etagMatches(*ifNoneMatch, *etag);
+
+        std::string message = notModified ? "HTTP/1.1 304 Not Modified\r\n" : "HTTP/1.1" + response.startLine.substr(response.startLine.find(' ')) + "\r\n";
+        for (const auto &header : response.headers)
+        {
+            message += header.first + ": " + header.second + "\r\n";
+        }
+        message += "Content-Length: " + std::to_string(notModified || method == "HEAD" ? 0 : response.body.size()) + "\r\n";
+        message += std::string("X-Gateway-Cache: ") + source + "\r\n";
+        message += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        if (!notModified && method != "HEAD")
+        {
+            message += response.body;
+        }
+
+        if (!sendAll(fd, message) || !keepAlive)
+        {
+            break;
+        }
+    }
+    close(fd);
+}
+
+// Forward one request. source tells where the answer came from: "hit",
+// "coalesced", "revalidated", "miss" or "gateway".
+static HttpMessage handleRequest(const HttpMessage &request, const std::string &method, const std::string &target, const char *&source)
+{
+    if (method == "GET" && target == "/gateway/stats")
+    {
+        source = "gateway";
+        return makeResponse(200, "OK", formatStats());
+    }
+
+    const std::string *upgrade = request.header("Upgrade");
+    if (upgrade != nullptr)
+    {
+        source = "gateway";
+        return makeResponse(501, "Not Implemented", "{\"error\":\"WebSockets are not proxied, connect to the device\"}");
+    }
+
+    if (method == "GET" || method == "HEAD")
+    {
+        return fetchCoalesced(request, target, source);
+    }
+
+    // Anything else may change what the cached GETs return. GETs that
+    // finish while it is in flight may or may not see the change, so they
+    // are dropped again once it is answered.
+    invalidateTargets();
+    HttpMessage response;
+    if (!exchange(request, response))
+    {
+        response = makeResponse(502, "Bad Gateway", "{\"error\":\"Unable to connect to ESP32 or no response from the device.\"}");
+    }
+    invalidateTargets();
+    return response;
+}
+
+// Forget targets with no upstream call in flight and no answer within the
+// TTL, they would only be fetched again anyway. Called with targetsMutex held.
+static void evictIdleTargets()
+{
+    Clock::time_point now = Clock::now();
+    for (auto entry = targets.begin(); entry != targets.end();)
+    {
+        bool fresh = entry->second.cached && now - entry->second.fetchedAt < std::chrono::milliseconds(ttlMs);
+        entry = entry->second.flight || fresh ? std::next(entry) : targets.erase(entry);
+    }
+}
+
+// Drop cached answers, and keep the upstream calls in flight from being
+// cached or joined
+static void invalidateTargets()
+{
+    std::lock_guard<std::mutex> lock(targetsMutex);
+    for (auto &entry : targets)
+    {
+        entry.second.cached = false;
+        entry.second.generation++;
+    }
+}
+
+// GET a target from the cache, from an upstream call another client started,
+// or from a new upstream call
+static HttpMessage fetchCoalesced(const HttpMessage &request, const std::string &target, const char *&source)
+{
+    bool cacheable = ttlMs > 0 && isCacheable(target);
+
+    std::unique_lock<std::mutex> lock(targetsMutex);
+    auto found = targets.find(target);
+    if (found == targets.end())
+    {
+        if (targets.size() >= MAX_CACHED_TARGETS)
+        {
+            evictIdleTargets();
+        }
+        if (targets.size() >= MAX_CACHED_TARGETS)
+        {
+            // Many different query strings in flight, forward without coalescing
+            lock.unlock();
+            HttpMessage response;
+            if (!exchange(request, response))
+            {
+                response = makeResponse(502, "Bad Gateway", "{\"error\":\"Unable to connect to ESP32 or no response from the device.\"}");
+            }
+            return response;
+        }
+        found = targets.emplace(target, CachedTarget()).first;
+    }
+    CachedTarget &entry = found->second; // stays valid, entries with a flight are never erased
+
+    if (cacheable && entry.cached && Clock::now() - entry.fetchedAt < std::chrono::milliseconds(ttlMs))
+    {
+        stats.hits++;
+        source = "hit";
+        return entry.response;
+    }
+
+    // A call started before the last POST may return what the POST changed
+    if (entry.flight && entry.flight->generation == entry.generation)
+    {
+        std::shared_ptr<Flight> flight = entry.flight;
+        flightDone.wait(lock, [&flight]()
+                        { return flight->done; });
+        stats.coalesced++;
+        source = "coalesced";
+        return flight->response;
+    }
+
+    std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+    flight->generation = entry.generation;
+    entry.flight = flight;
+
+    // The device answers 304 if the cached body is still current. The
+    // client's own If-None-Match is answered by the gateway.
+    HttpMessage upstream = request;
+    upstream.startLine = "GET " + target + " HTTP/1.1"; // HEAD shares the cached GET
+    for (auto header = upstream.headers.begin(); header != upstream.headers.end();)
+    {
+        header = equalsIgnoreCase(header->first, "If-None-Match") ? upstream.headers.erase(header) : header + 1;
+    }
+    const std::string *cachedEtag = entry.cached ? entry.response.header("ETag") : nullptr;
+    bool revalidating = cacheable && cachedEtag != nullptr;
+    if (revalidating)
+    {
+        upstream.headers.emplace_back("If-None-Match", *cachedEtag);
+    }
+    lock.unlock();
+
+    HttpMessage response;
+    bool ok = exchange(upstream, response);
+
+    lock.lock();
+    bool current = flight->generation == entry.generation;
+    if (!ok)
+    {
+        response = makeResponse(502, "Bad Gateway", "{\"error\":\"Unable to connect to ESP32 or no response from the device.\"}");
+    }
+    else if (statusOf(response) == 304 && revalidating)
+    {
+        stats.revalidated++;
+        source = "revalidated";
+        response = entry.response;
+        if (current)
+        {
+            entry.fetchedAt = Clock::now();
+        }
+    }
+    else if (cacheable && current && statusOf(response) == 200)
+    {
+        entry.response = response;
+        entry.cached = true;
+        entry.fetchedAt = Clock::now();
+    }
+
+    flight->response = response;
+    flight->done = true;
+    if (entry.flight == flight)
+    {
+        entry.flight.reset();
+    }
+    flightDone.notify_all();
+    return response;
+}
+
+/* Upstream */
+
+// Send a request to the device and read its response. A reused connection
+// may have been closed by the device in the meantime, so a failure on one
+// is retried once on a new connection.
+static bool exchange(const HttpMessage &request, HttpMessage &response)
+{
+    stats.upstreamRequests++;
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        bool reused = false;
+        int fd = takeConnection(reused);
+        if (fd < 0)
+        {
+            break;
+        }
+
+        bool keepAlive = false;
+        if (exchangeOn(fd, request, response, keepAlive))
+        {
+            if (keepAlive)
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                keptAlive.push_back(fd);
+            }
+            else
+            {
+                close(fd);
+            }
+            return true;
+        }
+        close(fd);
+        if (!reused)
+        {
+            break;
+        }
+    }
+    stats.upstreamErrors++;
+    return false;
+}
+
+static bool exchangeOn(int fd, const HttpMessage &request, HttpMessage &response, bool &keepAlive)
+{
+    size_t methodEnd = request.startLine.find(' ');
+    size_t targetEnd = request.startLine.find(' ', methodEnd + 1);
+    std::string method = request.startLine.substr(0, methodEnd);
+
+    std::string message = request.startLine.substr(0, targetEnd) + " HTTP/1.1\r\n";
+    message += "Host: " + deviceHost + "\r\n";
+    for (const auto &header : request.headers)
+    {
+        // Only what the firmware looks at, the rest is hop-by-hop or for the gateway
+        if (equalsIgnoreCase(header.first, "Content-Type") || equalsIgnoreCase(header.first, "If-None-Match") ||
+            equalsIgnoreCase(header.first, "Accept"))
+        {
+            message += header.first + ": " + header.second + "\r\n";
+        }
+    }
+    if (!request.body.empty())
+    {
+        message += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+    }
+    message += "Connection: keep-alive\r\n\r\n" + request.body;
+
+    Connection connection;
+    connection.fd = fd;
+    if (!sendAll(fd, message) || !readMessage(connection, response, true, method == "HEAD"))
+    {
+        return false;
+    }
+
+    // Only hand on the headers the clients need, lengths are set again
+    std::vector<std::pair<std::string, std::string>> headers;
+    keepAlive = response.startLine.compare(0, 8, "HTTP/1.1") == 0;
+    for (const auto &header : response.headers)
+    {
+        if (equalsIgnoreCase(header.first, "Connection"))
+        {
+            keepAlive = !equalsIgnoreCase(header.second, "close");
+        }
+        else if (equalsIgnoreCase(header.first, "Content-Type") || equalsIgnoreCase(header.first, "ETag") ||
+                 equalsIgnoreCase(header.first, "Cache-Control") || equalsIgnoreCase(header.first, "Content-Disposition"))
+        {
+            headers.push_back(header);
+        }
+    }
+    response.headers = headers;
+    keepAlive = keepAlive && connection.pending.empty() && !connection.closed;
+    return true;
+}
+
+// A connection the device kept open, a spare, or a new one
+static int takeConnection(bool &reused)
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!keptAlive.empty())
+        {
+            int fd = keptAlive.back();
+            keptAlive.pop_back();
+            reused = true;
+            stats.reusedConnections++;
+            return fd;
+        }
+        while (!spares.empty())
+        {
+            SpareConnection spare = spares.front();
+            spares.pop_front();
+            sparesNeeded.notify_one();
+
+            // Closed by the device while it was idle?
+            char byte;
+            if (recv(spare.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0)
+            {
+                close(spare.fd);
+                continue;
+            }
+            reused = true;
+            stats.sparesUsed++;
+            return spare.fd;
+        }
+    }
+
+    reused = false;
+    return connectToDevice();
+}
+
+// Background thread that keeps --spares connections open, so requests skip
+// the handshake. Spares idle for too long are replaced.
+static void keepSpares()
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    for (;;)
+    {
+        while (!spares.empty() && Clock::now() - spares.front().openedAt > std::chrono::milliseconds(SPARE_MAX_IDLE_MS))
+        {
+            close(spares.front().fd);
+            spares.pop_front();
+        }
+
+        if ((int)spares.size() < spareCount)
+        {
+            lock.unlock();
+            int fd = connectToDevice();
+            lock.lock();
+            if (fd >= 0)
+            {
+                spares.push_back({fd, Clock::now()});
+                continue;
+            }
+        }
+
+        // Refill when a spare was taken, or retry a failed connect a bit later
+        sparesNeeded.wait_for(lock, std::chrono::milliseconds(1000));
+    }
+}
+
+static int connectToDevice()
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(deviceHost.c_str(), devicePort.c_str(), &hints, &addresses) != 0)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo *address = addresses; address != nullptr && fd < 0; address = address->ai_next)
+    {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (fd >= 0)
+    {
+        stats.upstreamConnects++;
+        setTimeout(fd, UPSTREAM_TIMEOUT_MS);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+/* HTTP/1.1 */
+
+// Read one request or response. Bodies come with Content-Length, chunked,
+// or (responses only) until the connection closes.
+static bool readMessage(Connection &connection, HttpMessage &message, bool isResponse, bool noBody)
+{
+    size_t headEnd = fillUntil(connection, "\r\n\r\n", 0, MAX_HEAD_SIZE);
+    if (headEnd == std::string::npos)
+    {
+        return false;
+    }
+
+    message = HttpMessage();
+    size_t lineEnd = connection.pending.find("\r\n");
+    message.startLine = connection.pending.substr(0, lineEnd);
+    size_t lineStart = lineEnd + 2;
+    while (lineStart < headEnd)
+    {
+        size_t end = connection.pending.find("\r\n", lineStart);
+        std::string line = connection.pending.substr(lineStart, end - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos)
+        {
+            size_t valueStart = line.find_first_not_of(' ', colon + 1);
+            message.headers.emplace_back(line.substr(0, colon), valueStart == std::string::npos ? "" : line.substr(valueStart));
+        }
+        lineStart = end + 2;
+    }
+    connection.pending.erase(0, headEnd + 4);
+
+    int status = isResponse ? statusOf(message) : 0;
+    if (noBody || status == 204 || status == 304 || (status >= 100 && status < 200))
+    {
+        return true;
+    }
+
+    const std::string *transferEncoding = message.header("Transfer-Encoding");
+    const std::string *contentLength = message.header("Content-Length");
+    if (transferEncoding != nullptr && equalsIgnoreCase(*transferEncoding, "chunked"))
+    {
+        for (;;)
+        {
+            size_t sizeEnd = fillUntil(connection, "\r\n", 0, 64);
+            if (sizeEnd == std::string::npos)
+            {
+                return false;
+            }
+            size_t size = strtoul(connection.pending.c_str(), nullptr, 16);
+            connection.pending.erase(0, sizeEnd + 2);
+            if (size == 0)
+            {
+                // No trailers are sent by the firmware, only the final CRLF
+                if (!fill(connection, 2))
+                {
+                    return false;
+                }
+                connection.pending.erase(0, 2);
+                return true;
+            }
+            if (message.body.size() + size > MAX_BODY_SIZE || !fill(connection, size + 2))
+            {
+                return false;
+            }
+            message.body.append(connection.pending, 0, size);
+            connection.pending.erase(0, size + 2);
+        }
+    }
+
+    if (contentLength != nullptr)
+    {
+        size_t length = strtoul(contentLength->c_str(), nullptr, 10);
+        if (length > MAX_BODY_SIZE || !fill(connection, length))
+        {
+            return false;
+        }
+        message.body = connection.pending.substr(0, length);
+        connection.pending.erase(0, length);
+        return true;
+    }
+
+    if (!isResponse)
+    {
+        return true;
+    }
+
+    // Until the device closes the connection
+    char buffer[4096];
+    ssize_t n;
+    message.body.swap(connection.pending);
+    while ((n = recv(connection.fd, buffer, sizeof(buffer), 0)) > 0 && message.body.size() < MAX_BODY_SIZE)
+    {
+        message.body.append(buffer, n);
+    }
+    connection.closed = true;
+    return true;
+}
+
+// Read until at least size bytes are pending
+static bool fill(Connection &connection, size_t size)
+{
+    char buffer[4096];
+    while (connection.pending.size() < size)
+    {
+        ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        connection.pending.append(buffer, n);
+    }
+    return true;
+}
+
+// Read until the delimiter is pending, returns its position or npos
+static size_t fillUntil(Connection &connection, const char *delimiter, size_t from, size_t limit)
+{
+    char buffer[4096];
+    size_t position;
+    while ((position = connection.pending.find(delimiter, from)) == std::string::npos)
+    {
+        if (connection.pending.size() > limit)
+        {
+            return std::string::npos;
+        }
+        ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            return std::string::npos;
+        }
+        connection.pending.append(buffer, n);
+    }
+    return position;
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+static void setTimeout(int fd, int ms)
+{
+    timeval timeout = {ms / 1000, (ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+/* Helpers */
+
+const std::string *HttpMessage::header(const char *name) const
+{
+    for (const auto &header : headers)
+    {
+        if (equalsIgnoreCase(header.first, name))
+        {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+// Readings and settings, not the long polls, streams, downloads or monitoring
+static bool isCacheable(const std::string &target)
+{
+    std::string path = target.substr(0, target.find('?'));
+    if (path.size() >= 7 && path.compare(path.size() - 7, 7, "/stable") == 0)
+    {
+        return false;
+    }
+    return path == "/weight" || path.compare(0, 8, "/weight/") == 0 || path.compare(0, 19, "/calibration_factor") == 0 ||
+           path.compare(0, 8, "/filter/") == 0;
+}
+
+// Same rules as the firmware: a list of tags, W/ ignored, "*" matches any
+static bool etagMatches(const std::string &ifNoneMatch, const std::string &etag)
+{
+    size_t start = 0;
+    while (start < ifNoneMatch.size())
+    {
+        size_t end = ifNoneMatch.find(',', start);
+        std::string item = ifNoneMatch.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        size_t first = item.find_first_not_of(' ');
+        size_t last = item.find_last_not_of(' ');
+        item = first == std::string::npos ? "" : item.substr(first, last - first + 1);
+        if (item.compare(0, 2, "W/") == 0)
+        {
+            item = item.substr(2);
+        }
+        if (item == "*" || item == etag)
+        {
+            return true;
+        }
+        if (end == std::string::npos)
+        {
+            break;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+static HttpMessage makeResponse(int status, const char *reason, const std::string &body)
+{
+    HttpMessage response;
+    response.startLine = "HTTP/1.1 " + std::to_string(status) + " " + reason;
+    response.headers.emplace_back("Content-Type", "application/json");
+    response.body = body;
+    return response;
+}
+
+static int statusOf(const HttpMessage &response)
+{
+    size_t space = response.startLine.find(' ');
+    return space == std::string::npos ? 0 : atoi(response.startLine.c_str() + space + 1);
+}
+
+static std::string formatStats()
+{
+    char body[512];
+    snprintf(body, sizeof(body),
+             "{\"requests\":%lu,\"hits\":%lu,\"coalesced\":%lu,\"revalidated\":%lu,\"upstream_requests\":%lu,"
+             "\"upstream_connects\":%lu,\"spares_used\":%lu,\"reused_connections\":%lu,\"upstream_errors\":%lu}",
+             stats.requests.load(), stats.hits.load(), stats.coalesced.load(), stats.revalidated.load(),
+             stats.upstreamRequests.load(), stats.upstreamConnects.load(), stats.sparesUsed.load(),
+             stats.reusedConnections.load(), stats.upstreamErrors.load());
+    return body;
+}
+
+static bool equalsIgnoreCase(const std::string &a, const char *b)
+{
+    return strcasecmp(a.c_str(), b) == 0;
+}
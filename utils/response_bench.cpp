@@ -0,0 +1,150 @@
+/*
+ Host benchmark for the JSON bodies of GET /weight and GET /calibration_factor
+ (src/responses.cpp). Prints heap allocations per response and ns per response.
+ If ArduinoJson is on the include path, the previous JsonDocument + serializeJson
+ path is measured as a baseline.
+
+ Build and run on Linux:
+   g++ -O2 -std=c++17 -Isrc utils/response_bench.cpp src/responses.cpp src/acquisition_status.cpp src/calibration.cpp src/drift.cpp -o response_bench
+   g++ -O2 -std=c++17 -Isrc -I<ArduinoJson>/src utils/response_bench.cpp src/responses.cpp src/acquisition_status.cpp src/calibration.cpp src/drift.cpp -o response_bench
+   ./response_bench [iterations]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "responses.h"
+
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#define HAVE_ARDUINOJSON 1
+#endif
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *p = malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Fields set by name, so a reordered LoadCellReading cannot shift them
+static LoadCellReading makeReading(bool connected, long raw, float weight, bool stable, uint32_t timestamp)
+{
+    LoadCellReading reading = {};
+    reading.connected = connected;
+    reading.raw = raw;
+    reading.weight = weight;
+    reading.stable = stable;
+    reading.timestamp = timestamp;
+    return reading;
+}
+
+static const int NUM_CELLS = 3;
+static LoadCellReading readings[NUM_CELLS] = {
+    makeReading(true, 8412345, 123.4f, true, 1000),
+    makeReading(true, 8398765, 0.0f, false, 1000),
+    makeReading(false, 0, 0.0f, false, 900),
+};
+static float factors[NUM_CELLS] = {-410.0f, -410.0f, -380.0f};
+
+// Run fn `iterations` times, print allocations and ns per call
+template <typename Fn>
+static void bench(const char *name, long iterations, Fn fn)
+{
+    size_t sink = 0;
+    unsigned long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+    {
+        sink += fn();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-36s %6.2f allocs/response %8.1f ns/response (%zu bytes)\n",
+           name, (double)(allocations - before) / iterations, ns / iterations, sink / iterations);
+}
+
+#ifdef HAVE_ARDUINOJSON
+// Counts the allocations ArduinoJson makes through its allocator interface
+struct CountingAllocator : ArduinoJson::Allocator
+{
+    void *allocate(size_t size) override
+    {
+        allocations++;
+        return malloc(size);
+    }
+    void deallocate(void *p) override { free(p); }
+    void *reallocate(void *p, size_t size) override
+    {
+        allocations++;
+        return realloc(p, size);
+    }
+};
+static CountingAllocator countingAllocator;
+#endif
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    char body[RESPONSE_BUFFER_SIZE];
+
+    printf("%ld iterations\n", iterations);
+
+    bench("/weight (fixed buffer)", iterations, [&]
+          { return formatWeights(body, sizeof(body), readings, NUM_CELLS); });
+    bench("/weight/1 (fixed buffer)", iterations, [&]
+          { return formatWeight(body, sizeof(body), 1, readings[0].weight, readings[0].stable); });
+    bench("/calibration_factor (fixed buffer)", iterations, [&]
+          { return formatCalibrationFactors(body, sizeof(body), factors, NUM_CELLS); });
+    bench("/calibration_factor/1 (fixed buffer)", iterations, [&]
+          { return formatCalibrationFactor(body, sizeof(body), 1, factors[0]); });
+
+#ifdef HAVE_ARDUINOJSON
+    bench("/weight (JsonDocument)", iterations, [&]
+          {
+        JsonDocument jsonDoc(&countingAllocator);
+        JsonArray loadCells = jsonDoc["load_cells"].to<JsonArray>();
+        for (int i = 0; i < NUM_CELLS; ++i)
+        {
+            JsonObject cell = loadCells.add<JsonObject>();
+            cell["id"] = i + 1;
+            if (!readings[i].connected)
+            {
+                cell["error"] = "Load cell not connected or not detected";
+            }
+            else
+            {
+                cell["weight"] = readings[i].weight;
+            }
+        }
+        std::string jsonResponse;
+        serializeJson(jsonDoc, jsonResponse);
+        return jsonResponse.size(); });
+    bench("/calibration_factor (JsonDocument)", iterations, [&]
+          {
+        JsonDocument jsonDoc(&countingAllocator);
+        JsonArray calFactors = jsonDoc["calibration_factors"].to<JsonArray>();
+        for (int i = 0; i < NUM_CELLS; ++i)
+        {
+            JsonObject calFactor = calFactors.add<JsonObject>();
+            calFactor["id"] = i + 1;
+            calFactor["calibration_factor"] = factors[i];
+        }
+        std::string jsonResponse;
+        serializeJson(jsonDoc, jsonResponse);
+        return jsonResponse.size(); });
+#endif
+
+    formatWeights(body, sizeof(body), readings, NUM_CELLS);
+    printf("\nGET /weight body: %s\n", body);
+    return 0;
+}
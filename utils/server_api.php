@@ -3,8 +3,14 @@ $esp32_ip = '131.159.6.138:8080';  // Local IP address of ESP32 on the Cocktail_
 
 $url = "http://$esp32_ip/weight";
 
+// Pass the client's ETag on, the ESP32 answers 304 while no weight changed
+$if_none_match = '';
+if (isset($_SERVER['HTTP_IF_NONE_MATCH'])) {
+    $if_none_match = '-H ' . escapeshellarg('If-None-Match: ' . $_SERVER['HTTP_IF_NONE_MATCH']);
+}
+
 // Build the shell command to run curl
-$curl_command = "curl -s $url";  // -s for silent mode
+$curl_command = "curl -s -i $if_none_match $url";  // -s for silent mode, -i to get the status and headers
 
 // Execute the curl command using shell_exec()
 $response = shell_exec($curl_command);
@@ -15,8 +21,28 @@ if ($response === null || $response === false) {
         'error' => 'Unable to connect to ESP32 or no response from the device.'
     ]);
 } else {
-    // Output the ESP32's response in JSON format
-    header('Content-Type: application/json');
-    echo $response;
+    // Split the status line and headers from the body
+    $parts = explode("\r\n\r\n", $response, 2);
+    $head = explode("\r\n", $parts[0]);
+    $body = isset($parts[1]) ? $parts[1] : '';
+
+    $status = 200;
+    if (preg_match('/^HTTP\/\S+ (\d{3})/', $head[0], $match)) {
+        $status = (int)$match[1];
+    }
+    http_response_code($status);
+
+    // Forward the cache headers so the client can revalidate next time
+    foreach ($head as $line) {
+        if (preg_match('/^(ETag|Cache-Control):/i', $line)) {
+            header($line);
+        }
+    }
+
+    if ($status != 304) {
+        // Output the ESP32's response in JSON format
+        header('Content-Type: application/json');
+        echo $body;
+    }
 }
-?>
\ No newline at end of file
+?>
@@ -0,0 +1,63 @@
+"""
+Local HTTP sink for the threshold alerts the ESP32 posts to its webhook.
+Prints every POST body with the time it arrived. --fail N answers the first
+N requests with 503 to exercise the retries, --status sets the code of the
+rest.
+
+    python3 utils/webhook_sink.py --port 9000
+    curl -d url=http://192.168.0.10:9000/alerts http://192.168.0.125/alerts/webhook
+
+Against the native build:
+
+    python3 utils/webhook_sink.py --port 9000 --fail 1 &
+    .pio/build/native/program --request "POST /alerts/webhook url=http://127.0.0.1:9000/alerts" \\
+        --request "POST /alerts/1 low=50" --sleep 3000
+"""
+
+import argparse
+import datetime
+import sys
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+def make_handler(fail, status):
+    state = {"received": 0}
+
+    class Handler(BaseHTTPRequestHandler):
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", 0))
+            body = self.rfile.read(length).decode("utf-8", "replace")
+            state["received"] += 1
+
+            code = 503 if state["received"] <= fail else status
+            time = datetime.datetime.now().strftime("%H:%M:%S.%f")[:-3]
+            print(f"{time} {self.path} -> {code} {body}", flush=True)
+
+            self.send_response(code)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+
+        def log_message(self, format, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=9000)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--fail", type=int, default=0, help="answer the first N requests with 503")
+    parser.add_argument("--status", type=int, default=204, help="status of the other requests")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer((args.bind, args.port), make_handler(args.fail, args.status))
+    print(f"Listening on {args.bind}:{args.port}", file=sys.stderr, flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()